@@ -37,10 +37,12 @@ struct PresentTarget{
  * @param title the title of the created window
  * @param width the width of the created window
  * @param height the height of the created window
+ * @param visible false to create a hidden window, for headless runs that
+ * only need the graphics context
  * 
  * @return 0 if successfully inititalized. Otherwise return non zero.
  */
-int InitBackend(const char* title, int width, int height);
+int InitBackend(const char* title, int width, int height, bool visible = true);
 
 /**
  * @brief Run the main loop of the window
@@ -49,11 +51,50 @@ int InitBackend(const char* title, int width, int height);
  */
 void RunBackend(void (*callback)());
 
+/**
+ * @brief Request the main loop of the window to stop once the current frame
+ * is presented
+ */
+void CloseBackend();
+
 /**
  * @brief Shutdown the backend
  */
 void ShutdownBackend();
 
+/**
+ * @brief Create a hidden graphics context sharing its textures with the
+ * context of the window, for a render thread. Must be called from the main
+ * thread.
+ *
+ * @return the shared context, null if the backend does not support render
+ * threads
+ */
+void* CreateSharedContextBackend();
+
+/**
+ * @brief Make a context current on the calling thread
+ *
+ * @param context the context created by CreateSharedContextBackend, null to
+ * release the current one
+ */
+void MakeContextCurrentBackend(void* context);
+
+/**
+ * @brief Destroy a context created by CreateSharedContextBackend. Must be
+ * called from the main thread.
+ *
+ * @param context the context to destroy
+ */
+void DestroySharedContextBackend(void* context);
+
+/**
+ * @brief Wait for the commands submitted from the calling thread to be
+ * completed by the GPU, so that their results can be sampled from another
+ * context
+ */
+void FinishBackend();
+
 /**
  * @brief Update the buffer size from the backend size
  * 
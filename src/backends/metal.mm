@@ -160,7 +160,7 @@ static int appHeight;
 
 @end
 
-int InitBackend(const char* title, int width, int height)
+int InitBackend(const char* title, int width, int height, bool visible)
 {
     appTitle = title;
     appWidth = width;
@@ -191,10 +191,33 @@ void RunBackend(void (*callback)())
     }
 }
 
+void CloseBackend()
+{
+    [NSApp stop:nil];
+}
+
 void ShutdownBackend()
 { 
 }
 
+void* CreateSharedContextBackend()
+{
+    // the Metal presentation goes through a CPU copy made on the UI thread
+    return nullptr;
+}
+
+void MakeContextCurrentBackend(void* context)
+{
+}
+
+void DestroySharedContextBackend(void* context)
+{
+}
+
+void FinishBackend()
+{
+}
+
 void UpdateBufferSizeBackend(int width, int height, PresentTarget* target)
 {
 }
@@ -18,7 +18,7 @@
 static GLFWwindow* window = nullptr;
 
 
-int InitBackend(const char* title, int width, int height)
+int InitBackend(const char* title, int width, int height, bool visible)
 {
     // Initialize glfw
     if (!glfwInit()) return -1;
@@ -33,6 +33,7 @@ int InitBackend(const char* title, int width, int height)
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
 #endif
+    glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
 
     // Create a GLFW window
     window = glfwCreateWindow(width, height, title, NULL, NULL);
@@ -94,6 +95,36 @@ void RunBackend(void (*callback)())
     }
 }
 
+void CloseBackend()
+{
+    glfwSetWindowShouldClose(window, GLFW_TRUE);
+}
+
+void* CreateSharedContextBackend()
+{
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* context = glfwCreateWindow(1, 1, "", NULL, window);
+
+    // the hint is global, the windows created afterwards are visible again
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    return context;
+}
+
+void MakeContextCurrentBackend(void* context)
+{
+    glfwMakeContextCurrent(static_cast<GLFWwindow*>(context));
+}
+
+void DestroySharedContextBackend(void* context)
+{
+    if (context) glfwDestroyWindow(static_cast<GLFWwindow*>(context));
+}
+
+void FinishBackend()
+{
+    glFinish();
+}
+
 void UpdateBufferSizeBackend(int width, int height, PresentTarget* target)
 {
     GLuint handle = static_cast<GLuint>(target->handle.UncheckedGet<uint32_t>());
@@ -1,5 +1,7 @@
 #include "engine.h"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 #include <pxr/base/gf/camera.h>
@@ -8,8 +10,12 @@
 #include <pxr/imaging/hd/rendererPlugin.h>
 #include <pxr/imaging/hd/rendererPluginRegistry.h>
 #include <pxr/imaging/hd/renderBuffer.h>
+#include <pxr/imaging/hd/resourceRegistry.h>
+#include <pxr/imaging/hd/tokens.h>
 #include <pxr/imaging/hd/types.h>
 #include <pxr/imaging/hdx/pickTask.h>
+#include <pxr/imaging/hgi/blitCmds.h>
+#include <pxr/imaging/hgi/blitCmdsOps.h>
 #include <pxr/imaging/hgi/tokens.h>
 #include "pxr/imaging/hdSt/renderBuffer.h"
 
@@ -18,37 +24,114 @@ PXR_NAMESPACE_OPEN_SCOPE
 Engine::Engine(HdSceneIndexBaseRefPtr sceneIndex, TfToken plugin)
     : _sceneIndex(sceneIndex),
       _curRendererPlugin(plugin),
-      _hgi(Hgi::CreatePlatformDefaultHgi()),
-      _hgiDriver{HgiTokens->renderDriver, VtValue(_hgi.get())},
       _engine(),
       _renderDelegate(nullptr),
       _renderIndex(nullptr),
       _taskController(nullptr),
       _taskControllerId("/defaultTaskController"),
       _domeLightEnabled(false),
-      _ambientLightEnabled(true)
+      _ambientLightEnabled(true),
+      _isSelectionDirty(false),
+      _isRenderSizeDirty(true),
+      _progressiveEnabled(false),
+      _progressiveConverged(false),
+      _progressiveFrameBudget(0.008),
+      _progressivePasses(0),
+      _progressiveSceneVersion(0),
+      _progressiveTime(0),
+      _rendererCacheBudget(size_t(1) << 30),
+      _captureFramesLeft(0),
+      _captureFrameIndex(0),
+      _readbackSlot(0),
+      _renderContext(nullptr),
+      _executeCount(0),
+      _presentSlots(),
+      _writeSlot(0),
+      _readSlot(2),
+      _readySlot(1)
 {
     _width = 512;
     _height = 512;
+    _camView.SetIdentity();
+    _camProj.SetIdentity();
+    _lightingCamView.SetIdentity();
+
+    if (_isRenderThreadEnabled) _renderContext = CreateSharedContextBackend();
+
+    if (_renderContext) {
+        // the scene notices are held back until the render thread syncs
+        _UpdateBatchingSceneIndex();
+
+        // Hgi and the renderers live on the render thread and its context
+        _renderThread = make_unique<RenderThread>(
+            _renderContext, [this]() { _RenderFrame(); });
+        _renderThread->Run([this]() {
+            _InitializeHgi();
+            _Initialize();
+        });
+    }
+    else {
+        _InitializeHgi();
+        _Initialize();
+    }
 
-    _Initialize();
+    _instances.push_back(this);
 }
 
 Engine::~Engine()
 {
-    _Clear();
+    _instances.erase(find(_instances.begin(), _instances.end(), this));
+
+    if (_renderThread) {
+        _renderThread->Run([this]() {
+            _Clear();
+            _hgi.reset();
+        });
+        _renderThread.reset();
+        DestroySharedContextBackend(_renderContext);
+    }
+    else _Clear();
+}
+
+void Engine::SetRenderThreadEnabled(bool state)
+{
+    _isRenderThreadEnabled = state;
+}
+
+bool Engine::IsRenderThreadEnabled()
+{
+    return _isRenderThreadEnabled;
+}
+
+mutex& Engine::GetSceneMutex()
+{
+    return _sceneMutex;
 }
 
 void Engine::SetSceneIndex(HdSceneIndexBaseRefPtr newSceneIndex)
 {
-    if (_renderIndex && _sceneIndex) {
-        _renderIndex->RemoveSceneIndex(_sceneIndex);
-    }
-    
+    if (_Run([&]() { SetSceneIndex(newSceneIndex); })) return;
+
+    HdSceneIndexBaseRefPtr prevSceneIndex = _GetRenderedSceneIndex();
+
     _sceneIndex = newSceneIndex;
-    
-    if (_renderIndex && _sceneIndex) {
-        _renderIndex->InsertSceneIndex(_sceneIndex, _taskControllerId);
+    if (_renderThread) _UpdateBatchingSceneIndex();
+    HdSceneIndexBaseRefPtr sceneIndex = _GetRenderedSceneIndex();
+
+    if (_renderIndex && prevSceneIndex) {
+        _renderIndex->RemoveSceneIndex(prevSceneIndex);
+    }
+    // cached renderers must follow the scene index to stay warm
+    for (auto& renderer : _rendererCache) {
+        if (prevSceneIndex)
+            renderer.renderIndex->RemoveSceneIndex(prevSceneIndex);
+        if (sceneIndex)
+            renderer.renderIndex->InsertSceneIndex(sceneIndex,
+                                                   _taskControllerId);
+    }
+
+    if (_renderIndex && sceneIndex) {
+        _renderIndex->InsertSceneIndex(sceneIndex, _taskControllerId);
     }
 }
 
@@ -101,15 +184,49 @@ string Engine::GetRendererPluginName(TfToken plugin)
 
 void Engine::SetRendererPlugin(TfToken newPluginId)
 {
-    auto sceneIndex = _sceneIndex;
-    _Clear();
+    if (_Run([&]() { SetRendererPlugin(newPluginId); })) return;
+    if (newPluginId == _curRendererPlugin) return;
+
+    _ParkRenderer();
     _curRendererPlugin = newPluginId;
-    _sceneIndex = sceneIndex;
-    _Initialize();
+    if (!_RestoreRenderer(newPluginId)) _Initialize();
+    _EvictRenderers();
+
+    _isRenderSizeDirty = true;
+    _RestartProgressive();
+}
+
+void Engine::SetRendererCacheBudget(size_t bytes)
+{
+    if (_Run([&]() { SetRendererCacheBudget(bytes); })) return;
+
+    _rendererCacheBudget = bytes;
+    _EvictRenderers();
+}
+
+size_t Engine::GetRendererCacheBudget() const
+{
+    return _rendererCacheBudget;
+}
+
+TfTokenVector Engine::GetCachedRendererPlugins() const
+{
+    TfTokenVector plugins;
+    if (_renderThread && !_renderThread->IsRenderThread()) {
+        _renderThread->Run([&]() { plugins = GetCachedRendererPlugins(); });
+        return plugins;
+    }
+
+    for (auto& renderer : _rendererCache) plugins.push_back(renderer.plugin);
+    return plugins;
 }
 
 void Engine::SetCameraMatrices(GfMatrix4d view, GfMatrix4d proj)
 {
+    if (_Post([this, view, proj]() { SetCameraMatrices(view, proj); })) return;
+
+    if (view == _camView && proj == _camProj) return;
+
     _camView = view;
     _camProj = proj;
 
@@ -118,21 +235,32 @@ void Engine::SetCameraMatrices(GfMatrix4d view, GfMatrix4d proj)
 
 void Engine::SetSelection(SdfPathVector paths)
 {
-    HdSelectionSharedPtr const selection = std::make_shared<HdSelection>();
+    if (_Post([this, paths]() { SetSelection(paths); })) return;
 
-    HdSelection::HighlightMode mode = HdSelection::HighlightModeSelect;
+    if (paths == _selection) return;
+    _selection = paths;
+    _isSelectionDirty = true;
+    _RestartProgressive();
+}
 
-    for (auto&& path : paths) {
-        SdfPath realPath =
-            path.ReplacePrefix(SdfPath::AbsoluteRootPath(), _taskControllerId);
-        selection->AddRprim(mode, realPath);
-    }
+void Engine::SetExcludedPaths(SdfPathVector paths)
+{
+    if (_Post([this, paths]() { SetExcludedPaths(paths); })) return;
 
-    _selTracker->SetSelection(selection);
+    if (paths == _excludedPaths) return;
+    _excludedPaths = paths;
+    _RestartProgressive();
+    _UpdateCollection();
 }
 
 void Engine::SetRenderSize(int width, int height)
 {
+    if (_Post([this, width, height]() { SetRenderSize(width, height); }))
+        return;
+
+    if (width == _width && height == _height && !_isRenderSizeDirty) return;
+    _isRenderSizeDirty = false;
+
     _width = width;
     _height = height;
 
@@ -146,23 +274,89 @@ void Engine::SetRenderSize(int width, int height)
 
     _taskController->SetFraming(framing);
 
+    // the render thread resizes its present slots when it renders into them
+    if (_renderThread) return;
+
     UpdateBufferSizeBackend(_width, _height, &target);
     PresentBackend(target, _taskController);
 }
 
 void Engine::Render()
 {
-    // need to update lights every frame if ambient light
+    if (_renderThread && !_renderThread->IsRenderThread()) {
+        _renderThread->RequestFrame();
+        return;
+    }
+
+    // need to update lights when the camera moves if ambient light
     // is on as it aim from cam
-    if (_ambientLightEnabled)
+    if (_ambientLightEnabled && _lightingCamView != _camView)
         _UpdateLighting();
 
-    HdTaskSharedPtrVector tasks = _taskController->GetRenderingTasks();
-    _engine.Execute(_renderIndex, &tasks);
+    if (_progressiveEnabled) _RenderProgressive();
+    else _ExecuteRenderTasks();
+
+    // the render thread may have been cleared while it waited for the scene
+    if (!_taskController) return;
+
+    // converged progressive renders still hold the last image
+    if (_captureCallback) _CaptureAovs();
+}
+
+void Engine::SetProgressiveRenderingEnabled(bool state)
+{
+    if (_Run([&]() { SetProgressiveRenderingEnabled(state); })) return;
+
+    _progressiveEnabled = state;
+    _RestartProgressive();
+}
+
+bool Engine::IsProgressiveRenderingEnabled() const
+{
+    return _progressiveEnabled;
+}
+
+void Engine::SetProgressiveFrameBudget(double milliseconds)
+{
+    if (_Post([this, milliseconds]() {
+            SetProgressiveFrameBudget(milliseconds);
+        }))
+        return;
+
+    _progressiveFrameBudget = milliseconds / 1000.0;
+}
+
+bool Engine::IsConverged() const
+{
+    if (_renderThread) return _presentSlots[_readSlot].isConverged;
+    return _taskController->IsConverged();
+}
+
+int Engine::GetProgressivePassCount() const
+{
+    if (_renderThread) return _presentSlots[_readSlot].passCount;
+    return _progressivePasses;
+}
+
+double Engine::GetProgressiveRenderTime() const
+{
+    if (_renderThread && !_renderThread->IsRenderThread())
+        return _presentSlots[_readSlot].renderTime;
+    if (_progressiveConverged) return _progressiveTime;
+
+    chrono::duration<double> elapsed =
+        chrono::steady_clock::now() - _progressiveStart;
+    return elapsed.count();
 }
 
 SdfPath Engine::FindIntersection(GfVec2f screenPos)
 {
+    SdfPath hitPath;
+    if (_Run([&]() { hitPath = FindIntersection(screenPos); })) return hitPath;
+
+    // the caller holds the scene mutex, the picking sees its latest edits
+    if (_batchingSceneIndex) _batchingSceneIndex->Flush();
+
     // create a narrowed frustum on the given position
     float normalizedXPos = screenPos[0] / _width;
     float normalizedYPos = screenPos[1] / _height;
@@ -197,7 +391,20 @@ SdfPath Engine::FindIntersection(GfVec2f screenPos)
     // get the hitting point
     if (allHits.size() != 1) return SdfPath();
 
-    const SdfPath path = allHits[0].objectId.ReplacePrefix(
+    // an automatic instance is picked as the mesh it draws
+    const HdxPickHit& hit = allHits[0];
+    if (!hit.instancerId.IsEmpty()) {
+        InstancingSceneIndexRefPtr instancing =
+            _FindInstancingSceneIndex(_sceneIndex);
+        SdfPath instancerPath = hit.instancerId.ReplacePrefix(
+            _taskControllerId, SdfPath::AbsoluteRootPath());
+        SdfPath meshPath = instancing ? instancing->GetInstancedMeshPath(
+                                            instancerPath, hit.instanceIndex)
+                                      : SdfPath();
+        if (!meshPath.IsEmpty()) return meshPath;
+    }
+
+    const SdfPath path = hit.objectId.ReplacePrefix(
         _taskControllerId, SdfPath::AbsoluteRootPath());
 
     return path;
@@ -205,46 +412,307 @@ SdfPath Engine::FindIntersection(GfVec2f screenPos)
 
 void* Engine::GetRenderBufferData()
 {
+    if (_renderThread) return _GetReadSlot().target.buffer;
+
     auto buffer = _taskController->GetRenderOutput(HdAovTokens->color);
     return GetPointerToTextureBackend(target, buffer, _hgi.get());
 }
 
+void Engine::StartAovCapture(TfTokenVector aovs, AovCaptureCallback callback,
+                             int frameCount)
+{
+    if (_Run([&]() { StartAovCapture(aovs, callback, frameCount); })) return;
+
+    StopAovCapture();
+
+    _captureAovs = aovs;
+    _captureCallback = callback;
+    _captureFramesLeft = frameCount;
+    _captureFrameIndex = 0;
+
+    _UpdateRenderOutputs();
+}
+
+void Engine::StopAovCapture()
+{
+    if (_Run([&]() { StopAovCapture(); })) return;
+
+    bool hadExtraAovs = !_captureAovs.empty();
+
+    // the GPU may still be writing into the pending frames
+    if (!_pendingReadbacks[0].empty() || !_pendingReadbacks[1].empty()) {
+        HgiBlitCmdsUniquePtr blitCmds = _hgi->CreateBlitCmds();
+        _hgi->SubmitCmds(blitCmds.get(), HgiSubmitWaitTypeWaitUntilCompleted);
+    }
+
+    _captureAovs.clear();
+    _captureCallback = nullptr;
+    _captureFramesLeft = 0;
+    _pendingReadbacks[0].clear();
+    _pendingReadbacks[1].clear();
+
+    if (hadExtraAovs) _UpdateRenderOutputs();
+}
+
+bool Engine::IsCapturingAovs() const
+{
+    bool isCapturing = false;
+    if (_renderThread && !_renderThread->IsRenderThread()) {
+        _renderThread->Run([&]() { isCapturing = IsCapturingAovs(); });
+        return isCapturing;
+    }
+    return bool(_captureCallback);
+}
+
+EngineMemoryStats Engine::GetMemoryStats()
+{
+    EngineMemoryStats stats = {};
+    if (_Run([&]() { stats = GetMemoryStats(); })) return stats;
+
+    // the present buffer is an RGBA8 texture of the render size, tripled by
+    // the present slots of the render thread
+    stats.presentBufferMemory = size_t(_width) * _height * 4;
+    if (_renderThread) stats.presentBufferMemory *= 3;
+
+    // storm adds the depth AOV to the requested outputs on its own
+    TfTokenVector aovs{HdAovTokens->color, HdAovTokens->depth};
+    for (auto&& aov : _captureAovs) {
+        if (find(aovs.begin(), aovs.end(), aov) == aovs.end())
+            aovs.push_back(aov);
+    }
+    for (auto&& aov : aovs) {
+        HdRenderBuffer* buffer = _taskController->GetRenderOutput(aov);
+        if (!buffer) continue;
+        stats.renderBufferMemory += size_t(buffer->GetWidth()) *
+                                    buffer->GetHeight() * buffer->GetDepth() *
+                                    HdDataSizeOfFormat(buffer->GetFormat());
+    }
+
+    HdResourceRegistrySharedPtr registry =
+        _renderDelegate ? _renderDelegate->GetResourceRegistry() : nullptr;
+    if (registry) stats.resourceAllocation = registry->GetResourceAllocation();
+
+    auto getBytes = [&stats](const TfToken& key) -> size_t {
+        auto it = stats.resourceAllocation.find(key.GetString());
+        if (it == stats.resourceAllocation.end() ||
+            !it->second.IsHolding<size_t>())
+            return 0;
+        return it->second.UncheckedGet<size_t>();
+    };
+    stats.gpuMemory = getBytes(HdPerfTokens->gpuMemoryUsed);
+    stats.textureMemory = getBytes(HdPerfTokens->textureMemory);
+
+    return stats;
+}
+
+vector<Engine*> Engine::GetInstances()
+{
+    return _instances;
+}
+
 void Engine::SetAmbientLightEnabled(bool state)
 {
+    if (_Post([this, state]() { SetAmbientLightEnabled(state); })) return;
+
     _ambientLightEnabled = state;
     _UpdateLighting();
 }
 
 void Engine::SetDomeLightEnabled(bool state)
 {
+    if (_Post([this, state]() { SetDomeLightEnabled(state); })) return;
+
     _domeLightEnabled = state;
     _UpdateLighting();
 }
 
 void Engine::SetDomeLightTexturePath(string texturePath)
 {
+    if (_Post([this, texturePath]() { SetDomeLightTexturePath(texturePath); }))
+        return;
+
     _domeLightTexturePath = texturePath;
     _UpdateLighting();
 }
 
+bool Engine::_Post(function<void()> command)
+{
+    if (!_renderThread || _renderThread->IsRenderThread()) return false;
+
+    _renderThread->Post(command);
+    return true;
+}
+
+bool Engine::_Run(function<void()> command)
+{
+    if (!_renderThread || _renderThread->IsRenderThread()) return false;
+
+    _renderThread->Run(command);
+    return true;
+}
+
+void Engine::_InitializeHgi()
+{
+    _hgi = Hgi::CreatePlatformDefaultHgi();
+    _hgiDriver = {HgiTokens->renderDriver, VtValue(_hgi.get())};
+}
+
+void Engine::_UpdateBatchingSceneIndex()
+{
+    _batchingSceneIndex = nullptr;
+    if (!_sceneIndex) return;
+
+    _batchingSceneIndex = HdNoticeBatchingSceneIndex::New(_sceneIndex);
+    _batchingSceneIndex->SetBatchingEnabled(true);
+}
+
+HdSceneIndexBaseRefPtr Engine::_GetRenderedSceneIndex() const
+{
+    if (_batchingSceneIndex) return _batchingSceneIndex;
+    return _sceneIndex;
+}
+
+void Engine::_RenderFrame()
+{
+    // the notices batched since the last frame dirty the render index first,
+    // so that a converged progressive render restarts on them
+    if (!_renderIndex || !_renderThread->Lock(_sceneMutex)) return;
+    if (_batchingSceneIndex) _batchingSceneIndex->Flush();
+    _sceneMutex.unlock();
+    if (!_renderIndex) return;
+
+    size_t executeCount = _executeCount;
+    Render();
+
+    // a converged progressive render executes nothing, the published frame
+    // is still the newest one
+    if (_executeCount == executeCount) return;
+
+    // the UI context samples the texture once the GPU is done with it
+    FinishBackend();
+
+    _PresentSlot& slot = _presentSlots[_writeSlot];
+    slot.isConverged = _taskController && _taskController->IsConverged();
+    slot.passCount = _progressivePasses;
+    slot.renderTime = GetProgressiveRenderTime();
+
+    _writeSlot = _readySlot.exchange(_writeSlot | _NEW_FRAME_BIT) &
+                 ~_NEW_FRAME_BIT;
+}
+
+const Engine::_PresentSlot& Engine::_GetReadSlot()
+{
+    if (_readySlot.load() & _NEW_FRAME_BIT)
+        _readSlot = _readySlot.exchange(_readSlot) & ~_NEW_FRAME_BIT;
+    return _presentSlots[_readSlot];
+}
+
 void Engine::_Clear()
 {
-    if (_taskController) {
-        delete _taskController;
-        _taskController = nullptr;
+    for (auto& renderer : _rendererCache) _DestroyRenderer(renderer);
+    _rendererCache.clear();
+
+    _RendererInstance current{_curRendererPlugin, std::move(_renderDelegate),
+                              _renderIndex, _taskController};
+    _DestroyRenderer(current);
+
+    _renderDelegate = nullptr;
+    _renderIndex = nullptr;
+    _taskController = nullptr;
+}
+
+void Engine::_ParkRenderer()
+{
+    if (!_renderIndex) return;
+
+    // the render index stays attached to the scene index so it keeps
+    // tracking dirty state while inactive, the next sync is incremental
+    _rendererCache.push_front({_curRendererPlugin, std::move(_renderDelegate),
+                               _renderIndex, _taskController});
+
+    _renderDelegate = nullptr;
+    _renderIndex = nullptr;
+    _taskController = nullptr;
+}
+
+bool Engine::_RestoreRenderer(TfToken plugin)
+{
+    for (auto it = _rendererCache.begin(); it != _rendererCache.end(); ++it) {
+        if (it->plugin != plugin) continue;
+
+        _renderDelegate = std::move(it->renderDelegate);
+        _renderIndex = it->renderIndex;
+        _taskController = it->taskController;
+        _rendererCache.erase(it);
+
+        _taskController->SetFreeCameraMatrices(_camView, _camProj);
+        _UpdateCollection();
+        _UpdateLighting();
+        _UpdateRenderOutputs();
+        return true;
+    }
+    return false;
+}
+
+void Engine::_EvictRenderers()
+{
+    size_t count = 0;
+    size_t memory = 0;
+
+    auto it = _rendererCache.begin();
+    while (it != _rendererCache.end()) {
+        count++;
+        memory += _GetRendererMemory(it->renderDelegate.Get());
+
+        if (_rendererCacheBudget == 0 || count > _MAX_CACHED_RENDERERS ||
+            memory > _rendererCacheBudget) {
+            _DestroyRenderer(*it);
+            it = _rendererCache.erase(it);
+        }
+        else ++it;
     }
+}
 
-    if (_renderIndex && _sceneIndex) {
-        _renderIndex->RemoveSceneIndex(_sceneIndex);
-        _sceneIndex = nullptr;
+void Engine::_DestroyRenderer(_RendererInstance& renderer)
+{
+    if (renderer.taskController) {
+        delete renderer.taskController;
+        renderer.taskController = nullptr;
     }
 
-    if (_renderIndex) {
-        delete _renderIndex;
-        _renderIndex = nullptr;
+    HdSceneIndexBaseRefPtr sceneIndex = _GetRenderedSceneIndex();
+    if (renderer.renderIndex && sceneIndex) {
+        renderer.renderIndex->RemoveSceneIndex(sceneIndex);
     }
 
-    _renderDelegate = nullptr;
+    if (renderer.renderIndex) {
+        delete renderer.renderIndex;
+        renderer.renderIndex = nullptr;
+    }
+
+    renderer.renderDelegate = nullptr;
+}
+
+size_t Engine::_GetRendererMemory(HdRenderDelegate* renderDelegate)
+{
+    if (!renderDelegate) return 0;
+
+    HdResourceRegistrySharedPtr registry =
+        renderDelegate->GetResourceRegistry();
+    if (!registry) return 0;
+
+    // not every render delegate reports its allocations, those that don't
+    // only count against the maximum number of cached renderers
+    VtDictionary allocation = registry->GetResourceAllocation();
+
+    size_t memory = 0;
+    for (const TfToken& key :
+         {HdPerfTokens->gpuMemoryUsed, HdPerfTokens->textureMemory}) {
+        auto it = allocation.find(key.GetString());
+        if (it != allocation.end() && it->second.IsHolding<size_t>())
+            memory += it->second.UncheckedGet<size_t>();
+    }
+    return memory;
 }
 
 HdPluginRenderDelegateUniqueHandle Engine::_GetRenderDelegateFromPlugin(
@@ -266,7 +734,7 @@ void Engine::_Initialize()
     // init render index
     _renderIndex = HdRenderIndex::New(_renderDelegate.Get(), {&_hgiDriver});
 
-    _renderIndex->InsertSceneIndex(_sceneIndex, _taskControllerId);
+    _renderIndex->InsertSceneIndex(_GetRenderedSceneIndex(), _taskControllerId);
 
     // init task controller
     _taskController = new HdxTaskController(_renderIndex, _taskControllerId);
@@ -280,23 +748,13 @@ void Engine::_Initialize()
     // init collection
     _collection = HdRprimCollection(HdTokens->geometry,
                                     HdReprSelector(HdReprTokens->smoothHull));
-    _taskController->SetCollection(_collection);
+    _UpdateCollection();
 
     // init render tags
     _taskController->SetRenderTags(TfTokenVector());
 
     // init AOVs
-    TfTokenVector _aovOutputs{HdAovTokens->color};
-    _taskController->SetRenderOutputs(_aovOutputs);
-
-    GfVec4f clearColor = GfVec4f(.0f, .0f, .0f, .0f);
-    HdAovDescriptor colorAovDesc =
-        _taskController->GetRenderOutputSettings(HdAovTokens->color);
-    if (colorAovDesc.format != HdFormatInvalid) {
-        colorAovDesc.clearValue = VtValue(clearColor);
-        _taskController->SetRenderOutputSettings(HdAovTokens->color,
-                                                 colorAovDesc);
-    }
+    _UpdateRenderOutputs();
 
     // init selection
     GfVec4f selectionColor = GfVec4f(1.f, 1.f, 0.f, .5f);
@@ -307,6 +765,11 @@ void Engine::_Initialize()
 
     VtValue selectionValue(_selTracker);
     _engine.SetTaskContextData(HdxTokens->selectionState, selectionValue);
+    _taskContext[HdxTokens->selectionState] = selectionValue;
+
+    // the new tracker starts empty, the selection made with the previous
+    // renderer is kept
+    _isSelectionDirty = true;
 
     _taskController->SetOverrideWindowPolicy(CameraUtilFit);
 
@@ -317,8 +780,265 @@ void Engine::_Initialize()
     _taskController->SetColorCorrectionParams(colorParams);
 }
 
+void Engine::_UpdateSelection()
+{
+    _isSelectionDirty = false;
+
+    HdSelectionSharedPtr const selection = std::make_shared<HdSelection>();
+
+    HdSelection::HighlightMode mode = HdSelection::HighlightModeSelect;
+
+    // the instanced meshes have no rprim, their instance is highlighted
+    InstancingSceneIndexRefPtr instancing =
+        _FindInstancingSceneIndex(_sceneIndex);
+
+    for (auto&& path : _selection) {
+        SdfPath prototypePath;
+        int instanceIndex;
+        if (instancing &&
+            instancing->GetInstance(path, &prototypePath, &instanceIndex)) {
+            SdfPath realPath = prototypePath.ReplacePrefix(
+                SdfPath::AbsoluteRootPath(), _taskControllerId);
+            selection->AddInstance(mode, realPath, VtIntArray{instanceIndex});
+            continue;
+        }
+
+        SdfPath realPath =
+            path.ReplacePrefix(SdfPath::AbsoluteRootPath(), _taskControllerId);
+        selection->AddRprim(mode, realPath);
+    }
+
+    _selTracker->SetSelection(selection);
+}
+
+InstancingSceneIndexRefPtr Engine::_FindInstancingSceneIndex(
+    HdSceneIndexBaseRefPtr sceneIndex) const
+{
+    if (!sceneIndex) return nullptr;
+    if (auto instancing =
+            TfDynamic_cast<InstancingSceneIndexRefPtr>(sceneIndex))
+        return instancing;
+
+    auto filtering =
+        TfDynamic_cast<HdFilteringSceneIndexBaseRefPtr>(sceneIndex);
+    if (!filtering) return nullptr;
+    for (auto&& input : filtering->GetInputScenes()) {
+        if (auto instancing = _FindInstancingSceneIndex(input))
+            return instancing;
+    }
+    return nullptr;
+}
+
+void Engine::_UpdateRenderOutputs()
+{
+    // color always comes first as it is the AOV displayed by the viewport
+    TfTokenVector aovOutputs{HdAovTokens->color};
+    for (auto&& aov : _captureAovs) {
+        if (aov != HdAovTokens->color) aovOutputs.push_back(aov);
+    }
+    _taskController->SetRenderOutputs(aovOutputs);
+    _taskController->SetViewportRenderOutput(HdAovTokens->color);
+
+    GfVec4f clearColor = GfVec4f(.0f, .0f, .0f, .0f);
+    HdAovDescriptor colorAovDesc =
+        _taskController->GetRenderOutputSettings(HdAovTokens->color);
+    if (colorAovDesc.format != HdFormatInvalid) {
+        colorAovDesc.clearValue = VtValue(clearColor);
+        _taskController->SetRenderOutputSettings(HdAovTokens->color,
+                                                 colorAovDesc);
+    }
+}
+
+void Engine::_CaptureAovs()
+{
+    // the readbacks submitted on the previous frame are complete by now
+    int prevSlot = 1 - _readbackSlot;
+    vector<AovFrame> readyFrames;
+    readyFrames.swap(_pendingReadbacks[prevSlot]);
+
+    if (_captureFramesLeft != 0) {
+        for (auto&& aov : _captureAovs) {
+            AovFrame frame;
+            frame.frameIndex = _captureFrameIndex;
+
+            bool isPending = false;
+            if (!_ReadbackAov(aov, &frame, &isPending)) continue;
+
+            if (isPending)
+                _pendingReadbacks[_readbackSlot].push_back(std::move(frame));
+            else readyFrames.push_back(std::move(frame));
+        }
+        _captureFrameIndex++;
+        if (_captureFramesLeft > 0) _captureFramesLeft--;
+    }
+    _readbackSlot = prevSlot;
+
+    // the callback may stop the capture
+    AovCaptureCallback callback = _captureCallback;
+    for (auto&& frame : readyFrames) callback(frame);
+
+    if (_captureFramesLeft == 0 && _pendingReadbacks[0].empty() &&
+        _pendingReadbacks[1].empty())
+        StopAovCapture();
+}
+
+bool Engine::_ReadbackAov(TfToken aov, AovFrame* frame, bool* isPending)
+{
+    HdRenderBuffer* buffer = _taskController->GetRenderOutput(aov);
+    if (!buffer) return false;
+
+    buffer->Resolve();
+
+    frame->aov = aov;
+    frame->width = buffer->GetWidth();
+    frame->height = buffer->GetHeight();
+    frame->format = buffer->GetFormat();
+
+    size_t pixelByteSize = HdDataSizeOfFormat(frame->format);
+    size_t dataByteSize = frame->width * frame->height * pixelByteSize;
+    if (dataByteSize == 0) return false;
+    frame->data.resize(dataByteSize);
+
+    // GPU render buffers (Storm) expose their texture, the copy is queued
+    // without waiting for the GPU
+    VtValue resource = buffer->GetResource(false);
+    if (resource.IsHolding<HgiTextureHandle>()) {
+        HgiTextureGpuToCpuOp copyOp;
+        copyOp.gpuSourceTexture = resource.UncheckedGet<HgiTextureHandle>();
+        copyOp.sourceTexelOffset = GfVec3i(0);
+        copyOp.mipLevel = 0;
+        copyOp.cpuDestinationBuffer = frame->data.data();
+        copyOp.destinationByteOffset = 0;
+        copyOp.destinationBufferByteSize = dataByteSize;
+
+        HgiBlitCmdsUniquePtr blitCmds = _hgi->CreateBlitCmds();
+        blitCmds->PushDebugGroup("AOV readback");
+        blitCmds->CopyTextureGpuToCpu(copyOp);
+        blitCmds->PopDebugGroup();
+        _hgi->SubmitCmds(blitCmds.get(), HgiSubmitWaitTypeNoWait);
+
+        *isPending = true;
+        return true;
+    }
+
+    // CPU render buffers (e.g. Embree) can be mapped directly
+    void* data = buffer->Map();
+    if (!data) return false;
+    memcpy(frame->data.data(), data, dataByteSize);
+    buffer->Unmap();
+
+    *isPending = false;
+    return true;
+}
+
+bool Engine::_ExecuteRenderTasks()
+{
+    if (!_renderThread) {
+        if (_isSelectionDirty) _UpdateSelection();
+        HdTaskSharedPtrVector tasks = _taskController->GetRenderingTasks();
+        _engine.Execute(_renderIndex, &tasks);
+        _executeCount++;
+        return true;
+    }
+
+    // HdEngine::Execute split in two: the sync reads the scene indices
+    // under the scene mutex, the execution runs while the UI goes on. The
+    // commands run while waiting for the mutex may switch the renderer.
+    if (!_renderThread->Lock(_sceneMutex)) return false;
+    if (!_renderIndex) {
+        _sceneMutex.unlock();
+        return false;
+    }
+
+    // the instances of the selected meshes are read from the scene indices
+    if (_isSelectionDirty) _UpdateSelection();
+
+    _PresentSlot& slot = _presentSlots[_writeSlot];
+    if (slot.width != _width || slot.height != _height) {
+        UpdateBufferSizeBackend(_width, _height, &slot.target);
+        slot.width = _width;
+        slot.height = _height;
+    }
+    PresentBackend(slot.target, _taskController);
+
+    if (_batchingSceneIndex) _batchingSceneIndex->Flush();
+
+    HdTaskSharedPtrVector tasks = _taskController->GetRenderingTasks();
+    _renderIndex->SyncAll(&tasks, &_taskContext);
+    for (auto& task : tasks) task->Prepare(&_taskContext, _renderIndex);
+
+    _sceneMutex.unlock();
+
+    _renderIndex->GetResourceRegistry()->Commit();
+    for (auto& task : tasks) task->Execute(&_taskContext);
+
+    _executeCount++;
+    return true;
+}
+
+void Engine::_RenderProgressive()
+{
+    // any dirtied prim, light or camera since the last pass invalidates the
+    // accumulated samples
+    if (_renderIndex->GetChangeTracker().GetSceneStateVersion() !=
+        _progressiveSceneVersion)
+        _RestartProgressive();
+
+    if (_progressiveConverged) return;
+
+    auto frameStart = chrono::steady_clock::now();
+    chrono::duration<double> elapsed(0);
+
+    do {
+        auto passStart = chrono::steady_clock::now();
+        if (!_ExecuteRenderTasks()) return;
+        _progressivePasses++;
+
+        if (_taskController->IsConverged()) {
+            _progressiveTime = GetProgressiveRenderTime();
+            _progressiveConverged = true;
+            break;
+        }
+
+        // asynchronous renderers (e.g. Embree) accumulate samples on their
+        // own threads and return immediately, executing them again within
+        // the same frame would only keep the UI thread busy
+        chrono::duration<double> passTime =
+            chrono::steady_clock::now() - passStart;
+        if (passTime.count() < 0.001) break;
+
+        elapsed = chrono::steady_clock::now() - frameStart;
+    } while (elapsed.count() < _progressiveFrameBudget);
+
+    // the render index may have been switched while executing on the render
+    // thread
+    _progressiveSceneVersion =
+        _renderIndex->GetChangeTracker().GetSceneStateVersion();
+}
+
+void Engine::_RestartProgressive()
+{
+    _progressiveConverged = false;
+    _progressivePasses = 0;
+    _progressiveTime = 0;
+    _progressiveStart = chrono::steady_clock::now();
+}
+
+void Engine::_UpdateCollection()
+{
+    SdfPathVector excludePaths;
+    for (auto&& path : _excludedPaths) {
+        excludePaths.push_back(
+            path.ReplacePrefix(SdfPath::AbsoluteRootPath(), _taskControllerId));
+    }
+    _collection.SetExcludePaths(excludePaths);
+    _taskController->SetCollection(_collection);
+}
+
 void Engine::_UpdateLighting()
 {
+    _lightingCamView = _camView;
+
     GlfSimpleLightVector lights;
 
     if (_domeLightEnabled) {
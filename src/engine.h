@@ -10,9 +10,12 @@
 #pragma once
 
 #include "backends/backend.h"
+#include "renderthread.h"
+#include "sceneindices/instancingsceneindex.h"
 
 #include <pxr/base/tf/token.h>
 #include <pxr/imaging/hd/engine.h>
+#include <pxr/imaging/hd/noticeBatchingSceneIndex.h>
 #include <pxr/imaging/hd/pluginRenderDelegateUniqueHandle.h>
 #include <pxr/imaging/hd/renderDelegate.h>
 #include <pxr/imaging/hd/sceneIndex.h>
@@ -20,15 +23,63 @@
 #include <pxr/imaging/hgi/hgi.h>
 #include <pxr/usd/usd/prim.h>
 
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+
 PXR_NAMESPACE_OPEN_SCOPE
 
 using HgiUniquePtr = std::unique_ptr<class Hgi>;
 using namespace std;
 
+/**
+ * @brief The content of an AOV read back into CPU memory
+ *
+ * @param aov the name of the AOV (color, depth, primId, ...)
+ * @param width the width of the AOV in pixels
+ * @param height the height of the AOV in pixels
+ * @param format the format of a pixel
+ * @param frameIndex the index of the captured frame since the capture started
+ * @param data the pixels, rows are stored bottom to top
+ */
+struct AovFrame {
+    TfToken aov;
+    int width, height;
+    HdFormat format;
+    size_t frameIndex;
+    vector<uint8_t> data;
+};
+
+using AovCaptureCallback = function<void(const AovFrame&)>;
+
+/**
+ * @brief The memory used by an Engine
+ *
+ * @param presentBufferMemory the textures presented to ImGui, allocated by
+ * UpdateBufferSizeBackend (three of them with a render thread)
+ * @param renderBufferMemory the AOV render buffers of the task controller
+ * @param gpuMemory the GPU memory reported by the resource registry
+ * @param textureMemory the texture memory reported by the resource registry,
+ * allocated through Hgi for Storm
+ * @param resourceAllocation the full report of the resource registry
+ */
+struct EngineMemoryStats {
+    size_t presentBufferMemory, renderBufferMemory;
+    size_t gpuMemory, textureMemory;
+    VtDictionary resourceAllocation;
+};
+
 /**
  * @brief Engine is the renderer that renders a stage according to a given
  * renderer plugin.
  *
+ * With the render thread enabled, the Engine renders on its own thread and
+ * graphics context. The setters are forwarded to the render thread, Render
+ * only requests a frame, and the rendered frames are presented to ImGui
+ * through a triple buffer so that neither thread waits for the other.
  */
 class Engine {
     public:
@@ -46,6 +97,32 @@ class Engine {
          */
         ~Engine();
 
+        /**
+         * @brief Enable or disable the render thread of the engines created
+         * from now on. Backends that cannot share a graphics context with
+         * another thread render on the UI thread regardless.
+         *
+         * @param state true to render on a dedicated thread
+         */
+        static void SetRenderThreadEnabled(bool state);
+
+        /**
+         * @brief Check if the engines created from now on render on a
+         * dedicated thread
+         *
+         * @return true if the render thread is enabled
+         */
+        static bool IsRenderThreadEnabled();
+
+        /**
+         * @brief Get the mutex guarding the scene indices against the render
+         * threads. The UI thread must hold it while it reads or edits the
+         * scene indices, the render threads only hold it to sync.
+         *
+         * @return the scene mutex
+         */
+        static mutex& GetSceneMutex();
+
         /**
          *  @brief Set The Scene Index to the Hydra Engine
          * 
@@ -90,11 +167,39 @@ class Engine {
 
         /**
          * @brief Set Render plugin to Hydra Engine
-         * 
+         *
+         * The previous renderer is kept warm in a cache so that switching
+         * back to it does not require a full resync of the scene.
+         *
          * @param newPluginId the new plugin Id to use in Hdyra
          */
         void SetRendererPlugin(TfToken newPluginId);
 
+        /**
+         * @brief Set the memory budget of the warm renderer cache
+         *
+         * Inactive renderers are evicted (least recently used first) once
+         * the memory they report exceeds the budget. A budget of 0 disables
+         * the cache.
+         *
+         * @param bytes the memory budget in bytes
+         */
+        void SetRendererCacheBudget(size_t bytes);
+
+        /**
+         * @brief Get the memory budget of the warm renderer cache
+         *
+         * @return the memory budget in bytes
+         */
+        size_t GetRendererCacheBudget() const;
+
+        /**
+         * @brief Get the renderer plugins currently kept warm in the cache
+         *
+         * @return the cached renderer plugins, most recently used first
+         */
+        TfTokenVector GetCachedRendererPlugins() const;
+
         /**
          * @brief Set the matrices of the current camera
          *
@@ -110,6 +215,15 @@ class Engine {
          */
         void SetSelection(SdfPathVector paths);
 
+        /**
+         * @brief Set the paths of the prims excluded from the render. The
+         * prims stay in the render index, only their draw items are skipped.
+         *
+         * @param paths a vector of SDF Paths, their descendants are excluded
+         * as well
+         */
+        void SetExcludedPaths(SdfPathVector paths);
+
         /**
          * @brief Set the render size
          *
@@ -120,9 +234,57 @@ class Engine {
 
         /**
          * @brief Render the current state
+         *
+         * In progressive mode, render passes are executed until the
+         * renderer converges or the frame budget is spent, and nothing is
+         * executed once converged until the camera or the scene changes.
          */
         void Render();
 
+        /**
+         * @brief Enable or disable the progressive rendering mode
+         *
+         * @param state true to enable progressive rendering
+         */
+        void SetProgressiveRenderingEnabled(bool state);
+
+        /**
+         * @brief Check if the progressive rendering mode is enabled
+         *
+         * @return true if progressive rendering is enabled
+         */
+        bool IsProgressiveRenderingEnabled() const;
+
+        /**
+         * @brief Set the time a progressive render can spend per frame
+         *
+         * @param milliseconds the per frame budget in milliseconds
+         */
+        void SetProgressiveFrameBudget(double milliseconds);
+
+        /**
+         * @brief Check if the current render has converged
+         *
+         * @return true if the renderer reports the image as converged
+         */
+        bool IsConverged() const;
+
+        /**
+         * @brief Get the number of render passes executed since the last
+         * restart of the progressive render
+         *
+         * @return the number of render passes
+         */
+        int GetProgressivePassCount() const;
+
+        /**
+         * @brief Get the time spent on the progressive render since its last
+         * restart, or the time it took to converge once converged
+         *
+         * @return the render time in seconds
+         */
+        double GetProgressiveRenderTime() const;
+
         /**
          * @brief Find the visible USD Prim at the given screen position
          *
@@ -140,6 +302,51 @@ class Engine {
          */
         void *GetRenderBufferData();
 
+        /**
+         * @brief Start reading the given AOVs back into CPU memory after
+         * each render
+         *
+         * GPU render buffers are copied with Hgi blit commands that are not
+         * waited on. The copy submitted on a frame is delivered on the next
+         * one, so the render thread never stalls on the read. CPU render
+         * buffers are delivered on the frame they are rendered. With a
+         * render thread, the callback runs on the render thread.
+         *
+         * @param aovs the AOVs to capture (e.g. color, depth, primId)
+         * @param callback the function receiving every captured AOV
+         * @param frameCount the number of frames to capture, -1 to capture
+         * until StopAovCapture is called
+         */
+        void StartAovCapture(TfTokenVector aovs, AovCaptureCallback callback,
+                             int frameCount = -1);
+
+        /**
+         * @brief Stop the AOV capture, pending readbacks are dropped
+         */
+        void StopAovCapture();
+
+        /**
+         * @brief Check if AOVs are being captured
+         *
+         * @return true if a capture is running
+         */
+        bool IsCapturingAovs() const;
+
+        /**
+         * @brief Get the memory used by the active renderer and the buffers
+         * of the engine
+         *
+         * @return the memory stats of the engine
+         */
+        EngineMemoryStats GetMemoryStats();
+
+        /**
+         * @brief Get the engines currently alive
+         *
+         * @return the engines, in their order of creation
+         */
+        static vector<Engine*> GetInstances();
+
         /**
          * @brief Set ambient light state
          * 
@@ -162,6 +369,36 @@ class Engine {
         void SetDomeLightTexturePath(string texturePath);
 
     private:
+        /**
+         * @brief A live renderer (render delegate, render index and task
+         * controller) created for a given renderer plugin
+         */
+        struct _RendererInstance {
+            TfToken plugin;
+            HdPluginRenderDelegateUniqueHandle renderDelegate;
+            HdRenderIndex* renderIndex;
+            HdxTaskController* taskController;
+        };
+
+        /**
+         * @brief A frame of the triple buffer presented to ImGui, with the
+         * progressive state it was rendered with
+         */
+        struct _PresentSlot {
+            PresentTarget target;
+            int width, height;
+            bool isConverged;
+            int passCount;
+            double renderTime;
+        };
+
+        const size_t _MAX_CACHED_RENDERERS = 4;
+        const int _NEW_FRAME_BIT = 4;
+
+        inline static vector<Engine*> _instances;
+        inline static bool _isRenderThreadEnabled = false;
+        inline static mutex _sceneMutex;
+
         UsdStageRefPtr _stage;
         GfMatrix4d _camView, _camProj;
         int _width, _height;
@@ -185,11 +422,133 @@ class Engine {
 
         TfToken _curRendererPlugin;
 
+        SdfPathVector _selection, _excludedPaths;
+        bool _isSelectionDirty;
+        GfMatrix4d _lightingCamView;
+        bool _isRenderSizeDirty;
+
+        bool _progressiveEnabled, _progressiveConverged;
+        double _progressiveFrameBudget;
+        int _progressivePasses;
+        unsigned int _progressiveSceneVersion;
+        chrono::steady_clock::time_point _progressiveStart;
+        double _progressiveTime;
+
+        list<_RendererInstance> _rendererCache;
+        size_t _rendererCacheBudget;
+
+        TfTokenVector _captureAovs;
+        AovCaptureCallback _captureCallback;
+        int _captureFramesLeft;
+        size_t _captureFrameIndex;
+        vector<AovFrame> _pendingReadbacks[2];
+        int _readbackSlot;
+
+        void* _renderContext;
+        unique_ptr<RenderThread> _renderThread;
+        HdNoticeBatchingSceneIndexRefPtr _batchingSceneIndex;
+        HdTaskContext _taskContext;
+        size_t _executeCount;
+        _PresentSlot _presentSlots[3];
+        int _writeSlot, _readSlot;
+        atomic<int> _readySlot;
+
+        /**
+         * @brief Post a command to the render thread if the caller is not
+         * the render thread
+         *
+         * @param command the command to post
+         *
+         * @return true if the command was posted, false if the caller must
+         * run it itself
+         */
+        bool _Post(function<void()> command);
+
+        /**
+         * @brief Run a command on the render thread and wait for it if the
+         * caller is not the render thread
+         *
+         * @param command the command to run
+         *
+         * @return true if the command was run, false if the caller must run
+         * it itself
+         */
+        bool _Run(function<void()> command);
+
+        /**
+         * @brief Create the Hgi of the engine on the current thread
+         */
+        void _InitializeHgi();
+
+        /**
+         * @brief Wrap the scene index into a new batching scene index, whose
+         * notices are only sent when the render thread flushes them
+         */
+        void _UpdateBatchingSceneIndex();
+
+        /**
+         * @brief Get the scene index inserted into the render indices, the
+         * batching scene index with a render thread
+         *
+         * @return the scene index inserted into the render indices
+         */
+        HdSceneIndexBaseRefPtr _GetRenderedSceneIndex() const;
+
+        /**
+         * @brief Render a frame on the render thread into the write slot of
+         * the triple buffer and publish it
+         */
+        void _RenderFrame();
+
+        /**
+         * @brief Get the newest frame published by the render thread
+         *
+         * @return the present slot read by ImGui
+         */
+        const _PresentSlot& _GetReadSlot();
+
         /**
          * @brief Clear Hydra Engine allocation and resources
          */
         void _Clear();
 
+        /**
+         * @brief Move the active renderer to the front of the cache
+         */
+        void _ParkRenderer();
+
+        /**
+         * @brief Reactivate a cached renderer of the given plugin
+         *
+         * @param plugin the renderer plugin to reactivate
+         *
+         * @return true if a cached renderer was found and reactivated
+         */
+        bool _RestoreRenderer(TfToken plugin);
+
+        /**
+         * @brief Evict the least recently used cached renderers until the
+         * cache fits in its memory budget
+         */
+        void _EvictRenderers();
+
+        /**
+         * @brief Destroy the given renderer
+         *
+         * @param renderer the renderer to destroy
+         */
+        void _DestroyRenderer(_RendererInstance& renderer);
+
+        /**
+         * @brief Get the memory reported by the resource registry of a
+         * render delegate
+         *
+         * @param renderDelegate the render delegate to query
+         *
+         * @return the memory used by the render delegate in bytes
+         */
+        static size_t _GetRendererMemory(HdRenderDelegate* renderDelegate);
+
         /**
          * @brief Get the render delegate from the given renderer plugin
          *
@@ -209,6 +568,71 @@ class Engine {
          * @brief Update the default lighting (ambient and dome lights)
          */
         void _UpdateLighting();
+
+        /**
+         * @brief Update the rprim collection of the task controller with the
+         * excluded paths
+         */
+        void _UpdateCollection();
+
+        /**
+         * @brief Set the selection of the selection tracker from the
+         * selected paths, the instanced meshes being highlighted through
+         * their instance. Called before the sync, under the scene mutex.
+         */
+        void _UpdateSelection();
+
+        /**
+         * @brief Find the automatic instancing among the inputs of a scene
+         * index
+         *
+         * @param sceneIndex the scene index to search from
+         * @return the instancing scene index, null if there is none
+         */
+        InstancingSceneIndexRefPtr _FindInstancingSceneIndex(
+            HdSceneIndexBaseRefPtr sceneIndex) const;
+
+        /**
+         * @brief Set the render outputs of the task controller (color and
+         * the captured AOVs)
+         */
+        void _UpdateRenderOutputs();
+
+        /**
+         * @brief Submit the readback of the captured AOVs and deliver the
+         * ones submitted on the previous frame
+         */
+        void _CaptureAovs();
+
+        /**
+         * @brief Read an AOV back into CPU memory
+         *
+         * @param aov the AOV to read
+         * @param frame the frame receiving the pixels
+         * @param isPending set to true if the copy is done asynchronously
+         * on the GPU and is only complete on the next frame
+         *
+         * @return true if the AOV could be read
+         */
+        bool _ReadbackAov(TfToken aov, AovFrame* frame, bool* isPending);
+
+        /**
+         * @brief Execute the rendering tasks once
+         *
+         * @return false if the render thread stopped before the execution
+         */
+        bool _ExecuteRenderTasks();
+
+        /**
+         * @brief Render passes within the frame budget until convergence
+         */
+        void _RenderProgressive();
+
+        /**
+         * @brief Restart the progressive render (samples are discarded by
+         * the renderer on its own, this resets the counters)
+         */
+        void _RestartProgressive();
 };
 
 PXR_NAMESPACE_CLOSE_SCOPE
\ No newline at end of file
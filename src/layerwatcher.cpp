@@ -0,0 +1,142 @@
+#include "layerwatcher.h"
+
+#include <pxr/base/tf/diagnostic.h>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+LayerWatcher::LayerWatcher() : _inotifyFd(-1)
+{
+#if defined(__linux__)
+    _inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (_inotifyFd < 0) TF_WARN("Cannot watch the layer files with inotify.");
+#endif
+}
+
+LayerWatcher::~LayerWatcher()
+{
+    _ClearWatches();
+#if defined(__linux__)
+    if (_inotifyFd >= 0) close(_inotifyFd);
+#endif
+}
+
+void LayerWatcher::SetLayers(const SdfLayerHandleVector& layers)
+{
+    _layers.clear();
+
+    vector<string> paths;
+    for (auto&& layer : layers) {
+        if (!layer || layer->IsAnonymous()) continue;
+
+        string path = layer->GetRealPath();
+        if (path.empty()) continue;
+
+        _layers[path] = layer;
+        paths.push_back(path);
+    }
+    _Watch(paths);
+}
+
+void LayerWatcher::SetPaths(const vector<string>& paths)
+{
+    _layers.clear();
+    _Watch(paths);
+}
+
+SdfLayerHandleVector LayerWatcher::GetChangedLayers()
+{
+    SdfLayerHandleVector layers;
+    for (auto&& path : GetChangedPaths()) {
+        auto it = _layers.find(path);
+        if (it != _layers.end() && it->second) layers.push_back(it->second);
+    }
+    return layers;
+}
+
+vector<string> LayerWatcher::GetChangedPaths()
+{
+    // a file written several times since the last call is reported once
+    set<string> changedPaths;
+
+#if defined(__linux__)
+    if (_inotifyFd < 0) return {};
+
+    alignas(inotify_event) char buffer[4096];
+    ssize_t length;
+    while ((length = read(_inotifyFd, buffer, sizeof(buffer))) > 0) {
+        for (char* p = buffer; p < buffer + length;) {
+            auto event = reinterpret_cast<inotify_event*>(p);
+            auto directory = _watchedDirectories.find(event->wd);
+            if (directory != _watchedDirectories.end() && event->len > 0) {
+                filesystem::path path =
+                    filesystem::path(directory->second) / event->name;
+                changedPaths.insert(path.string());
+            }
+            p += sizeof(inotify_event) + event->len;
+        }
+    }
+#else
+    auto now = chrono::steady_clock::now();
+    if (now - _lastPollTime < _POLL_INTERVAL) return {};
+    _lastPollTime = now;
+
+    error_code error;
+    for (auto&& it : _times) {
+        auto time = filesystem::last_write_time(it.first, error);
+        if (error || time == it.second) continue;
+
+        it.second = time;
+        changedPaths.insert(it.first);
+    }
+#endif
+
+    // the other files of the watched directories are ignored
+    vector<string> paths;
+    for (auto&& path : changedPaths) {
+        if (_paths.count(path)) paths.push_back(path);
+    }
+    return paths;
+}
+
+void LayerWatcher::_Watch(const vector<string>& paths)
+{
+    _ClearWatches();
+    _paths = set<string>(paths.begin(), paths.end());
+    _times.clear();
+
+#if defined(__linux__)
+    if (_inotifyFd < 0) return;
+
+    // a file replaced by a rename is only seen from its directory
+    set<string> directories;
+    for (auto&& path : _paths)
+        directories.insert(filesystem::path(path).parent_path().string());
+
+    for (auto&& directory : directories) {
+        int wd = inotify_add_watch(_inotifyFd, directory.c_str(),
+                                   IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (wd >= 0) _watchedDirectories[wd] = directory;
+    }
+#else
+    error_code error;
+    for (auto&& path : _paths)
+        _times[path] = filesystem::last_write_time(path, error);
+    _lastPollTime = chrono::steady_clock::now();
+#endif
+}
+
+void LayerWatcher::_ClearWatches()
+{
+#if defined(__linux__)
+    for (auto&& it : _watchedDirectories)
+        inotify_rm_watch(_inotifyFd, it.first);
+#endif
+    _watchedDirectories.clear();
+}
+
+PXR_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,103 @@
+/**
+ * @file layerwatcher.h
+ * @author Raphael Jouretz (rjouretz.com)
+ * @brief LayerWatcher reports the layers of a stage whose file changed on
+ * disk, so that they can be reloaded on their own.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <pxr/usd/sdf/layer.h>
+
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+using namespace std;
+
+/**
+ * @brief LayerWatcher reports the layers of a stage whose file changed on
+ * disk, so that they can be reloaded on their own.
+ *
+ * On Linux, the directories of the layers are watched with inotify, since
+ * most editors save a file by replacing it, which a watch on the file itself
+ * would not survive. On the other platforms, the modification times of the
+ * files are polled at most once per second.
+ */
+class LayerWatcher {
+    public:
+        /**
+         * @brief Construct a new LayerWatcher object
+         *
+         */
+        LayerWatcher();
+
+        /**
+         * @brief Destroy the LayerWatcher object, stops watching the layers
+         *
+         */
+        ~LayerWatcher();
+
+        /**
+         * @brief Set the layers to watch, the anonymous ones are ignored
+         *
+         * @param layers the layers to watch
+         */
+        void SetLayers(const SdfLayerHandleVector& layers);
+
+        /**
+         * @brief Set the files to watch, without layers, e.g. the layers a
+         * cached stage was flattened from
+         *
+         * @param paths the paths of the files to watch
+         */
+        void SetPaths(const vector<string>& paths);
+
+        /**
+         * @brief Get the layers whose file changed since the last call,
+         * without blocking
+         *
+         * @return the changed layers
+         */
+        SdfLayerHandleVector GetChangedLayers();
+
+        /**
+         * @brief Get the watched files that changed since the last call,
+         * without blocking
+         *
+         * @return the paths of the changed files
+         */
+        vector<string> GetChangedPaths();
+
+    private:
+        inline static const chrono::seconds _POLL_INTERVAL{1};
+
+        set<string> _paths;
+        map<string, SdfLayerHandle> _layers;
+        int _inotifyFd;
+        map<int, string> _watchedDirectories;
+        map<string, filesystem::file_time_type> _times;
+        chrono::steady_clock::time_point _lastPollTime;
+
+        /**
+         * @brief Watch the given files instead of the previous ones
+         *
+         * @param paths the paths of the files to watch
+         */
+        void _Watch(const vector<string>& paths);
+
+        /**
+         * @brief Stop watching the directories of the layers
+         *
+         */
+        void _ClearWatches();
+};
+
+PXR_NAMESPACE_CLOSE_SCOPE
@@ -9,28 +9,199 @@
 #include "models/model.h"
 #include "style/imgui_spectrum.h"
 #include "backends/backend.h"
+#include "engine.h"
+#include "stagediskcache.h"
+#include "recorders/inputrecorder.h"
+#include "recorders/inputreplayer.h"
+#include "recorders/noticereplayer.h"
 
+#include <pxr/base/tf/mallocTag.h>
+
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <mutex>
 
 static pxr::Model model;
 static pxr::MainWindow* mainWindow;
+static pxr::InputRecorder inputRecorder;
+static pxr::InputReplayer* inputReplayer = nullptr;
 
 /**
  * @brief The function called every frame by the backend.
  */
 void run()
 {
+    // the replayed inputs are queued after the ones polled by the backend
+    if (inputReplayer && !inputReplayer->BeginFrame()) CloseBackend();
+
     ImGui::NewFrame();
-    mainWindow->Update();
+    inputRecorder.RecordFrame();
+
+    // the render threads only sync the scene indices between two updates
+    {
+        std::lock_guard<std::mutex> lock(pxr::Engine::GetSceneMutex());
+        mainWindow->Update();
+    }
+
+    if (inputReplayer) {
+        for (auto view : mainWindow->GetViews())
+            inputReplayer->AddViewTime(view->GetViewLabel(),
+                                       view->GetLastUpdateTime());
+    }
+
     ImGui::Render();
 }
 
+/**
+ * @brief Print statistics of a series of times in milliseconds
+ *
+ * @param name the name of the times
+ * @param times the statistics of the times
+ */
+void printTimes(const std::string& name, const pxr::InputReplayTimes& times)
+{
+    std::cout << name << ": mean " << times.mean * 1000 << " ms, p95 "
+              << times.p95 * 1000 << " ms, max " << times.max * 1000
+              << " ms (" << times.count << " frames)" << std::endl;
+}
+
+/**
+ * @brief Print the measures of an input replay
+ *
+ * @param report the measures of the replay
+ */
+void printInputReport(const pxr::InputReplayReport& report)
+{
+    std::cout << "frames: " << report.frameCount << std::endl
+              << "frames with input: " << report.inputFrameCount
+              << std::endl
+              << "first frame time: " << report.firstFrameTime * 1000
+              << " ms" << std::endl;
+    printTimes("frame time", report.frameTimes);
+    printTimes("frame time with input", report.inputFrameTimes);
+
+    for (auto&& [label, times] : report.viewTimes) {
+        printTimes(label + " update time", times);
+        auto inputTimes = report.viewInputTimes.find(label);
+        if (inputTimes != report.viewInputTimes.end())
+            printTimes(label + " update time with input", inputTimes->second);
+    }
+}
+
+/**
+ * @brief Replay a notice file without showing the window and print the
+ * measures of the replay.
+ *
+ * @param replayFilePath the notice file to replay
+ * @param stageFilePath the stage to replay against, the recorded stage if
+ * null
+ * @param rendererPlugin the renderer plugin, the default one if null
+ * @param width the width of the render
+ * @param height the height of the render
+ * @return 0 if the replay ran, non zero otherwise
+ */
+int replay(const char* replayFilePath, const char* stageFilePath,
+           const char* rendererPlugin, int width, int height)
+{
+    pxr::NoticeReplayer replayer;
+    if (!replayer.Load(replayFilePath)) {
+        std::cerr << "Invalid notice file " << replayFilePath << std::endl;
+        return -1;
+    }
+
+    std::string stagePath =
+        stageFilePath ? stageFilePath : replayer.GetStageIdentifier();
+    pxr::TfToken plugin = rendererPlugin
+                              ? pxr::TfToken(rendererPlugin)
+                              : pxr::Engine::GetDefaultRendererPlugin();
+
+    pxr::NoticeReplayReport report =
+        replayer.Run(stagePath, plugin, width, height);
+    if (!report.isValid) {
+        std::cerr << "Cannot open the stage " << stagePath << std::endl;
+        return -1;
+    }
+
+    std::cout << "frames: " << report.frameCount << std::endl
+              << "viewports: " << report.viewportCount << std::endl
+              << "edits: " << report.editCount << std::endl
+              << "notices recorded: " << report.recordedNoticeCount
+              << std::endl
+              << "notices replayed: " << report.replayedNoticeCount
+              << std::endl
+              << "load time: " << report.loadTime << " s" << std::endl
+              << "first render time: " << report.firstRenderTime << " s"
+              << std::endl
+              << "edit time: " << report.editTime << " s" << std::endl
+              << "sync and render time: " << report.renderTime << " s"
+              << std::endl
+              << "max frame time: " << report.maxFrameTime << " s"
+              << std::endl;
+    return 0;
+}
+
 int main(int argc, const char** argv)
 {
+    const char* replayFilePath = nullptr;
+    const char* stageFilePath = nullptr;
+    const char* rendererPlugin = nullptr;
+    const char* recordInputFilePath = nullptr;
+    const char* replayInputFilePath = nullptr;
+    double fixedTimestep = 1.0 / 60.0;
+    const char* stageCacheDirectory = nullptr;
+    size_t stageCacheMegabytes = 4096;
+
+    for (int i = 1; i < argc; i++) {
+        // the USD allocations are only tracked from the initialization of
+        // the malloc tags, before any stage is loaded
+        if (strcmp(argv[i], "--malloc-tags") == 0) {
+            std::string errMsg;
+            if (!pxr::TfMallocTag::Initialize(&errMsg))
+                std::cerr << "Cannot track the USD memory: " << errMsg
+                          << std::endl;
+        }
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+            replayFilePath = argv[++i];
+        else if (strcmp(argv[i], "--stage") == 0 && i + 1 < argc)
+            stageFilePath = argv[++i];
+        else if (strcmp(argv[i], "--renderer") == 0 && i + 1 < argc)
+            rendererPlugin = argv[++i];
+        else if (strcmp(argv[i], "--record-input") == 0 && i + 1 < argc)
+            recordInputFilePath = argv[++i];
+        else if (strcmp(argv[i], "--replay-input") == 0 && i + 1 < argc)
+            replayInputFilePath = argv[++i];
+        else if (strcmp(argv[i], "--fixed-timestep") == 0 && i + 1 < argc)
+            fixedTimestep = atof(argv[++i]);
+        else if (strcmp(argv[i], "--render-thread") == 0)
+            pxr::Engine::SetRenderThreadEnabled(true);
+        else if (strcmp(argv[i], "--stage-cache") == 0 && i + 1 < argc)
+            stageCacheDirectory = argv[++i];
+        else if (strcmp(argv[i], "--stage-cache-size") == 0 && i + 1 < argc)
+            stageCacheMegabytes = strtoull(argv[++i], nullptr, 10);
+    }
+
+    if (stageCacheDirectory)
+        pxr::StageDiskCache::Enable(stageCacheDirectory,
+                                    stageCacheMegabytes << 20);
+
     const char* TITLE = "ImGui Hydra Editor";
     int WIDTH = 1280;
     int HEIGHT = 720;
 
+    // an input replay runs in a window of the recorded size
+    pxr::InputReplayer replayer(fixedTimestep);
+    if (replayInputFilePath) {
+        if (!replayer.Load(replayInputFilePath)) {
+            std::cerr << "Invalid input file " << replayInputFilePath
+                      << std::endl;
+            return -1;
+        }
+        inputReplayer = &replayer;
+        WIDTH = int(replayer.GetDisplaySize().x);
+        HEIGHT = int(replayer.GetDisplaySize().y);
+    }
+
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO(); (void)io;
@@ -38,19 +209,46 @@ int main(int argc, const char** argv)
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableGamepad;      // Enable Gamepad Controls
     io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
 
-    if (InitBackend(TITLE, WIDTH, HEIGHT) != 0)
+    // a replay only needs the graphics context of the window
+    if (InitBackend(TITLE, WIDTH, HEIGHT, !replayFilePath) != 0)
     {
         std::cerr << "Error while initializing backend; exiting." << std::endl;
         return -1;
     }
 
+    if (replayFilePath) {
+        int result = replay(replayFilePath, stageFilePath, rendererPlugin,
+                            WIDTH, HEIGHT);
+        pxr::StageDiskCache::Shutdown();
+        ShutdownBackend();
+        return result;
+    }
+
     ImGui::Spectrum::StyleColorsSpectrum();
-    LoadDefaultOrCustomLayout();
+    if (inputReplayer) inputReplayer->ApplyLayout();
+    else LoadDefaultOrCustomLayout();
+
+    if (recordInputFilePath && !inputRecorder.Start(recordInputFilePath)) {
+        std::cerr << "Cannot record the inputs to " << recordInputFilePath
+                  << std::endl;
+        ShutdownBackend();
+        return -1;
+    }
 
     mainWindow = new pxr::MainWindow(&model); 
 
     RunBackend(run);
 
+    inputRecorder.Stop();
+    if (inputReplayer) printInputReport(inputReplayer->GetReport());
+
+    // the engines join their render threads while the GL context and the
+    // model still exist
+    delete mainWindow;
+    mainWindow = nullptr;
+
+    // the stage being cached is not waited for by the static destruction
+    pxr::StageDiskCache::Shutdown();
     ShutdownBackend();
 
     return 0;
@@ -1,14 +1,18 @@
 #include "mainwindow.h"
 
+#include <ImGuiFileDialog.h>
 #include <imgui.h>
+#include <pxr/usd/usd/stage.h>
 
 #include "views/editor.h"
+#include "views/memoryview.h"
 #include "views/outliner.h"
 #include "views/usdsessionlayer.h"
 #include "views/view.h"
 #include "views/viewport.h"
 #include "views/sceneindexview.h"
 #include "views/sceneindexattribute.h"
+#include "views/timeline.h"
 
 #include <iostream>
 
@@ -19,6 +23,12 @@ MainWindow::MainWindow(Model* model) : _model(model)
     ResetDefaultViews();
 };
 
+MainWindow::~MainWindow()
+{
+    for (auto view : _views) { delete view; }
+    _views.clear();
+}
+
 void MainWindow::Update()
 {
     ImGui::DockSpaceOverViewport();
@@ -38,12 +48,20 @@ void MainWindow::Update()
                     AddView(SceneIndexView::VIEW_TYPE);
                 if (ImGui::MenuItem(SceneIndexAttribute::VIEW_TYPE.c_str()))
                     AddView(SceneIndexAttribute::VIEW_TYPE);
+                if (ImGui::MenuItem(Timeline::VIEW_TYPE.c_str()))
+                    AddView(Timeline::VIEW_TYPE);
+                if (ImGui::MenuItem(MemoryView::VIEW_TYPE.c_str()))
+                    AddView(MemoryView::VIEW_TYPE);
 
                 ImGui::EndMenu();
             }
             if (ImGui::MenuItem("Default views")) ResetDefaultViews();
             ImGui::EndMenu();
         }
+        if (ImGui::BeginMenu("Record")) {
+            _DrawRecordMenu();
+            ImGui::EndMenu();
+        }
 
         ImGui::EndMainMenuBar();
     }
@@ -56,6 +74,11 @@ void MainWindow::Update()
         if (view->IsDisplayed()) _views.push_back(view);
         else delete view;
     }
+
+    _DrawRecordFileDialog();
+
+    // the edits of the views are replayed frame by frame
+    _model->GetRecorder()->RecordFrame();
 }
 
 void MainWindow::ResetDefaultViews()
@@ -110,6 +133,48 @@ void MainWindow::AddView(const string viewType)
     else if (viewType == SceneIndexAttribute::VIEW_TYPE) {
         _views.push_back(new SceneIndexAttribute(_model, viewLabel));
     }
+    else if (viewType == Timeline::VIEW_TYPE) {
+        _views.push_back(new Timeline(_model, viewLabel));
+    }
+    else if (viewType == MemoryView::VIEW_TYPE) {
+        _views.push_back(new MemoryView(_model, viewLabel));
+    }
+}
+
+const vector<View*>& MainWindow::GetViews()
+{
+    return _views;
+}
+
+void MainWindow::_DrawRecordMenu()
+{
+    NoticeRecorder* recorder = _model->GetRecorder();
+    if (!recorder->IsRecording()) {
+        if (ImGui::MenuItem("Start Recording ...")) {
+            ImGuiFileDialog::Instance()->OpenDialog(
+                "RecordFile", "Choose File", ".hdrec", ".");
+        }
+        return;
+    }
+
+    if (ImGui::MenuItem("Stop Recording")) recorder->Stop();
+    ImGui::TextDisabled("%zu records", recorder->GetRecordCount());
+}
+
+void MainWindow::_DrawRecordFileDialog()
+{
+    if (!ImGuiFileDialog::Instance()->Display("RecordFile")) return;
+
+    if (ImGuiFileDialog::Instance()->IsOk()) {
+        string filePath = ImGuiFileDialog::Instance()->GetFilePathName();
+        UsdStageRefPtr stage = _model->GetStage();
+        string stageIdentifier =
+            stage ? stage->GetRootLayer()->GetIdentifier() : "";
+        if (!_model->GetRecorder()->Start(
+                filePath, _model->GetFinalSceneIndex(), stageIdentifier))
+            TF_RUNTIME_ERROR("Cannot record to %s", filePath.c_str());
+    }
+    ImGuiFileDialog::Instance()->Close();
 }
 
 PXR_NAMESPACE_CLOSE_SCOPE
@@ -32,6 +32,13 @@ class MainWindow {
          */
         MainWindow(Model* model);
 
+        /**
+         * @brief Destroy the Main Window object and its views, joining the
+         * render threads of their engines
+         *
+         */
+        ~MainWindow();
+
         /**
          * @brief Update the draw call of the main window
          *
@@ -53,9 +60,29 @@ class MainWindow {
          */
         void AddView(const string viewType);
 
+        /**
+         * @brief Get the views of the main window
+         *
+         * @return the views
+         */
+        const vector<View*>& GetViews();
+
     private:
         vector<View*> _views;
         Model* _model;
+
+        /**
+         * @brief Draw the menu starting and stopping the recording of the
+         * notices and edits
+         *
+         */
+        void _DrawRecordMenu();
+
+        /**
+         * @brief Draw the file dialog choosing the notice file to record to
+         *
+         */
+        void _DrawRecordFileDialog();
 };
 
 PXR_NAMESPACE_CLOSE_SCOPE
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include "memorysampler.h"
+
+#include <pxr/base/tf/mallocTag.h>
+#include <pxr/imaging/hd/filteringSceneIndex.h>
+
+#include <algorithm>
+#include <fstream>
+
+#include "engine.h"
+#include "sceneindices/colorfiltersceneindex.h"
+#include "sceneindices/lodsceneindex.h"
+#include "sceneindices/sampledvaluecachesceneindex.h"
+#include "sceneindices/xformfiltersceneindex.h"
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+MemorySampler::MemorySampler(Model* model) : _model(model) {}
+
+const MemorySample& MemorySampler::Sample(double time)
+{
+    MemorySample sample;
+    sample.time = time;
+
+    _SampleUsd(&sample);
+
+    set<HdSceneIndexBase*> visited;
+    _SampleSceneIndex(_model->GetFinalSceneIndex(), "", &visited, &sample);
+    _SampleEngines(&visited, &sample);
+
+    for (auto&& it : sample.bytes) {
+        if (find(_keys.begin(), _keys.end(), it.first) == _keys.end())
+            _keys.push_back(it.first);
+    }
+
+    if (_samples.size() >= _MAX_SAMPLES) _samples.erase(_samples.begin());
+    _samples.push_back(move(sample));
+    return _samples.back();
+}
+
+const vector<MemorySample>& MemorySampler::GetSamples() const
+{
+    return _samples;
+}
+
+const vector<string>& MemorySampler::GetKeys() const
+{
+    return _keys;
+}
+
+void MemorySampler::Clear()
+{
+    _samples.clear();
+    _keys.clear();
+}
+
+bool MemorySampler::ExportCsv(const string& filePath) const
+{
+    ofstream file(filePath);
+    if (!file) return false;
+
+    file << "time";
+    for (auto&& key : _keys) file << "," << key;
+    file << "\n";
+
+    for (auto&& sample : _samples) {
+        file << sample.time;
+        for (auto&& key : _keys) {
+            auto it = sample.bytes.find(key);
+            file << "," << (it != sample.bytes.end() ? it->second : 0);
+        }
+        file << "\n";
+    }
+    return bool(file);
+}
+
+bool MemorySampler::IsMallocTagEnabled()
+{
+    return TfMallocTag::IsInitialized();
+}
+
+void MemorySampler::_SampleUsd(MemorySample* sample)
+{
+    if (!IsMallocTagEnabled()) return;
+
+    sample->bytes["USD/Total"] = TfMallocTag::GetTotalBytes();
+
+    // the first level of the call tree splits the memory by tagged site
+    // (stage, layers, value resolution, ...)
+    TfMallocTag::CallTree tree;
+    if (!TfMallocTag::GetCallTree(&tree, false)) return;
+    for (auto&& child : tree.root.children)
+        sample->bytes["USD/" + child.siteName] += child.nBytes;
+}
+
+void MemorySampler::_SampleSceneIndex(HdSceneIndexBaseRefPtr sceneIndex,
+                                      const string& suffix,
+                                      set<HdSceneIndexBase*>* visited,
+                                      MemorySample* sample)
+{
+    if (!sceneIndex || !visited->insert(get_pointer(sceneIndex)).second)
+        return;
+
+    size_t bytes = 0;
+    bool hasMemory = true;
+    if (auto xformFilter =
+            TfDynamic_cast<XformFilterSceneIndexRefPtr>(sceneIndex))
+        bytes = xformFilter->GetMemoryUsage();
+    else if (auto colorFilter =
+                 TfDynamic_cast<ColorFilterSceneIndexRefPtr>(sceneIndex))
+        bytes = colorFilter->GetMemoryUsage();
+    else if (auto cache =
+                 TfDynamic_cast<SampledValueCacheSceneIndexRefPtr>(sceneIndex))
+        bytes = cache->GetMemoryUsage();
+    else if (auto lod = TfDynamic_cast<LodSceneIndexRefPtr>(sceneIndex))
+        bytes = lod->GetCacheMemoryUsage();
+    else hasMemory = false;
+
+    if (hasMemory) {
+        string name = sceneIndex->GetDisplayName() + suffix;
+        sample->bytes["Scene Indices/" + name] = bytes;
+    }
+
+    auto filtering = TfDynamic_cast<HdFilteringSceneIndexBaseRefPtr>(sceneIndex);
+    if (!filtering) return;
+    for (auto&& input : filtering->GetInputScenes())
+        _SampleSceneIndex(input, suffix, visited, sample);
+}
+
+void MemorySampler::_SampleEngines(set<HdSceneIndexBase*>* visited,
+                                   MemorySample* sample)
+{
+    vector<Engine*> engines = Engine::GetInstances();
+    for (size_t i = 0; i < engines.size(); i++) {
+        // the culling and the lod are created by each viewport on top of the
+        // shared scene indices, already sampled, and are told apart by the
+        // engine rendering them
+        _SampleSceneIndex(engines[i]->GetSceneIndex(),
+                          " (Engine " + to_string(i + 1) + ")", visited,
+                          sample);
+
+        EngineMemoryStats stats = engines[i]->GetMemoryStats();
+        string prefix = "Engine " + to_string(i + 1) + "/";
+        sample->bytes[prefix + "Present Buffer"] = stats.presentBufferMemory;
+        sample->bytes[prefix + "Render Buffers"] = stats.renderBufferMemory;
+        sample->bytes[prefix + "GPU Memory"] = stats.gpuMemory;
+        sample->bytes[prefix + "Textures"] = stats.textureMemory;
+    }
+}
+
+PXR_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,138 @@
+/**
+ * @file memorysampler.h
+ * @author Raphael Jouretz (rjouretz.com)
+ * @brief MemorySampler records the memory used by the USD stage, the scene
+ * indices and the engines over time.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <pxr/imaging/hd/sceneIndex.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "models/model.h"
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+using namespace std;
+
+/**
+ * @brief The memory used at a given time
+ *
+ * @param time the time of the sample in seconds
+ * @param bytes the memory used in bytes, keyed by "category/name"
+ */
+struct MemorySample {
+    double time;
+    map<string, size_t> bytes;
+};
+
+/**
+ * @brief MemorySampler records the memory used by the USD stage, the scene
+ * indices and the engines over time.
+ *
+ * The USD memory is only known when TfMallocTag is initialized, which must
+ * happen before the stage is loaded (see the --malloc-tags option). The
+ * scene indices are found by walking the inputs of the final scene index of
+ * the model, the engines are all the engines alive.
+ */
+class MemorySampler {
+    public:
+        /**
+         * @brief Construct a new MemorySampler object
+         *
+         * @param model the Model to sample the memory of
+         */
+        MemorySampler(Model* model);
+
+        /**
+         * @brief Record the memory used now
+         *
+         * @param time the time of the sample in seconds
+         * @return the recorded sample
+         */
+        const MemorySample& Sample(double time);
+
+        /**
+         * @brief Get the recorded samples, the oldest are dropped beyond the
+         * maximum number of samples
+         *
+         * @return the samples, oldest first
+         */
+        const vector<MemorySample>& GetSamples() const;
+
+        /**
+         * @brief Get the keys of every recorded sample, in the order they
+         * first appeared
+         *
+         * @return the keys of the samples
+         */
+        const vector<string>& GetKeys() const;
+
+        /**
+         * @brief Drop the recorded samples
+         *
+         */
+        void Clear();
+
+        /**
+         * @brief Write the recorded samples to a CSV file, one sample per
+         * row and one key per column
+         *
+         * @param filePath the path of the CSV file
+         * @return true if the file was written, false otherwise
+         */
+        bool ExportCsv(const string& filePath) const;
+
+        /**
+         * @brief Check if the USD memory can be sampled
+         *
+         * @return true if TfMallocTag is initialized
+         */
+        static bool IsMallocTagEnabled();
+
+    private:
+        const size_t _MAX_SAMPLES = 3600;
+
+        Model* _model;
+        vector<MemorySample> _samples;
+        vector<string> _keys;
+
+        /**
+         * @brief Sample the memory tracked by TfMallocTag
+         *
+         * @param sample the sample to fill
+         */
+        void _SampleUsd(MemorySample* sample);
+
+        /**
+         * @brief Sample the memory of a scene index and of its inputs
+         *
+         * @param sceneIndex the scene index to sample
+         * @param suffix the suffix of the names of the sampled scene indices
+         * @param visited the scene indices already sampled
+         * @param sample the sample to fill
+         */
+        void _SampleSceneIndex(HdSceneIndexBaseRefPtr sceneIndex,
+                               const string& suffix,
+                               set<HdSceneIndexBase*>* visited,
+                               MemorySample* sample);
+
+        /**
+         * @brief Sample the memory of the engines and of the filters of
+         * their viewport
+         *
+         * @param visited the scene indices already sampled
+         * @param sample the sample to fill
+         */
+        void _SampleEngines(set<HdSceneIndexBase*>* visited,
+                            MemorySample* sample);
+};
+
+PXR_NAMESPACE_CLOSE_SCOPE
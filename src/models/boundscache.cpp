@@ -0,0 +1,205 @@
+#include "boundscache.h"
+
+#include <pxr/base/work/loops.h>
+#include <pxr/imaging/hd/extentSchema.h>
+#include <pxr/imaging/hd/sceneIndexPrimView.h>
+#include <pxr/imaging/hd/xformSchema.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "sceneindices/cullingsceneindex.h"
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+BoundsCache::BoundsCache() : _sceneIndex(nullptr) {}
+
+BoundsCache::~BoundsCache()
+{
+    SetSceneIndex(nullptr);
+}
+
+void BoundsCache::SetSceneIndex(HdSceneIndexBaseRefPtr sceneIndex)
+{
+    if (sceneIndex == _sceneIndex) return;
+
+    if (_sceneIndex)
+        _sceneIndex->RemoveObserver(HdSceneIndexObserverPtr(this));
+
+    _entries.clear();
+    _sceneIndex = sceneIndex;
+
+    if (_sceneIndex) _sceneIndex->AddObserver(HdSceneIndexObserverPtr(this));
+}
+
+GfMatrix4d BoundsCache::GetWorldXform(const SdfPath& primPath)
+{
+    auto it = _entries.find(primPath);
+    if (it != _entries.end() && it->second.hasXform) return it->second.xform;
+    if (!_sceneIndex) return GfMatrix4d(1);
+
+    _Entry& entry = _entries[primPath];
+    entry.xform = _ReadXform(_sceneIndex->GetPrim(primPath));
+    entry.hasXform = true;
+    return entry.xform;
+}
+
+GfRange3d BoundsCache::GetSubtreeBound(const SdfPath& primPath)
+{
+    auto it = _entries.find(primPath);
+    if (it != _entries.end() && it->second.hasBound) return it->second.bound;
+    if (!_sceneIndex) return GfRange3d();
+
+    return _ComputeSubtreeBound(primPath);
+}
+
+void BoundsCache::PrimsAdded(const HdSceneIndexBase& sender,
+                             const AddedPrimEntries& entries)
+{
+    if (_entries.empty()) return;
+
+    // the descendants of a resynced prim are added as well
+    for (auto&& entry : entries) {
+        auto it = _entries.find(entry.primPath);
+        if (it != _entries.end()) it->second.hasXform = false;
+        _InvalidateBounds(entry.primPath);
+    }
+}
+
+void BoundsCache::PrimsRemoved(const HdSceneIndexBase& sender,
+                               const RemovedPrimEntries& entries)
+{
+    if (_entries.empty()) return;
+
+    // only the root of a removed subtree is notified, its descendants are
+    // erased with it
+    for (auto&& entry : entries) {
+        _EraseSubtree(entry.primPath);
+        _InvalidateBounds(entry.primPath.GetParentPath());
+    }
+}
+
+void BoundsCache::PrimsDirtied(const HdSceneIndexBase& sender,
+                               const DirtiedPrimEntries& entries)
+{
+    if (_entries.empty()) return;
+
+    static const HdDataSourceLocatorSet boundLocators{
+        HdXformSchema::GetDefaultLocator(),
+        HdExtentSchema::GetDefaultLocator()};
+
+    // the xforms are flattened, a moved prim dirties its descendants too
+    for (auto&& entry : entries) {
+        if (!entry.dirtyLocators.Intersects(boundLocators)) continue;
+
+        const HdDataSourceLocator& xformLocator =
+            HdXformSchema::GetDefaultLocator();
+        if (entry.dirtyLocators.Intersects(xformLocator)) {
+            auto it = _entries.find(entry.primPath);
+            if (it != _entries.end()) it->second.hasXform = false;
+        }
+        _InvalidateBounds(entry.primPath);
+    }
+}
+
+void BoundsCache::PrimsRenamed(const HdSceneIndexBase& sender,
+                               const RenamedPrimEntries& entries)
+{
+    for (auto&& entry : entries) {
+        _EraseSubtree(entry.oldPrimPath);
+        _EraseSubtree(entry.newPrimPath);
+        _InvalidateBounds(entry.oldPrimPath.GetParentPath());
+        _InvalidateBounds(entry.newPrimPath.GetParentPath());
+    }
+}
+
+void BoundsCache::_InvalidateBounds(const SdfPath& primPath)
+{
+    for (SdfPath path = primPath; !path.IsEmpty();
+         path = path.GetParentPath()) {
+        auto it = _entries.find(path);
+        if (it != _entries.end()) it->second.hasBound = false;
+    }
+}
+
+void BoundsCache::_EraseSubtree(const SdfPath& primPath)
+{
+    // the paths are ordered, the descendants follow their ancestor
+    auto it = _entries.lower_bound(primPath);
+    while (it != _entries.end() && it->first.HasPrefix(primPath))
+        it = _entries.erase(it);
+}
+
+GfRange3d BoundsCache::_ComputeSubtreeBound(const SdfPath& primPath)
+{
+    // the subtree is flattened in depth first order, the cached subtrees
+    // are not traversed
+    SdfPathVector paths;
+    vector<size_t> parents;
+    vector<GfRange3d> bounds;
+    vector<char> isCached;
+    unordered_map<SdfPath, size_t, SdfPath::Hash> indices;
+
+    HdSceneIndexPrimView view(_sceneIndex, primPath);
+    for (auto it = view.begin(); it != view.end(); ++it) {
+        const SdfPath& path = *it;
+        size_t index = paths.size();
+        indices[path] = index;
+        paths.push_back(path);
+        parents.push_back(index == 0 ? 0 : indices[path.GetParentPath()]);
+
+        auto entry = index == 0 ? _entries.end() : _entries.find(path);
+        if (entry != _entries.end() && entry->second.hasBound) {
+            bounds.push_back(entry->second.bound);
+            isCached.push_back(1);
+            it.SkipDescendants();
+        }
+        else {
+            bounds.push_back(GfRange3d());
+            isCached.push_back(0);
+        }
+    }
+
+    if (paths.empty()) return GfRange3d();
+
+    // the prims are read in parallel, the scene index is not edited meanwhile
+    vector<GfMatrix4d> xforms(paths.size());
+    WorkParallelForN(paths.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            if (isCached[i]) continue;
+
+            HdSceneIndexPrim prim = _sceneIndex->GetPrim(paths[i]);
+            xforms[i] = _ReadXform(prim);
+
+            GfRange3d bound;
+            if (CullingSceneIndex::ComputeWorldBound(prim, &bound))
+                bounds[i] = bound;
+        }
+    });
+
+    // the children come after their parent, the bounds are merged upwards
+    for (size_t i = paths.size() - 1; i > 0; i--)
+        bounds[parents[i]].UnionWith(bounds[i]);
+
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (isCached[i]) continue;
+
+        _Entry& entry = _entries[paths[i]];
+        entry.xform = xforms[i];
+        entry.bound = bounds[i];
+        entry.hasXform = true;
+        entry.hasBound = true;
+    }
+    return bounds[0];
+}
+
+GfMatrix4d BoundsCache::_ReadXform(const HdSceneIndexPrim& prim)
+{
+    HdXformSchema xformSchema = HdXformSchema::GetFromParent(prim.dataSource);
+    if (!xformSchema.GetMatrix()) return GfMatrix4d(1);
+
+    HdSampledDataSource::Time time(0);
+    return xformSchema.GetMatrix()->GetTypedValue(time);
+}
+
+PXR_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,147 @@
+/**
+ * @file boundscache.h
+ * @author Raphael Jouretz (rjouretz.com)
+ * @brief BoundsCache keeps the world space xforms and subtree bounds of the
+ * prims of a scene index, invalidated by the notices of the scene index.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <pxr/base/gf/matrix4d.h>
+#include <pxr/base/gf/range3d.h>
+#include <pxr/imaging/hd/sceneIndex.h>
+#include <pxr/imaging/hd/sceneIndexObserver.h>
+#include <pxr/usd/sdf/path.h>
+
+#include <map>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+using namespace std;
+
+/**
+ * @brief BoundsCache keeps the world space xforms and subtree bounds of the
+ * prims of a scene index, invalidated by the notices of the scene index.
+ *
+ * The bounds of a subtree are the union of the world space extents of the
+ * prims below it, so that prims without an extent (e.g. Xforms) have bounds
+ * too. A subtree is traversed once, the prims of its uncached part are read
+ * in parallel and their bounds are kept, so that a later edit only
+ * recomputes the bounds along the path to the edited prim.
+ */
+class BoundsCache : public HdSceneIndexObserver {
+    public:
+        /**
+         * @brief Construct a new BoundsCache object
+         *
+         */
+        BoundsCache();
+
+        /**
+         * @brief Destroy the BoundsCache object, stops observing the scene
+         * index
+         *
+         */
+        ~BoundsCache();
+
+        /**
+         * @brief Set the scene index the prims are read from, clears the
+         * cache
+         *
+         * @param sceneIndex the scene index to observe
+         */
+        void SetSceneIndex(HdSceneIndexBaseRefPtr sceneIndex);
+
+        /**
+         * @brief Get the world space xform of a prim
+         *
+         * @param primPath the path of the prim
+         * @return the xform, identity if the prim has none
+         */
+        GfMatrix4d GetWorldXform(const SdfPath& primPath);
+
+        /**
+         * @brief Get the world space bounds of a prim and its descendants
+         *
+         * @param primPath the root path of the subtree
+         * @return the aligned bounds, empty if no prim of the subtree has an
+         * extent
+         */
+        GfRange3d GetSubtreeBound(const SdfPath& primPath);
+
+        /**
+         * @brief Override of HdSceneIndexObserver::PrimsAdded
+         */
+        void PrimsAdded(const HdSceneIndexBase& sender,
+                        const AddedPrimEntries& entries) override;
+
+        /**
+         * @brief Override of HdSceneIndexObserver::PrimsRemoved
+         */
+        void PrimsRemoved(const HdSceneIndexBase& sender,
+                          const RemovedPrimEntries& entries) override;
+
+        /**
+         * @brief Override of HdSceneIndexObserver::PrimsDirtied
+         */
+        void PrimsDirtied(const HdSceneIndexBase& sender,
+                          const DirtiedPrimEntries& entries) override;
+
+        /**
+         * @brief Override of HdSceneIndexObserver::PrimsRenamed
+         */
+        void PrimsRenamed(const HdSceneIndexBase& sender,
+                          const RenamedPrimEntries& entries) override;
+
+    private:
+        /**
+         * @brief The cached state of a prim
+         *
+         * @param xform the world space xform
+         * @param bound the world space bounds of the subtree
+         * @param hasXform true if the xform is up to date
+         * @param hasBound true if the bounds are up to date
+         */
+        struct _Entry {
+            GfMatrix4d xform;
+            GfRange3d bound;
+            bool hasXform = false, hasBound = false;
+        };
+
+        HdSceneIndexBaseRefPtr _sceneIndex;
+        map<SdfPath, _Entry> _entries;
+
+        /**
+         * @brief Invalidate the bounds of a prim and of its ancestors
+         *
+         * @param primPath the path of the prim
+         */
+        void _InvalidateBounds(const SdfPath& primPath);
+
+        /**
+         * @brief Erase the entries of a prim and of its descendants
+         *
+         * @param primPath the root path of the subtree
+         */
+        void _EraseSubtree(const SdfPath& primPath);
+
+        /**
+         * @brief Compute and cache the bounds of a subtree not cached yet
+         *
+         * @param primPath the root path of the subtree
+         * @return the aligned bounds of the subtree
+         */
+        GfRange3d _ComputeSubtreeBound(const SdfPath& primPath);
+
+        /**
+         * @brief Read the world space xform of a prim
+         *
+         * @param prim the prim
+         * @return the xform, identity if the prim has none
+         */
+        static GfMatrix4d _ReadXform(const HdSceneIndexPrim& prim);
+};
+
+PXR_NAMESPACE_CLOSE_SCOPE
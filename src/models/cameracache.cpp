@@ -0,0 +1,132 @@
+#include "cameracache.h"
+
+#include <pxr/imaging/hd/cameraSchema.h>
+#include <pxr/imaging/hd/tokens.h>
+#include <pxr/imaging/hd/xformSchema.h>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+CameraCache::CameraCache() : _sceneIndex(nullptr) {}
+
+CameraCache::~CameraCache()
+{
+    SetSceneIndex(nullptr);
+}
+
+void CameraCache::SetSceneIndex(HdSceneIndexBaseRefPtr sceneIndex)
+{
+    if (sceneIndex == _sceneIndex) return;
+
+    if (_sceneIndex)
+        _sceneIndex->RemoveObserver(HdSceneIndexObserverPtr(this));
+
+    _cameras.clear();
+    _sceneIndex = sceneIndex;
+
+    if (_sceneIndex) _sceneIndex->AddObserver(HdSceneIndexObserverPtr(this));
+}
+
+shared_ptr<const GfCamera> CameraCache::GetCamera(const SdfPath& primPath)
+{
+    auto it = _cameras.find(primPath);
+    if (it != _cameras.end()) return it->second;
+
+    GfCamera camera;
+    if (_sceneIndex) camera = _ToGfCamera(_sceneIndex->GetPrim(primPath));
+
+    auto cached = make_shared<const GfCamera>(camera);
+    _cameras[primPath] = cached;
+    return cached;
+}
+
+void CameraCache::PrimsAdded(const HdSceneIndexBase& sender,
+                             const AddedPrimEntries& entries)
+{
+    // a prim added again may have changed its type
+    for (auto&& entry : entries) _cameras.erase(entry.primPath);
+}
+
+void CameraCache::PrimsRemoved(const HdSceneIndexBase& sender,
+                               const RemovedPrimEntries& entries)
+{
+    for (auto&& entry : entries) _Invalidate(entry.primPath);
+}
+
+void CameraCache::PrimsDirtied(const HdSceneIndexBase& sender,
+                               const DirtiedPrimEntries& entries)
+{
+    if (_cameras.empty()) return;
+
+    static const HdDataSourceLocatorSet cameraLocators{
+        HdXformSchema::GetDefaultLocator(),
+        HdCameraSchema::GetDefaultLocator()};
+
+    for (auto&& entry : entries) {
+        if (entry.dirtyLocators.Intersects(cameraLocators))
+            _cameras.erase(entry.primPath);
+    }
+}
+
+void CameraCache::PrimsRenamed(const HdSceneIndexBase& sender,
+                               const RenamedPrimEntries& entries)
+{
+    for (auto&& entry : entries) {
+        _Invalidate(entry.oldPrimPath);
+        _Invalidate(entry.newPrimPath);
+    }
+}
+
+void CameraCache::_Invalidate(const SdfPath& primPath)
+{
+    auto it = _cameras.begin();
+    while (it != _cameras.end()) {
+        if (it->first.HasPrefix(primPath)) it = _cameras.erase(it);
+        else ++it;
+    }
+}
+
+GfCamera CameraCache::_ToGfCamera(HdSceneIndexPrim prim)
+{
+    GfCamera cam;
+
+    if (prim.primType != HdPrimTypeTokens->camera) return cam;
+
+    HdSampledDataSource::Time time(0);
+
+    HdXformSchema xformSchema = HdXformSchema::GetFromParent(prim.dataSource);
+
+    GfMatrix4d xform =
+        xformSchema.GetMatrix()->GetValue(time).Get<GfMatrix4d>();
+
+    HdCameraSchema camSchema = HdCameraSchema::GetFromParent(prim.dataSource);
+
+    TfToken projection =
+        camSchema.GetProjection()->GetValue(time).Get<TfToken>();
+    float hAperture =
+        camSchema.GetHorizontalAperture()->GetValue(time).Get<float>();
+    float vAperture =
+        camSchema.GetVerticalAperture()->GetValue(time).Get<float>();
+    float hApertureOffest =
+        camSchema.GetHorizontalApertureOffset()->GetValue(time).Get<float>();
+    float vApertureOffest =
+        camSchema.GetVerticalApertureOffset()->GetValue(time).Get<float>();
+    float focalLength =
+        camSchema.GetFocalLength()->GetValue(time).Get<float>();
+    GfVec2f clippingRange =
+        camSchema.GetClippingRange()->GetValue(time).Get<GfVec2f>();
+
+    cam.SetTransform(xform);
+    cam.SetProjection(projection == HdCameraSchemaTokens->orthographic
+                          ? GfCamera::Orthographic
+                          : GfCamera::Perspective);
+    cam.SetHorizontalAperture(hAperture / GfCamera::APERTURE_UNIT);
+    cam.SetVerticalAperture(vAperture / GfCamera::APERTURE_UNIT);
+    cam.SetHorizontalApertureOffset(hApertureOffest / GfCamera::APERTURE_UNIT);
+    cam.SetVerticalApertureOffset(vApertureOffest / GfCamera::APERTURE_UNIT);
+    cam.SetFocalLength(focalLength / GfCamera::FOCAL_LENGTH_UNIT);
+    cam.SetClippingRange(GfRange1f(clippingRange[0], clippingRange[1]));
+
+    return cam;
+}
+
+PXR_NAMESPACE_CLOSE_SCOPE
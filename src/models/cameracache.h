@@ -0,0 +1,111 @@
+/**
+ * @file cameracache.h
+ * @author Raphael Jouretz (rjouretz.com)
+ * @brief CameraCache keeps the GfCamera of the cameras of a scene index,
+ * invalidated by the notices of the scene index, so that the viewports
+ * following a camera do not query the scene index every frame.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <pxr/base/gf/camera.h>
+#include <pxr/imaging/hd/sceneIndex.h>
+#include <pxr/imaging/hd/sceneIndexObserver.h>
+
+#include <memory>
+#include <unordered_map>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+using namespace std;
+
+/**
+ * @brief CameraCache keeps the GfCamera of the cameras of a scene index,
+ * invalidated by the notices of the scene index, so that the viewports
+ * following a camera do not query the scene index every frame.
+ *
+ * A camera is built from the scene index on the first request after its
+ * xform or camera data source is dirtied, and shared by every viewport
+ * following it. A new GfCamera is allocated on each rebuild, so that a
+ * viewport detects a change with a pointer compare.
+ */
+class CameraCache : public HdSceneIndexObserver {
+    public:
+        /**
+         * @brief Construct a new CameraCache object
+         *
+         */
+        CameraCache();
+
+        /**
+         * @brief Destroy the CameraCache object, stops observing the scene
+         * index
+         *
+         */
+        ~CameraCache();
+
+        /**
+         * @brief Set the scene index the cameras are read from, clears the
+         * cache
+         *
+         * @param sceneIndex the scene index to observe
+         */
+        void SetSceneIndex(HdSceneIndexBaseRefPtr sceneIndex);
+
+        /**
+         * @brief Get the camera of a prim, built from the scene index if it
+         * is not cached yet
+         *
+         * @param primPath the path of the camera prim
+         * @return the camera, a default one if the prim is not a camera
+         */
+        shared_ptr<const GfCamera> GetCamera(const SdfPath& primPath);
+
+        /**
+         * @brief Override of HdSceneIndexObserver::PrimsAdded
+         */
+        void PrimsAdded(const HdSceneIndexBase& sender,
+                        const AddedPrimEntries& entries) override;
+
+        /**
+         * @brief Override of HdSceneIndexObserver::PrimsRemoved
+         */
+        void PrimsRemoved(const HdSceneIndexBase& sender,
+                          const RemovedPrimEntries& entries) override;
+
+        /**
+         * @brief Override of HdSceneIndexObserver::PrimsDirtied
+         */
+        void PrimsDirtied(const HdSceneIndexBase& sender,
+                          const DirtiedPrimEntries& entries) override;
+
+        /**
+         * @brief Override of HdSceneIndexObserver::PrimsRenamed
+         */
+        void PrimsRenamed(const HdSceneIndexBase& sender,
+                          const RenamedPrimEntries& entries) override;
+
+    private:
+        HdSceneIndexBaseRefPtr _sceneIndex;
+        unordered_map<SdfPath, shared_ptr<const GfCamera>, SdfPath::Hash>
+            _cameras;
+
+        /**
+         * @brief Remove the cached cameras at or below a path
+         *
+         * @param primPath the root path of the cameras to remove
+         */
+        void _Invalidate(const SdfPath& primPath);
+
+        /**
+         * @brief Convert a Hydra camera prim to a GfCamera
+         *
+         * @param prim the Hydra prim
+         * @return the GfCamera, a default one if the prim is not a camera
+         */
+        static GfCamera _ToGfCamera(HdSceneIndexPrim prim);
+};
+
+PXR_NAMESPACE_CLOSE_SCOPE
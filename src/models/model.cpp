@@ -1,5 +1,6 @@
 #include "model.h"
 
+#include <pxr/base/work/loops.h>
 #include <pxr/imaging/hd/sceneIndexPrimView.h>
 #include <pxr/imaging/hd/tokens.h>
 #include <pxr/usd/usd/stage.h>
@@ -10,11 +11,20 @@ PXR_NAMESPACE_OPEN_SCOPE
 
 Model::Model():
     _editableSceneIndex(nullptr),
-    _activeSceneIndex(nullptr)
+    _activeSceneIndex(nullptr),
+    _time(UsdTimeCode::Default()),
+    _isTimeVaryingAttrsDirty(true),
+    _prefetchDispatcher(nullptr),
+    _instancingUseCount(0),
+    _gridUseCount(0)
 {
     _sceneIndexBases = HdMergingSceneIndex::New();
     _finalSceneIndex = HdMergingSceneIndex::New();
-    SetEditableSceneIndex(_sceneIndexBases);
+
+    _displayModeSceneIndex = DisplayModeSceneIndex::New(_sceneIndexBases);
+    _colorSceneIndex = ColorFilterSceneIndex::New(_displayModeSceneIndex);
+    _xformSceneIndex = XformFilterSceneIndex::New(_colorSceneIndex);
+    _SetEditableSceneIndex(_xformSceneIndex);
     SetActiveSceneIndex(_finalSceneIndex);
 
     _sceneIndexBases->SetDisplayName("SceneIndexBases");
@@ -31,7 +41,59 @@ HdSceneIndexBaseRefPtr Model::GetEditableSceneIndex()
     return _editableSceneIndex;
 }
 
-void Model::SetEditableSceneIndex(HdSceneIndexBaseRefPtr sceneIndex)
+XformFilterSceneIndexRefPtr Model::GetXformSceneIndex()
+{
+    return _xformSceneIndex;
+}
+
+ColorFilterSceneIndexRefPtr Model::GetColorSceneIndex()
+{
+    return _colorSceneIndex;
+}
+
+DisplayModeSceneIndexRefPtr Model::GetDisplayModeSceneIndex()
+{
+    return _displayModeSceneIndex;
+}
+
+InstancingSceneIndexRefPtr Model::AcquireInstancing()
+{
+    if (_instancingUseCount++ == 0) {
+        _instancingSceneIndex = InstancingSceneIndex::New(_xformSceneIndex);
+        _SetEditableSceneIndex(_instancingSceneIndex);
+    }
+    return _instancingSceneIndex;
+}
+
+void Model::ReleaseInstancing()
+{
+    if (_instancingUseCount == 0 || --_instancingUseCount > 0) return;
+    _SetEditableSceneIndex(_xformSceneIndex);
+    _instancingSceneIndex = nullptr;
+}
+
+InstancingSceneIndexRefPtr Model::GetInstancingSceneIndex()
+{
+    return _instancingSceneIndex;
+}
+
+GridSceneIndexRefPtr Model::AcquireGrid()
+{
+    if (_gridUseCount++ == 0) {
+        _gridSceneIndex = GridSceneIndex::New();
+        AddSceneIndexBase(_gridSceneIndex);
+    }
+    return _gridSceneIndex;
+}
+
+void Model::ReleaseGrid()
+{
+    if (_gridUseCount == 0 || --_gridUseCount > 0) return;
+    _sceneIndexBases->RemoveInputScene(_gridSceneIndex);
+    _gridSceneIndex = nullptr;
+}
+
+void Model::_SetEditableSceneIndex(HdSceneIndexBaseRefPtr sceneIndex)
 {
     if (_editableSceneIndex){
         _finalSceneIndex->RemoveInputScene(_editableSceneIndex);
@@ -49,6 +111,8 @@ HdSceneIndexBaseRefPtr Model::GetFinalSceneIndex()
 void Model::SetActiveSceneIndex(HdSceneIndexBaseRefPtr sceneIndex)
 {
     _activeSceneIndex = sceneIndex;
+    _cameraCache.SetSceneIndex(sceneIndex);
+    _boundsCache.SetSceneIndex(sceneIndex);
 }
 
 HdSceneIndexBaseRefPtr Model::GetActiveSceneIndex()
@@ -94,6 +158,186 @@ SdfPathVector Model::GetSelection()
 void Model::SetSelection(SdfPathVector primPaths)
 {
     _selection = primPaths;
+    _recorder.RecordSelection(primPaths);
+}
+
+UsdStageRefPtr Model::GetStage()
+{
+    return _stage;
+}
+
+void Model::SetStage(UsdStageRefPtr stage,
+                     UsdImagingStageSceneIndexRefPtr stageSceneIndex)
+{
+    WaitForPrefetch();
+
+    TfNotice::Revoke(_objectsChangedKey);
+
+    _stage = stage;
+    _stageSceneIndex = stageSceneIndex;
+    _isTimeVaryingAttrsDirty = true;
+    _resyncedPaths.clear();
+    _changedInfoPaths.clear();
+    _prefetchedTimes.clear();
+
+    if (_stage) {
+        _objectsChangedKey = TfNotice::Register(
+            TfCreateWeakPtr(this), &Model::_OnObjectsChanged, _stage);
+    }
+
+    if (_stage && _stage->HasAuthoredTimeCodeRange())
+        SetTime(_stage->GetStartTimeCode());
+    else SetTime(UsdTimeCode::Default());
+}
+
+UsdTimeCode Model::GetTime()
+{
+    return _time;
+}
+
+void Model::SetTime(UsdTimeCode time)
+{
+    _time = time;
+    _recorder.RecordTime(time);
+    if (_stageSceneIndex) _stageSceneIndex->SetTime(time);
+}
+
+void Model::PrefetchTimes(vector<double> times)
+{
+    if (!_stage) return;
+
+    vector<double> newTimes;
+    for (double time : times) {
+        if (_prefetchedTimes.insert(time).second) newTimes.push_back(time);
+    }
+    if (newTimes.empty()) return;
+
+    _UpdateTimeVaryingAttrs();
+
+    // the model may be a static object, the dispatcher is created lazily
+    if (!_prefetchDispatcher) _prefetchDispatcher.reset(new WorkDispatcher());
+
+    const vector<UsdAttributeQuery>* attrs = &_prefetchedAttrs;
+    for (double time : newTimes) {
+        _prefetchDispatcher->Run([attrs, time]() {
+            // usdc files read values lazily, reading them here brings the
+            // data in memory ahead of the sync of that frame
+            WorkParallelForN(attrs->size(), [attrs, time](size_t b, size_t e) {
+                VtValue value;
+                for (size_t i = b; i < e; i++) (*attrs)[i].Get(&value, time);
+            });
+        });
+    }
+}
+
+void Model::WaitForPrefetch()
+{
+    if (_prefetchDispatcher) _prefetchDispatcher->Wait();
+}
+
+SampledValueCacheSceneIndexRefPtr Model::GetSampledValueCache()
+{
+    return _sampledValueCache;
+}
+
+void Model::SetSampledValueCache(
+    SampledValueCacheSceneIndexRefPtr sampledValueCache)
+{
+    _sampledValueCache = sampledValueCache;
+}
+
+void Model::_UpdateTimeVaryingAttrs()
+{
+    if (!_isTimeVaryingAttrsDirty && _resyncedPaths.empty() &&
+        _changedInfoPaths.empty())
+        return;
+
+    // running prefetches are reading the attributes
+    WaitForPrefetch();
+
+    if (_isTimeVaryingAttrsDirty) {
+        _isTimeVaryingAttrsDirty = false;
+        _timeVaryingAttrs.clear();
+        _resyncedPaths = {SdfPath::AbsoluteRootPath()};
+    }
+
+    // a resynced prim is visited with its descendants, the subtrees of the
+    // resynced prims are only visited once
+    SdfPath::RemoveDescendentPaths(&_resyncedPaths);
+    for (const SdfPath& path : _resyncedPaths) {
+        auto it = _timeVaryingAttrs.lower_bound(path);
+        while (it != _timeVaryingAttrs.end() && it->first.HasPrefix(path))
+            it = _timeVaryingAttrs.erase(it);
+
+        if (path.IsPropertyPath()) {
+            UsdAttribute attr = _stage->GetAttributeAtPath(path);
+            if (attr && attr.ValueMightBeTimeVarying())
+                _timeVaryingAttrs[path] = UsdAttributeQuery(attr);
+            continue;
+        }
+
+        UsdPrim prim = _stage->GetPrimAtPath(path);
+        if (!prim) continue;
+        for (UsdPrim descendant : UsdPrimRange(prim))
+            _AddTimeVaryingAttrs(descendant);
+    }
+
+    // an attribute whose samples changed, or the attributes of a prim
+    // whose metadata changed
+    for (const SdfPath& path : _changedInfoPaths) {
+        if (path.IsPropertyPath()) {
+            _timeVaryingAttrs.erase(path);
+            UsdAttribute attr = _stage->GetAttributeAtPath(path);
+            if (attr && attr.ValueMightBeTimeVarying())
+                _timeVaryingAttrs[path] = UsdAttributeQuery(attr);
+        }
+        else if (UsdPrim prim = _stage->GetPrimAtPath(path)) {
+            _AddTimeVaryingAttrs(prim);
+        }
+    }
+    _resyncedPaths.clear();
+    _changedInfoPaths.clear();
+
+    // the prefetch splits a flat array between its workers
+    _prefetchedAttrs.clear();
+    _prefetchedAttrs.reserve(_timeVaryingAttrs.size());
+    for (auto&& it : _timeVaryingAttrs) _prefetchedAttrs.push_back(it.second);
+}
+
+void Model::_AddTimeVaryingAttrs(const UsdPrim& prim)
+{
+    for (UsdAttribute attr : prim.GetAttributes()) {
+        if (attr.ValueMightBeTimeVarying())
+            _timeVaryingAttrs[attr.GetPath()] = UsdAttributeQuery(attr);
+        else _timeVaryingAttrs.erase(attr.GetPath());
+    }
+}
+
+void Model::_OnObjectsChanged(const UsdNotice::ObjectsChanged& notice,
+                              const UsdStageWeakPtr& sender)
+{
+    // the stage is only traversed again where it changed, on the next
+    // prefetch
+    for (const SdfPath& path : notice.GetResyncedPaths())
+        _resyncedPaths.push_back(path);
+    for (const SdfPath& path : notice.GetChangedInfoOnlyPaths())
+        _changedInfoPaths.push_back(path);
+    _prefetchedTimes.clear();
+}
+
+NoticeRecorder* Model::GetRecorder()
+{
+    return &_recorder;
+}
+
+CameraCache* Model::GetCameraCache()
+{
+    return &_cameraCache;
+}
+
+BoundsCache* Model::GetBoundsCache()
+{
+    return &_boundsCache;
 }
 
 PXR_NAMESPACE_CLOSE_SCOPE
@@ -10,16 +10,33 @@
 #pragma once
 
 #include <pxr/base/gf/vec3d.h>
+#include <pxr/base/tf/weakBase.h>
+#include <pxr/base/work/dispatcher.h>
 #include <pxr/imaging/hd/mergingSceneIndex.h>
 #include <pxr/imaging/hd/sceneIndex.h>
 #include <pxr/usd/usd/prim.h>
+#include <pxr/usd/usd/attributeQuery.h>
+#include <pxr/usd/usd/notice.h>
 #include <pxr/usd/usd/primRange.h>
 #include <pxr/usd/usd/stage.h>
 #include <pxr/usdImaging/usdImaging/sceneIndices.h>
 #include <pxr/usdImaging/usdImaging/stageSceneIndex.h>
 
+#include <map>
+#include <memory>
+#include <set>
 #include <vector>
 
+#include "models/boundscache.h"
+#include "models/cameracache.h"
+#include "recorders/noticerecorder.h"
+#include "sceneindices/colorfiltersceneindex.h"
+#include "sceneindices/displaymodesceneindex.h"
+#include "sceneindices/gridsceneindex.h"
+#include "sceneindices/instancingsceneindex.h"
+#include "sceneindices/sampledvaluecachesceneindex.h"
+#include "sceneindices/xformfiltersceneindex.h"
+
 PXR_NAMESPACE_OPEN_SCOPE
 
 using namespace std;
@@ -28,8 +45,15 @@ using namespace std;
  * @brief Model containing the current state of the program such as the USD
  * stage, the session layer, the current selection, and associated data.
  *
+ * The Model owns one filter chain shared by all the views. The edit filters
+ * (display mode, display color and xform) hold the edits of the session and
+ * live as long as the Model. The instancing runs on top of them, on the
+ * overwritten xforms so that moved prims move their instance. It is acquired
+ * by the viewports and torn down with the last one, so that the depth of the
+ * chain does not grow with the number of views. The culling and the level of
+ * detail depend on the camera, they are created by each viewport.
  */
-class Model {
+class Model : public TfWeakBase {
     public:
         /**
          * @brief Construct a new Model object
@@ -45,18 +69,73 @@ class Model {
         void AddSceneIndexBase(HdSceneIndexBaseRefPtr sceneIndex);
 
         /**
-         * @brief Get the Editable Scene Index from the model
+         * @brief Get the Editable Scene Index from the model, the end of
+         * the filter chain
          *
          * @return HdSceneIndexBaseRefPtr the editable Scene Index
          */
         HdSceneIndexBaseRefPtr GetEditableSceneIndex();
 
         /**
-         * @brief Set the Editable Scene Index to the model
+         * @brief Get the filter overwriting the xforms of the prims
+         *
+         * @return XformFilterSceneIndexRefPtr the xform filter
+         */
+        XformFilterSceneIndexRefPtr GetXformSceneIndex();
+
+        /**
+         * @brief Get the filter overwriting the display colors of the prims
+         *
+         * @return ColorFilterSceneIndexRefPtr the display color filter
+         */
+        ColorFilterSceneIndexRefPtr GetColorSceneIndex();
+
+        /**
+         * @brief Get the filter overwriting the display of the subtrees
+         *
+         * @return DisplayModeSceneIndexRefPtr the display mode filter
+         */
+        DisplayModeSceneIndexRefPtr GetDisplayModeSceneIndex();
+
+        /**
+         * @brief Acquire the instancing shared by the viewports, inserting it
+         * on top of the edit filters if no viewport uses it yet. Must be
+         * balanced by a call to ReleaseInstancing.
+         *
+         * @return InstancingSceneIndexRefPtr the shared instancing
+         */
+        InstancingSceneIndexRefPtr AcquireInstancing();
+
+        /**
+         * @brief Release the instancing, removing it from the chain once no
+         * viewport uses it anymore
+         *
+         */
+        void ReleaseInstancing();
+
+        /**
+         * @brief Get the instancing shared by the viewports
+         *
+         * @return InstancingSceneIndexRefPtr the shared instancing, null if
+         * no viewport uses it
+         */
+        InstancingSceneIndexRefPtr GetInstancingSceneIndex();
+
+        /**
+         * @brief Acquire the grid shared by the viewports, adding it to the
+         * scene index bases if no viewport uses it yet. Must be balanced by
+         * a call to ReleaseGrid.
+         *
+         * @return GridSceneIndexRefPtr the shared grid
+         */
+        GridSceneIndexRefPtr AcquireGrid();
+
+        /**
+         * @brief Release the grid, removing it from the scene index bases
+         * once no viewport uses it anymore
          *
-         * @param sceneIndex the Editable Scene Index to set to the model
          */
-        void SetEditableSceneIndex(HdSceneIndexBaseRefPtr sceneIndex);
+        void ReleaseGrid();
 
         /**
          * @brief Get the Active Scene Index from the model
@@ -109,10 +188,155 @@ class Model {
          */
         void SetSelection(SdfPathVector primPaths);
 
+        /**
+         * @brief Get the USD stage currently loaded in the model
+         *
+         * @return UsdStageRefPtr the current stage
+         */
+        UsdStageRefPtr GetStage();
+
+        /**
+         * @brief Set the USD stage of the model and the stage scene index
+         * that converts it to Hydra. The time is set to the start of the
+         * stage animation if any, to the default time otherwise.
+         *
+         * @param stage the new stage
+         * @param stageSceneIndex the scene index populated with the stage
+         */
+        void SetStage(UsdStageRefPtr stage,
+                      UsdImagingStageSceneIndexRefPtr stageSceneIndex);
+
+        /**
+         * @brief Get the current time of the model
+         *
+         * @return UsdTimeCode the current time
+         */
+        UsdTimeCode GetTime();
+
+        /**
+         * @brief Set the current time of the model, the stage scene index
+         * dirties the time varying prims
+         *
+         * @param time the new time
+         */
+        void SetTime(UsdTimeCode time);
+
+        /**
+         * @brief Read the time samples of the given times on worker threads
+         * so that the layer data is resident by the time the frames are
+         * displayed. Times already prefetched are skipped.
+         *
+         * @param times the upcoming times to prefetch
+         */
+        void PrefetchTimes(vector<double> times);
+
+        /**
+         * @brief Wait for the prefetch to complete. Must be called before
+         * authoring the stage.
+         *
+         */
+        void WaitForPrefetch();
+
+        /**
+         * @brief Get the sampled value cache of the stage scene indices
+         *
+         * @return SampledValueCacheSceneIndexRefPtr the sampled value cache,
+         * null if none is set
+         */
+        SampledValueCacheSceneIndexRefPtr GetSampledValueCache();
+
+        /**
+         * @brief Set the sampled value cache of the stage scene indices
+         *
+         * @param sampledValueCache the sampled value cache
+         */
+        void SetSampledValueCache(
+            SampledValueCacheSceneIndexRefPtr sampledValueCache);
+
+        /**
+         * @brief Get the recorder of the notices of the final scene index
+         * and of the edits of the views
+         *
+         * @return NoticeRecorder* the recorder
+         */
+        NoticeRecorder* GetRecorder();
+
+        /**
+         * @brief Get the cache of the cameras of the active scene index,
+         * shared by the viewports
+         *
+         * @return CameraCache* the camera cache
+         */
+        CameraCache* GetCameraCache();
+
+        /**
+         * @brief Get the cache of the world space xforms and subtree bounds
+         * of the active scene index, shared by the viewports
+         *
+         * @return BoundsCache* the bounds cache
+         */
+        BoundsCache* GetBoundsCache();
+
     private:
         SdfPathVector _selection;
+        UsdStageRefPtr _stage;
+        UsdImagingStageSceneIndexRefPtr _stageSceneIndex;
+        SampledValueCacheSceneIndexRefPtr _sampledValueCache;
+        NoticeRecorder _recorder;
+        CameraCache _cameraCache;
+        BoundsCache _boundsCache;
+        UsdTimeCode _time;
+
+        map<SdfPath, UsdAttributeQuery> _timeVaryingAttrs;
+        vector<UsdAttributeQuery> _prefetchedAttrs;
+        SdfPathVector _resyncedPaths, _changedInfoPaths;
+        bool _isTimeVaryingAttrsDirty;
+        set<double> _prefetchedTimes;
+        unique_ptr<WorkDispatcher> _prefetchDispatcher;
+        TfNotice::Key _objectsChangedKey;
+
+        /**
+         * @brief Collect the attributes of the stage that might be time
+         * varying. The whole stage is only traversed for a new stage, the
+         * later updates only visit the paths changed since the last one.
+         *
+         */
+        void _UpdateTimeVaryingAttrs();
+
+        /**
+         * @brief Update the time varying attributes of a prim
+         *
+         * @param prim the prim
+         */
+        void _AddTimeVaryingAttrs(const UsdPrim& prim);
+
+        /**
+         * @brief Called when the stage is authored, keeps the changed paths
+         * to update the time varying attributes and invalidates the
+         * prefetched times
+         *
+         * @param notice the USD notice
+         * @param sender the stage that changed
+         */
+        void _OnObjectsChanged(const UsdNotice::ObjectsChanged& notice,
+                               const UsdStageWeakPtr& sender);
         HdSceneIndexBaseRefPtr _editableSceneIndex, _activeSceneIndex;
         HdMergingSceneIndexRefPtr _sceneIndexBases, _finalSceneIndex;
+
+        DisplayModeSceneIndexRefPtr _displayModeSceneIndex;
+        ColorFilterSceneIndexRefPtr _colorSceneIndex;
+        XformFilterSceneIndexRefPtr _xformSceneIndex;
+        InstancingSceneIndexRefPtr _instancingSceneIndex;
+        size_t _instancingUseCount;
+        GridSceneIndexRefPtr _gridSceneIndex;
+        size_t _gridUseCount;
+
+        /**
+         * @brief Set the Editable Scene Index to the model
+         *
+         * @param sceneIndex the Editable Scene Index to set to the model
+         */
+        void _SetEditableSceneIndex(HdSceneIndexBaseRefPtr sceneIndex);
 };
 
 PXR_NAMESPACE_CLOSE_SCOPE
\ No newline at end of file
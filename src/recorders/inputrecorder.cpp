@@ -0,0 +1,92 @@
+#include "inputrecorder.h"
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+InputRecorder::InputRecorder()
+    : _keysDown(ImGuiKey_NamedKey_END - ImGuiKey_NamedKey_BEGIN, false),
+      _isHeaderWritten(false)
+{
+}
+
+bool InputRecorder::Start(const string& filePath)
+{
+    Stop();
+
+    _file.open(filePath, ios::binary | ios::trunc);
+    if (!_file) return false;
+
+    fill(_keysDown.begin(), _keysDown.end(), false);
+    _isHeaderWritten = false;
+    return true;
+}
+
+void InputRecorder::Stop()
+{
+    if (_file.is_open()) _file.close();
+}
+
+bool InputRecorder::IsRecording() const
+{
+    return _file.is_open();
+}
+
+void InputRecorder::RecordFrame()
+{
+    if (!IsRecording()) return;
+
+    ImGuiIO& io = ImGui::GetIO();
+
+    // the layout is part of the state the inputs apply to, it is only
+    // loaded from the ini file by the first ImGui::NewFrame
+    if (!_isHeaderWritten) {
+        size_t iniSize = 0;
+        const char* ini = ImGui::SaveIniSettingsToMemory(&iniSize);
+
+        _file.write(MAGIC, sizeof(MAGIC));
+        _Write(VERSION);
+        _Write(io.DisplaySize.x);
+        _Write(io.DisplaySize.y);
+        _Write(uint32_t(iniSize));
+        _file.write(ini, iniSize);
+        _isHeaderWritten = true;
+    }
+
+    uint8_t buttons = 0;
+    for (int i = 0; i < MOUSE_BUTTON_COUNT; i++) {
+        if (io.MouseDown[i]) buttons |= 1 << i;
+    }
+
+    _Write(io.DeltaTime);
+    _Write(io.MousePos.x);
+    _Write(io.MousePos.y);
+    _Write(buttons);
+    _Write(io.MouseWheel);
+    _Write(io.MouseWheelH);
+    _Write(int32_t(io.KeyMods));
+
+    // only the keys whose state changed are written, the mouse and the
+    // modifier keys are derived by ImGui from the events above
+    vector<pair<uint16_t, uint8_t>> keyChanges;
+    for (int key = ImGuiKey_NamedKey_BEGIN; key < ImGuiKey_NamedKey_END;
+         key++) {
+        if ((key >= ImGuiKey_MouseLeft && key <= ImGuiKey_MouseWheelY) ||
+            (key >= ImGuiKey_ReservedForModCtrl &&
+             key <= ImGuiKey_ReservedForModSuper))
+            continue;
+
+        bool isDown = ImGui::IsKeyDown(ImGuiKey(key));
+        if (isDown == _keysDown[key - ImGuiKey_NamedKey_BEGIN]) continue;
+        _keysDown[key - ImGuiKey_NamedKey_BEGIN] = isDown;
+        keyChanges.push_back({uint16_t(key), uint8_t(isDown)});
+    }
+    _Write(uint16_t(keyChanges.size()));
+    for (auto&& [key, isDown] : keyChanges) {
+        _Write(key);
+        _Write(isDown);
+    }
+
+    _Write(uint16_t(io.InputQueueCharacters.Size));
+    for (ImWchar c : io.InputQueueCharacters) _Write(uint32_t(c));
+}
+
+PXR_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,92 @@
+/**
+ * @file inputrecorder.h
+ * @author Raphael Jouretz (rjouretz.com)
+ * @brief InputRecorder logs the ImGui inputs of every frame into a binary
+ * file, so that a UI session can be replayed frame by frame by
+ * InputReplayer.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <imgui.h>
+#include <pxr/pxr.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+using namespace std;
+
+/**
+ * @brief InputRecorder logs the ImGui inputs of every frame into a binary
+ * file, so that a UI session can be replayed frame by frame by
+ * InputReplayer.
+ *
+ * An input file starts with a header holding the display size and the ImGui
+ * layout, followed by one record per frame: the mouse state, the modifiers,
+ * the keys that changed and the typed characters. The inputs are read from
+ * ImGuiIO once ImGui::NewFrame processed them. The recording must start
+ * with the application so that the replay starts from the same state.
+ */
+class InputRecorder {
+    public:
+        inline static const char MAGIC[4] = {'I', 'H', 'I', 'R'};
+        inline static const uint32_t VERSION = 1;
+        inline static const int MOUSE_BUTTON_COUNT = 5;
+
+        /**
+         * @brief Construct a new InputRecorder object
+         *
+         */
+        InputRecorder();
+
+        /**
+         * @brief Start recording the inputs
+         *
+         * @param filePath the path of the input file
+         * @return true if the file could be opened, false otherwise
+         */
+        bool Start(const string& filePath);
+
+        /**
+         * @brief Stop the recording and close the input file
+         *
+         */
+        void Stop();
+
+        /**
+         * @brief Check if the recorder is recording
+         *
+         * @return true if recording
+         */
+        bool IsRecording() const;
+
+        /**
+         * @brief Record the inputs of the current frame. Must be called
+         * right after ImGui::NewFrame.
+         *
+         */
+        void RecordFrame();
+
+    private:
+        ofstream _file;
+        vector<bool> _keysDown;
+        bool _isHeaderWritten;
+
+        /**
+         * @brief Write a plain value
+         *
+         * @param value the value to write
+         */
+        template <typename T>
+        void _Write(const T& value)
+        {
+            _file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+};
+
+PXR_NAMESPACE_CLOSE_SCOPE
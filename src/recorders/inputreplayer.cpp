@@ -0,0 +1,196 @@
+#include "inputreplayer.h"
+
+#include <algorithm>
+#include <cstring>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+InputReplayer::InputReplayer(double fixedTimestep)
+    : _fixedTimestep(fixedTimestep),
+      _frameIndex(0),
+      _hasInput(false),
+      _firstFrameTime(0)
+{
+}
+
+bool InputReplayer::Load(const string& filePath)
+{
+    _frames.clear();
+
+    _file.open(filePath, ios::binary);
+    if (!_file) return false;
+
+    char magic[sizeof(InputRecorder::MAGIC)];
+    _file.read(magic, sizeof(magic));
+    if (!_file || memcmp(magic, InputRecorder::MAGIC, sizeof(magic)) != 0 ||
+        _Read<uint32_t>() != InputRecorder::VERSION) {
+        _file.close();
+        return false;
+    }
+    _displaySize.x = _Read<float>();
+    _displaySize.y = _Read<float>();
+    _ini.resize(_Read<uint32_t>());
+    _file.read(_ini.data(), _ini.size());
+
+    while (_ReadFrame()) {}
+
+    _file.close();
+    return true;
+}
+
+ImVec2 InputReplayer::GetDisplaySize() const
+{
+    return _displaySize;
+}
+
+void InputReplayer::ApplyLayout()
+{
+    ImGuiIO& io = ImGui::GetIO();
+    io.IniFilename = nullptr;
+    io.ConfigInputTrickleEventQueue = false;
+    ImGui::LoadIniSettingsFromMemory(_ini.data(), _ini.size());
+}
+
+bool InputReplayer::BeginFrame()
+{
+    auto now = chrono::steady_clock::now();
+
+    // the previous frame is presented once the next one begins
+    if (_frameIndex > 0 && _frameIndex <= _frames.size()) {
+        double frameTime =
+            chrono::duration<double>(now - _frameStart).count();
+        if (_frameIndex == 1) _firstFrameTime = frameTime;
+        else {
+            _frameTimes.push_back(frameTime);
+            if (_hasInput) _inputFrameTimes.push_back(frameTime);
+        }
+    }
+    if (_frameIndex >= _frames.size()) {
+        _frameIndex = _frames.size() + 1;
+        return false;
+    }
+
+    const _Frame& frame = _frames[_frameIndex];
+    const _Frame* prevFrame = _frameIndex > 0 ? &_frames[_frameIndex - 1]
+                                              : nullptr;
+    _hasInput = _QueueInputs(frame, prevFrame);
+
+    ImGuiIO& io = ImGui::GetIO();
+    io.DeltaTime = _fixedTimestep > 0 ? _fixedTimestep : frame.deltaTime;
+
+    _frameIndex++;
+    _frameStart = chrono::steady_clock::now();
+    return true;
+}
+
+void InputReplayer::AddViewTime(const string& viewLabel, double time)
+{
+    // the first frame only measures the creation of the views
+    if (_frameIndex <= 1 || _frameIndex > _frames.size()) return;
+
+    _viewTimes[viewLabel].push_back(time);
+    if (_hasInput) _viewInputTimes[viewLabel].push_back(time);
+}
+
+InputReplayReport InputReplayer::GetReport() const
+{
+    InputReplayReport report = {};
+    report.frameCount = min(_frameIndex, _frames.size());
+    report.inputFrameCount = _inputFrameTimes.size();
+    report.firstFrameTime = _firstFrameTime;
+    report.frameTimes = _GetTimes(_frameTimes);
+    report.inputFrameTimes = _GetTimes(_inputFrameTimes);
+    for (auto&& [label, times] : _viewTimes)
+        report.viewTimes[label] = _GetTimes(times);
+    for (auto&& [label, times] : _viewInputTimes)
+        report.viewInputTimes[label] = _GetTimes(times);
+    return report;
+}
+
+bool InputReplayer::_ReadFrame()
+{
+    _Frame frame;
+    frame.deltaTime = _Read<float>();
+    frame.mousePos.x = _Read<float>();
+    frame.mousePos.y = _Read<float>();
+    frame.buttons = _Read<uint8_t>();
+    frame.wheel = _Read<float>();
+    frame.wheelH = _Read<float>();
+    frame.keyMods = _Read<int32_t>();
+
+    uint16_t keyCount = _Read<uint16_t>();
+    for (uint16_t i = 0; i < keyCount; i++) {
+        ImGuiKey key = ImGuiKey(_Read<uint16_t>());
+        bool isDown = _Read<uint8_t>();
+        frame.keyChanges.push_back({key, isDown});
+    }
+
+    uint16_t charCount = _Read<uint16_t>();
+    for (uint16_t i = 0; i < charCount; i++)
+        frame.characters.push_back(ImWchar(_Read<uint32_t>()));
+
+    if (!_file) return false;
+
+    _frames.push_back(frame);
+    return true;
+}
+
+bool InputReplayer::_QueueInputs(const _Frame& frame, const _Frame* prevFrame)
+{
+    ImGuiIO& io = ImGui::GetIO();
+    bool hasInput = !prevFrame || frame.mousePos.x != prevFrame->mousePos.x ||
+                    frame.mousePos.y != prevFrame->mousePos.y;
+
+    // the mouse position is always queued, so that it overrides the one
+    // polled by the platform backend
+    io.AddMousePosEvent(frame.mousePos.x, frame.mousePos.y);
+
+    uint8_t prevButtons = prevFrame ? prevFrame->buttons : 0;
+    for (int i = 0; i < InputRecorder::MOUSE_BUTTON_COUNT; i++) {
+        bool isDown = frame.buttons & (1 << i);
+        if (isDown == bool(prevButtons & (1 << i))) continue;
+        io.AddMouseButtonEvent(i, isDown);
+        hasInput = true;
+    }
+
+    if (frame.wheel != 0 || frame.wheelH != 0) {
+        io.AddMouseWheelEvent(frame.wheelH, frame.wheel);
+        hasInput = true;
+    }
+
+    int prevKeyMods = prevFrame ? prevFrame->keyMods : 0;
+    for (ImGuiKey mod :
+         {ImGuiMod_Ctrl, ImGuiMod_Shift, ImGuiMod_Alt, ImGuiMod_Super}) {
+        bool isDown = frame.keyMods & mod;
+        if (isDown == bool(prevKeyMods & mod)) continue;
+        io.AddKeyEvent(mod, isDown);
+        hasInput = true;
+    }
+
+    for (auto&& [key, isDown] : frame.keyChanges) {
+        io.AddKeyEvent(key, isDown);
+        hasInput = true;
+    }
+
+    for (ImWchar c : frame.characters) {
+        io.AddInputCharacter(c);
+        hasInput = true;
+    }
+    return hasInput;
+}
+
+InputReplayTimes InputReplayer::_GetTimes(vector<double> times)
+{
+    InputReplayTimes result = {};
+    result.count = times.size();
+    if (times.empty()) return result;
+
+    sort(times.begin(), times.end());
+    for (double time : times) result.mean += time;
+    result.mean /= times.size();
+    result.p95 = times[min(times.size() - 1, times.size() * 95 / 100)];
+    result.max = times.back();
+    return result;
+}
+
+PXR_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,192 @@
+/**
+ * @file inputreplayer.h
+ * @author Raphael Jouretz (rjouretz.com)
+ * @brief InputReplayer feeds the inputs of an input file recorded by
+ * InputRecorder back to ImGui frame by frame and measures the time of the
+ * frames and of the views.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <imgui.h>
+#include <pxr/pxr.h>
+
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "inputrecorder.h"
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+using namespace std;
+
+/**
+ * @brief The statistics of a series of times, in seconds
+ *
+ * @param count the number of times
+ * @param mean the mean time
+ * @param p95 the 95th percentile time
+ * @param max the maximum time
+ */
+struct InputReplayTimes {
+    size_t count;
+    double mean, p95, max;
+};
+
+/**
+ * @brief The measures of a replay
+ *
+ * @param frameCount the number of frames replayed
+ * @param inputFrameCount the number of frames whose inputs changed
+ * @param firstFrameTime the time of the first frame, loading the views
+ * @param frameTimes the times of the following frames, from the start of a
+ * frame to the start of the next one, once the previous one is presented
+ * @param inputFrameTimes the frame times of the frames whose inputs
+ * changed, they exclude the render of the render thread, presented
+ * asynchronously
+ * @param viewTimes the update times of each view, by view label
+ * @param viewInputTimes the update times of each view for the frames whose
+ * inputs changed, by view label
+ */
+struct InputReplayReport {
+    size_t frameCount, inputFrameCount;
+    double firstFrameTime;
+    InputReplayTimes frameTimes, inputFrameTimes;
+    map<string, InputReplayTimes> viewTimes, viewInputTimes;
+};
+
+/**
+ * @brief InputReplayer feeds the inputs of an input file recorded by
+ * InputRecorder back to ImGui frame by frame and measures the time of the
+ * frames and of the views.
+ *
+ * The inputs of a recorded frame are all queued before ImGui::NewFrame with
+ * the input trickling disabled, so that they are processed by the same frame
+ * they were recorded in. With a fixed timestep, the ImGui time does not
+ * depend on the speed of the machine either.
+ */
+class InputReplayer {
+    public:
+        /**
+         * @brief Construct a new InputReplayer object
+         *
+         * @param fixedTimestep the delta time of every frame in seconds, the
+         * recorded delta times if not strictly positive
+         */
+        InputReplayer(double fixedTimestep);
+
+        /**
+         * @brief Load an input file
+         *
+         * @param filePath the path of the input file
+         * @return true if the file is a valid input file, false otherwise
+         */
+        bool Load(const string& filePath);
+
+        /**
+         * @brief Get the display size the input file was recorded with
+         *
+         * @return the display size
+         */
+        ImVec2 GetDisplaySize() const;
+
+        /**
+         * @brief Load the recorded layout into ImGui and stop ImGui from
+         * reading and writing its ini file
+         *
+         */
+        void ApplyLayout();
+
+        /**
+         * @brief Measure the previous frame and queue the inputs of the
+         * next one. Must be called right before ImGui::NewFrame.
+         *
+         * @return false once all the frames are replayed
+         */
+        bool BeginFrame();
+
+        /**
+         * @brief Add the update time of a view to the current frame
+         *
+         * @param viewLabel the label of the view
+         * @param time the update time in seconds
+         */
+        void AddViewTime(const string& viewLabel, double time);
+
+        /**
+         * @brief Get the measures of the frames replayed so far
+         *
+         * @return the measures of the replay
+         */
+        InputReplayReport GetReport() const;
+
+    private:
+        struct _Frame {
+            float deltaTime;
+            ImVec2 mousePos;
+            uint8_t buttons;
+            float wheel, wheelH;
+            int keyMods;
+            vector<pair<ImGuiKey, bool>> keyChanges;
+            vector<ImWchar> characters;
+        };
+
+        double _fixedTimestep;
+        ImVec2 _displaySize;
+        string _ini;
+        vector<_Frame> _frames;
+
+        size_t _frameIndex;
+        bool _hasInput;
+        chrono::steady_clock::time_point _frameStart;
+        double _firstFrameTime;
+        vector<double> _frameTimes, _inputFrameTimes;
+        map<string, vector<double>> _viewTimes, _viewInputTimes;
+
+        ifstream _file;
+
+        /**
+         * @brief Read a plain value
+         *
+         * @return the value read
+         */
+        template <typename T>
+        T _Read()
+        {
+            T value = T();
+            _file.read(reinterpret_cast<char*>(&value), sizeof(T));
+            return value;
+        }
+
+        /**
+         * @brief Read a frame and append it to the frames
+         *
+         * @return false at the end of the file
+         */
+        bool _ReadFrame();
+
+        /**
+         * @brief Queue the inputs of a frame that differ from the previous
+         * frame
+         *
+         * @param frame the frame to queue the inputs of
+         * @param prevFrame the previous frame, null for the first one
+         * @return true if any input changed
+         */
+        bool _QueueInputs(const _Frame& frame, const _Frame* prevFrame);
+
+        /**
+         * @brief Compute the statistics of a series of times
+         *
+         * @param times the times
+         * @return the statistics
+         */
+        static InputReplayTimes _GetTimes(vector<double> times);
+};
+
+PXR_NAMESPACE_CLOSE_SCOPE
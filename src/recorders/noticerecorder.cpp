@@ -0,0 +1,196 @@
+#include "noticerecorder.h"
+
+#include <limits>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+NoticeRecorder::NoticeRecorder() : _recordCount(0) {}
+
+NoticeRecorder::~NoticeRecorder()
+{
+    Stop();
+}
+
+bool NoticeRecorder::Start(const string& filePath,
+                           HdSceneIndexBaseRefPtr sceneIndex,
+                           const string& stageIdentifier)
+{
+    Stop();
+
+    _file.open(filePath, ios::binary | ios::trunc);
+    if (!_file) return false;
+
+    _stringIndices.clear();
+    _recordCount = 0;
+    _cameras.clear();
+    _startTime = chrono::steady_clock::now();
+
+    _file.write(MAGIC, sizeof(MAGIC));
+    _Write(VERSION);
+    _WriteString(stageIdentifier);
+
+    _sceneIndex = sceneIndex;
+    _sceneIndex->AddObserver(HdSceneIndexObserverPtr(this));
+    return true;
+}
+
+void NoticeRecorder::Stop()
+{
+    if (_sceneIndex) {
+        _sceneIndex->RemoveObserver(HdSceneIndexObserverPtr(this));
+        _sceneIndex = nullptr;
+    }
+    if (_file.is_open()) _file.close();
+}
+
+bool NoticeRecorder::IsRecording() const
+{
+    return _file.is_open();
+}
+
+size_t NoticeRecorder::GetRecordCount() const
+{
+    return _recordCount;
+}
+
+void NoticeRecorder::RecordFrame()
+{
+    if (!IsRecording()) return;
+
+    _WriteRecordHeader(NoticeRecordType::Frame);
+}
+
+void NoticeRecorder::RecordXform(const SdfPath& primPath,
+                                 const GfMatrix4d& xform)
+{
+    if (!IsRecording()) return;
+
+    _WriteRecordHeader(NoticeRecordType::Xform);
+    _WriteString(primPath.GetString());
+    _Write(xform);
+}
+
+void NoticeRecorder::RecordDisplayColor(const SdfPath& primPath,
+                                        const GfVec3f& color)
+{
+    if (!IsRecording()) return;
+
+    _WriteRecordHeader(NoticeRecordType::DisplayColor);
+    _WriteString(primPath.GetString());
+    _Write(color);
+}
+
+void NoticeRecorder::RecordSelection(const SdfPathVector& primPaths)
+{
+    if (!IsRecording()) return;
+
+    _WriteRecordHeader(NoticeRecordType::Selection);
+    _Write(uint32_t(primPaths.size()));
+    for (auto&& primPath : primPaths) _WriteString(primPath.GetString());
+}
+
+void NoticeRecorder::RecordTime(UsdTimeCode time)
+{
+    if (!IsRecording()) return;
+
+    // the default time is written as a NaN
+    _WriteRecordHeader(NoticeRecordType::Time);
+    _Write(time.IsDefault() ? numeric_limits<double>::quiet_NaN()
+                            : time.GetValue());
+}
+
+void NoticeRecorder::RecordCamera(const string& viewportId,
+                                  const GfMatrix4d& view,
+                                  const GfMatrix4d& proj)
+{
+    if (!IsRecording()) return;
+
+    // each viewport has its own camera, replayed to its own engine
+    auto inserted = _cameras.insert({viewportId, {view, proj}});
+    if (!inserted.second) {
+        if (inserted.first->second == make_pair(view, proj)) return;
+        inserted.first->second = {view, proj};
+    }
+
+    _WriteRecordHeader(NoticeRecordType::Camera);
+    _WriteString(viewportId);
+    _Write(view);
+    _Write(proj);
+}
+
+void NoticeRecorder::RecordSessionLayer(const string& layerText)
+{
+    if (!IsRecording()) return;
+
+    // the text is hardly ever the same twice, it is not indexed
+    _WriteRecordHeader(NoticeRecordType::SessionLayer);
+    _Write(uint32_t(layerText.size()));
+    _file.write(layerText.data(), layerText.size());
+}
+
+void NoticeRecorder::PrimsAdded(const HdSceneIndexBase& sender,
+                                const AddedPrimEntries& entries)
+{
+    _WriteRecordHeader(NoticeRecordType::PrimsAdded);
+    _Write(uint32_t(entries.size()));
+    for (auto&& entry : entries) {
+        _WriteString(entry.primPath.GetString());
+        _WriteString(entry.primType.GetString());
+    }
+}
+
+void NoticeRecorder::PrimsRemoved(const HdSceneIndexBase& sender,
+                                  const RemovedPrimEntries& entries)
+{
+    _WriteRecordHeader(NoticeRecordType::PrimsRemoved);
+    _Write(uint32_t(entries.size()));
+    for (auto&& entry : entries) _WriteString(entry.primPath.GetString());
+}
+
+void NoticeRecorder::PrimsDirtied(const HdSceneIndexBase& sender,
+                                  const DirtiedPrimEntries& entries)
+{
+    _WriteRecordHeader(NoticeRecordType::PrimsDirtied);
+    _Write(uint32_t(entries.size()));
+    for (auto&& entry : entries) {
+        _WriteString(entry.primPath.GetString());
+        _Write(uint32_t(entry.dirtyLocators.end() -
+                        entry.dirtyLocators.begin()));
+        for (auto&& locator : entry.dirtyLocators)
+            _WriteString(locator.GetString());
+    }
+}
+
+void NoticeRecorder::PrimsRenamed(const HdSceneIndexBase& sender,
+                                  const RenamedPrimEntries& entries)
+{
+    _WriteRecordHeader(NoticeRecordType::PrimsRenamed);
+    _Write(uint32_t(entries.size()));
+    for (auto&& entry : entries) {
+        _WriteString(entry.oldPrimPath.GetString());
+        _WriteString(entry.newPrimPath.GetString());
+    }
+}
+
+void NoticeRecorder::_WriteRecordHeader(NoticeRecordType type)
+{
+    chrono::duration<double> elapsed =
+        chrono::steady_clock::now() - _startTime;
+    _Write(type);
+    _Write(elapsed.count());
+    _recordCount++;
+}
+
+void NoticeRecorder::_WriteString(const string& str)
+{
+    // a new string is written with the next free index, followed by its
+    // characters
+    auto inserted = _stringIndices.insert({str, uint32_t(_stringIndices.size())});
+    _Write(inserted.first->second);
+    if (!inserted.second) return;
+
+    _Write(uint32_t(str.size()));
+    _file.write(str.data(), str.size());
+}
+
+PXR_NAMESPACE_CLOSE_SCOPE
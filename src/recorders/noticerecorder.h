@@ -0,0 +1,221 @@
+/**
+ * @file noticerecorder.h
+ * @author Raphael Jouretz (rjouretz.com)
+ * @brief NoticeRecorder logs the notices of a scene index and the edits of
+ * the user into a compact binary file, so that an editing session can be
+ * replayed by NoticeReplayer.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <pxr/base/gf/matrix4d.h>
+#include <pxr/base/gf/vec3f.h>
+#include <pxr/imaging/hd/sceneIndex.h>
+#include <pxr/imaging/hd/sceneIndexObserver.h>
+#include <pxr/usd/usd/timeCode.h>
+
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+using namespace std;
+
+/**
+ * @brief The types of the records of a notice file
+ *
+ */
+enum class NoticeRecordType : uint8_t {
+    Frame,
+    PrimsAdded,
+    PrimsRemoved,
+    PrimsDirtied,
+    PrimsRenamed,
+    Xform,
+    DisplayColor,
+    Selection,
+    Time,
+    Camera,
+    SessionLayer
+};
+
+/**
+ * @brief NoticeRecorder logs the notices of a scene index and the edits of
+ * the user into a compact binary file, so that an editing session can be
+ * replayed by NoticeReplayer.
+ *
+ * A notice file starts with a header holding the identifier of the stage,
+ * followed by records made of a type, a timestamp in seconds since the start
+ * of the recording and a payload. Paths, tokens and locators are written
+ * once and referred to by their index afterwards. The edits are only logged
+ * while recording, they cost a branch otherwise. The edits of the session
+ * layer, including the prims created or removed through it, are logged as
+ * the whole text of the layer.
+ */
+class NoticeRecorder : public HdSceneIndexObserver {
+    public:
+        inline static const char MAGIC[4] = {'I', 'H', 'N', 'R'};
+        inline static const uint32_t VERSION = 2;
+
+        /**
+         * @brief Construct a new NoticeRecorder object
+         *
+         */
+        NoticeRecorder();
+
+        /**
+         * @brief Destroy the NoticeRecorder object, stops the recording
+         *
+         */
+        ~NoticeRecorder();
+
+        /**
+         * @brief Start recording the notices of a scene index
+         *
+         * @param filePath the path of the notice file
+         * @param sceneIndex the scene index to observe
+         * @param stageIdentifier the identifier of the stage being edited
+         * @return true if the file could be opened, false otherwise
+         */
+        bool Start(const string& filePath, HdSceneIndexBaseRefPtr sceneIndex,
+                   const string& stageIdentifier);
+
+        /**
+         * @brief Stop the recording and close the notice file
+         *
+         */
+        void Stop();
+
+        /**
+         * @brief Check if the recorder is recording
+         *
+         * @return true if recording
+         */
+        bool IsRecording() const;
+
+        /**
+         * @brief Get the number of records written since the start of the
+         * recording
+         *
+         * @return the number of records
+         */
+        size_t GetRecordCount() const;
+
+        /**
+         * @brief Record the end of a UI frame, the edits of a frame are
+         * replayed together
+         *
+         */
+        void RecordFrame();
+
+        /**
+         * @brief Record the xform set on a prim
+         *
+         * @param primPath the path of the prim
+         * @param xform the new xform
+         */
+        void RecordXform(const SdfPath& primPath, const GfMatrix4d& xform);
+
+        /**
+         * @brief Record the display color set on a prim
+         *
+         * @param primPath the path of the prim
+         * @param color the new display color
+         */
+        void RecordDisplayColor(const SdfPath& primPath, const GfVec3f& color);
+
+        /**
+         * @brief Record the selection
+         *
+         * @param primPaths the paths of the selected prims
+         */
+        void RecordSelection(const SdfPathVector& primPaths);
+
+        /**
+         * @brief Record the current time
+         *
+         * @param time the new time
+         */
+        void RecordTime(UsdTimeCode time);
+
+        /**
+         * @brief Record the camera of a viewport, only when it changed
+         *
+         * @param viewportId the identifier of the viewport, e.g. its label
+         * @param view the view matrix
+         * @param proj the projection matrix
+         */
+        void RecordCamera(const string& viewportId, const GfMatrix4d& view,
+                          const GfMatrix4d& proj);
+
+        /**
+         * @brief Record the content of the session layer once edited
+         *
+         * @param layerText the session layer exported as text
+         */
+        void RecordSessionLayer(const string& layerText);
+
+        /**
+         * @brief Override of HdSceneIndexObserver::PrimsAdded
+         */
+        void PrimsAdded(const HdSceneIndexBase& sender,
+                        const AddedPrimEntries& entries) override;
+
+        /**
+         * @brief Override of HdSceneIndexObserver::PrimsRemoved
+         */
+        void PrimsRemoved(const HdSceneIndexBase& sender,
+                          const RemovedPrimEntries& entries) override;
+
+        /**
+         * @brief Override of HdSceneIndexObserver::PrimsDirtied
+         */
+        void PrimsDirtied(const HdSceneIndexBase& sender,
+                          const DirtiedPrimEntries& entries) override;
+
+        /**
+         * @brief Override of HdSceneIndexObserver::PrimsRenamed
+         */
+        void PrimsRenamed(const HdSceneIndexBase& sender,
+                          const RenamedPrimEntries& entries) override;
+
+    private:
+        ofstream _file;
+        HdSceneIndexBaseRefPtr _sceneIndex;
+        chrono::steady_clock::time_point _startTime;
+        unordered_map<string, uint32_t> _stringIndices;
+        size_t _recordCount;
+        unordered_map<string, pair<GfMatrix4d, GfMatrix4d>> _cameras;
+
+        /**
+         * @brief Write the type and the timestamp of a record
+         *
+         * @param type the type of the record
+         */
+        void _WriteRecordHeader(NoticeRecordType type);
+
+        /**
+         * @brief Write a plain value
+         *
+         * @param value the value to write
+         */
+        template <typename T>
+        void _Write(const T& value)
+        {
+            _file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        /**
+         * @brief Write a string, its characters are only written the first
+         * time it is met
+         *
+         * @param str the string to write
+         */
+        void _WriteString(const string& str);
+};
+
+PXR_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,291 @@
+#include "noticereplayer.h"
+
+#include <pxr/base/tf/diagnostic.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usdImaging/usdImaging/sceneIndices.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <memory>
+
+#include "engine.h"
+#include "models/model.h"
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+namespace {
+
+/**
+ * @brief Get the seconds elapsed since a time point
+ *
+ * @param start the time point
+ * @return double the seconds elapsed
+ */
+double _GetElapsed(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start)
+        .count();
+}
+
+}  // namespace
+
+NoticeReplayer::NoticeReplayer() : _noticeCount(0) {}
+
+bool NoticeReplayer::Load(const string& filePath)
+{
+    _frames.clear();
+    _strings.clear();
+    _viewportIds.clear();
+
+    _file.open(filePath, ios::binary);
+    if (!_file) return false;
+
+    char magic[sizeof(NoticeRecorder::MAGIC)];
+    _file.read(magic, sizeof(magic));
+    if (!_file || memcmp(magic, NoticeRecorder::MAGIC, sizeof(magic)) != 0 ||
+        _Read<uint32_t>() != NoticeRecorder::VERSION) {
+        _file.close();
+        return false;
+    }
+    _stageIdentifier = _ReadString();
+
+    _frames.push_back({});
+    while (_ReadRecord()) {}
+
+    // the edits made after the last frame are replayed in a frame of their
+    // own
+    if (_frames.back().edits.empty()) _frames.pop_back();
+
+    _file.close();
+    return true;
+}
+
+const string& NoticeReplayer::GetStageIdentifier() const
+{
+    return _stageIdentifier;
+}
+
+NoticeReplayReport NoticeReplayer::Run(const string& stageFilePath,
+                                       TfToken rendererPlugin, int width,
+                                       int height)
+{
+    NoticeReplayReport report = {};
+
+    // the stage is loaded the way the Usd Session Layer view loads it
+    auto start = chrono::steady_clock::now();
+    UsdStageRefPtr stage = UsdStage::Open(stageFilePath);
+    if (!stage) return report;
+    stage->SetEditTarget(stage->GetSessionLayer());
+
+    UsdImagingCreateSceneIndicesInfo info;
+    info.displayUnloadedPrimsWithBounds = false;
+    const UsdImagingSceneIndices sceneIndices =
+        UsdImagingCreateSceneIndices(info);
+
+    Model model;
+    model.AddSceneIndexBase(sceneIndices.finalSceneIndex);
+    sceneIndices.stageSceneIndex->SetStage(stage);
+    model.SetStage(stage, sceneIndices.stageSceneIndex);
+
+    XformFilterSceneIndexRefPtr xformSceneIndex = model.GetXformSceneIndex();
+    ColorFilterSceneIndexRefPtr colorSceneIndex = model.GetColorSceneIndex();
+    report.loadTime = _GetElapsed(start);
+
+    // a recording without camera still renders once per frame
+    vector<string> viewportIds = _viewportIds;
+    if (viewportIds.empty()) viewportIds.push_back(string());
+
+    start = chrono::steady_clock::now();
+    map<string, unique_ptr<Engine>> engines;
+    for (auto&& viewportId : viewportIds) {
+        auto& engine = engines[viewportId];
+        engine = make_unique<Engine>(model.GetFinalSceneIndex(),
+                                     rendererPlugin);
+        engine->SetRenderSize(width, height);
+        engine->Render();
+    }
+    report.firstRenderTime = _GetElapsed(start);
+    report.viewportCount = engines.size();
+
+    report.isValid = true;
+    _noticeCount = 0;
+    model.GetFinalSceneIndex()->AddObserver(HdSceneIndexObserverPtr(this));
+
+    for (auto&& frame : _frames) {
+        start = chrono::steady_clock::now();
+        for (auto&& edit : frame.edits) {
+            switch (edit.type) {
+                case NoticeRecordType::Xform:
+                    xformSceneIndex->SetXform(edit.primPath, edit.matrix);
+                    break;
+                case NoticeRecordType::DisplayColor:
+                    colorSceneIndex->SetDisplayColor(edit.primPath,
+                                                     edit.color);
+                    break;
+                case NoticeRecordType::Selection:
+                    model.SetSelection(edit.primPaths);
+                    for (auto&& it : engines)
+                        it.second->SetSelection(edit.primPaths);
+                    break;
+                case NoticeRecordType::Time:
+                    model.SetTime(isnan(edit.time) ? UsdTimeCode::Default()
+                                                   : UsdTimeCode(edit.time));
+                    break;
+                case NoticeRecordType::Camera:
+                    engines[edit.viewportId]->SetCameraMatrices(edit.matrix,
+                                                                edit.proj);
+                    break;
+                case NoticeRecordType::SessionLayer:
+                    stage->GetSessionLayer()->ImportFromString(edit.text);
+                    sceneIndices.stageSceneIndex->ApplyPendingUpdates();
+                    break;
+                default: break;
+            }
+        }
+        double editTime = _GetElapsed(start);
+
+        start = chrono::steady_clock::now();
+        for (auto&& it : engines) it.second->Render();
+        double renderTime = _GetElapsed(start);
+
+        report.frameCount++;
+        report.editCount += frame.edits.size();
+        report.recordedNoticeCount += frame.noticeCount;
+        report.editTime += editTime;
+        report.renderTime += renderTime;
+        report.maxFrameTime = max(report.maxFrameTime, editTime + renderTime);
+    }
+
+    model.GetFinalSceneIndex()->RemoveObserver(HdSceneIndexObserverPtr(this));
+    report.replayedNoticeCount = _noticeCount;
+    return report;
+}
+
+void NoticeReplayer::PrimsAdded(const HdSceneIndexBase& sender,
+                                const AddedPrimEntries& entries)
+{
+    _noticeCount += entries.size();
+}
+
+void NoticeReplayer::PrimsRemoved(const HdSceneIndexBase& sender,
+                                  const RemovedPrimEntries& entries)
+{
+    _noticeCount += entries.size();
+}
+
+void NoticeReplayer::PrimsDirtied(const HdSceneIndexBase& sender,
+                                  const DirtiedPrimEntries& entries)
+{
+    _noticeCount += entries.size();
+}
+
+void NoticeReplayer::PrimsRenamed(const HdSceneIndexBase& sender,
+                                  const RenamedPrimEntries& entries)
+{
+    _noticeCount += entries.size();
+}
+
+string NoticeReplayer::_ReadString()
+{
+    uint32_t index = _Read<uint32_t>();
+    if (index < _strings.size()) return _strings[index];
+
+    uint32_t size = _Read<uint32_t>();
+    string str(size, '\0');
+    _file.read(str.data(), size);
+    _strings.push_back(str);
+    return str;
+}
+
+bool NoticeReplayer::_ReadRecord()
+{
+    NoticeRecordType type = _Read<NoticeRecordType>();
+    _Read<double>();
+    if (!_file) return false;
+
+    _Frame& frame = _frames.back();
+    _Edit edit = {};
+    edit.type = type;
+
+    // the notices are only counted, they are the consequences of the edits
+    switch (type) {
+        case NoticeRecordType::Frame: _frames.push_back({}); return true;
+        case NoticeRecordType::PrimsAdded: {
+            uint32_t count = _Read<uint32_t>();
+            for (uint32_t i = 0; i < count; i++) {
+                _ReadString();
+                _ReadString();
+            }
+            frame.noticeCount += count;
+            return bool(_file);
+        }
+        case NoticeRecordType::PrimsRemoved: {
+            uint32_t count = _Read<uint32_t>();
+            for (uint32_t i = 0; i < count; i++) _ReadString();
+            frame.noticeCount += count;
+            return bool(_file);
+        }
+        case NoticeRecordType::PrimsDirtied: {
+            uint32_t count = _Read<uint32_t>();
+            for (uint32_t i = 0; i < count; i++) {
+                _ReadString();
+                uint32_t locatorCount = _Read<uint32_t>();
+                for (uint32_t j = 0; j < locatorCount; j++) _ReadString();
+            }
+            frame.noticeCount += count;
+            return bool(_file);
+        }
+        case NoticeRecordType::PrimsRenamed: {
+            uint32_t count = _Read<uint32_t>();
+            for (uint32_t i = 0; i < count; i++) {
+                _ReadString();
+                _ReadString();
+            }
+            frame.noticeCount += count;
+            return bool(_file);
+        }
+        case NoticeRecordType::Xform:
+            edit.primPath = SdfPath(_ReadString());
+            edit.matrix = _Read<GfMatrix4d>();
+            break;
+        case NoticeRecordType::DisplayColor:
+            edit.primPath = SdfPath(_ReadString());
+            edit.color = _Read<GfVec3f>();
+            break;
+        case NoticeRecordType::Selection: {
+            uint32_t count = _Read<uint32_t>();
+            for (uint32_t i = 0; i < count; i++)
+                edit.primPaths.push_back(SdfPath(_ReadString()));
+            break;
+        }
+        case NoticeRecordType::Time: edit.time = _Read<double>(); break;
+        case NoticeRecordType::Camera:
+            edit.viewportId = _ReadString();
+            edit.matrix = _Read<GfMatrix4d>();
+            edit.proj = _Read<GfMatrix4d>();
+            if (find(_viewportIds.begin(), _viewportIds.end(),
+                     edit.viewportId) == _viewportIds.end())
+                _viewportIds.push_back(edit.viewportId);
+            break;
+        case NoticeRecordType::SessionLayer: {
+            uint32_t size = _Read<uint32_t>();
+            edit.text.resize(size);
+            _file.read(edit.text.data(), size);
+            break;
+        }
+        default:
+            TF_WARN("Unknown record %d in the notice file, the records after "
+                    "it are not replayed.",
+                    int(type));
+            return false;
+    }
+    if (!_file) return false;
+
+    frame.edits.push_back(edit);
+    return true;
+}
+
+PXR_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,178 @@
+/**
+ * @file noticereplayer.h
+ * @author Raphael Jouretz (rjouretz.com)
+ * @brief NoticeReplayer re-issues the edits of a notice file recorded by
+ * NoticeRecorder against a freshly loaded stage and measures the time spent
+ * to propagate and render them.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <pxr/base/gf/matrix4d.h>
+#include <pxr/base/gf/vec3f.h>
+#include <pxr/base/tf/token.h>
+#include <pxr/imaging/hd/sceneIndexObserver.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "noticerecorder.h"
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+using namespace std;
+
+/**
+ * @brief The measures of a replay, the times are in seconds
+ *
+ * @param isValid false if the stage could not be loaded
+ * @param frameCount the number of frames replayed
+ * @param viewportCount the number of viewports rendered, one engine each
+ * @param editCount the number of edits replayed
+ * @param recordedNoticeCount the number of prims notified while recording
+ * @param replayedNoticeCount the number of prims notified while replaying
+ * @param loadTime the time to load the stage
+ * @param firstRenderTime the time of the first render, syncing the whole
+ * stage
+ * @param editTime the time to apply the edits and propagate their notices
+ * through the scene indices
+ * @param renderTime the time to sync the render index and render the frames
+ * @param maxFrameTime the time of the slowest frame
+ */
+struct NoticeReplayReport {
+    bool isValid;
+    size_t frameCount, viewportCount, editCount;
+    size_t recordedNoticeCount, replayedNoticeCount;
+    double loadTime, firstRenderTime, editTime, renderTime, maxFrameTime;
+};
+
+/**
+ * @brief NoticeReplayer re-issues the edits of a notice file recorded by
+ * NoticeRecorder against a freshly loaded stage and measures the time spent
+ * to propagate and render them.
+ *
+ * The edits of a recorded frame are applied together then rendered once, so
+ * that a replay does not depend on the speed of the machine. The replay
+ * scene indices only hold the edit filters of the model the edits go
+ * through. Each recorded viewport is rendered by an engine of its own,
+ * following its own camera. A record of an unknown type stops the loading
+ * with a warning rather than being skipped.
+ */
+class NoticeReplayer : public HdSceneIndexObserver {
+    public:
+        /**
+         * @brief Construct a new NoticeReplayer object
+         *
+         */
+        NoticeReplayer();
+
+        /**
+         * @brief Load a notice file
+         *
+         * @param filePath the path of the notice file
+         * @return true if the file is a valid notice file, false otherwise
+         */
+        bool Load(const string& filePath);
+
+        /**
+         * @brief Get the identifier of the stage the notice file was
+         * recorded on
+         *
+         * @return the identifier of the stage
+         */
+        const string& GetStageIdentifier() const;
+
+        /**
+         * @brief Replay the loaded edits against a stage. Requires a current
+         * graphics context for GPU renderers.
+         *
+         * @param stageFilePath the path of the stage to load
+         * @param rendererPlugin the renderer plugin to render with
+         * @param width the width of the render
+         * @param height the height of the render
+         * @return the measures of the replay
+         */
+        NoticeReplayReport Run(const string& stageFilePath,
+                               TfToken rendererPlugin, int width, int height);
+
+        /**
+         * @brief Override of HdSceneIndexObserver::PrimsAdded
+         */
+        void PrimsAdded(const HdSceneIndexBase& sender,
+                        const AddedPrimEntries& entries) override;
+
+        /**
+         * @brief Override of HdSceneIndexObserver::PrimsRemoved
+         */
+        void PrimsRemoved(const HdSceneIndexBase& sender,
+                          const RemovedPrimEntries& entries) override;
+
+        /**
+         * @brief Override of HdSceneIndexObserver::PrimsDirtied
+         */
+        void PrimsDirtied(const HdSceneIndexBase& sender,
+                          const DirtiedPrimEntries& entries) override;
+
+        /**
+         * @brief Override of HdSceneIndexObserver::PrimsRenamed
+         */
+        void PrimsRenamed(const HdSceneIndexBase& sender,
+                          const RenamedPrimEntries& entries) override;
+
+    private:
+        struct _Edit {
+            NoticeRecordType type;
+            SdfPath primPath;
+            SdfPathVector primPaths;
+            GfMatrix4d matrix, proj;
+            GfVec3f color;
+            double time;
+            string viewportId, text;
+        };
+
+        struct _Frame {
+            vector<_Edit> edits;
+            size_t noticeCount;
+        };
+
+        string _stageIdentifier;
+        vector<_Frame> _frames;
+        vector<string> _viewportIds;
+        size_t _noticeCount;
+
+        ifstream _file;
+        vector<string> _strings;
+
+        /**
+         * @brief Read a plain value
+         *
+         * @return the value read
+         */
+        template <typename T>
+        T _Read()
+        {
+            T value = T();
+            _file.read(reinterpret_cast<char*>(&value), sizeof(T));
+            return value;
+        }
+
+        /**
+         * @brief Read a string written once and referred to by its index
+         * afterwards
+         *
+         * @return the string read
+         */
+        string _ReadString();
+
+        /**
+         * @brief Read a record and append it to the frames
+         *
+         * @return false at the end of the file or on an unknown record
+         */
+        bool _ReadRecord();
+};
+
+PXR_NAMESPACE_CLOSE_SCOPE
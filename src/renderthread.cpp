@@ -0,0 +1,123 @@
+#include "renderthread.h"
+
+#include <chrono>
+#include <future>
+
+#include "backends/backend.h"
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+RenderThread::RenderThread(void* context, function<void()> renderFrame)
+    : _queue(_QUEUE_SIZE),
+      _head(0),
+      _tail(0),
+      _isFrameRequested(false),
+      _isStopping(false),
+      _context(context),
+      _renderFrame(renderFrame)
+{
+    _thread = thread(&RenderThread::_Loop, this);
+}
+
+RenderThread::~RenderThread()
+{
+    _isStopping = true;
+    _Wake();
+    _thread.join();
+}
+
+void RenderThread::Post(function<void()> command)
+{
+    // the queue is only full if the render thread is stuck, the UI thread
+    // waits for a free slot rather than dropping an edit
+    size_t tail = _tail.load(memory_order_relaxed);
+    while (tail - _head.load(memory_order_acquire) >= _QUEUE_SIZE) {
+        _Wake();
+        this_thread::yield();
+    }
+
+    _queue[tail % _QUEUE_SIZE] = std::move(command);
+    _tail.store(tail + 1, memory_order_release);
+    _Wake();
+}
+
+void RenderThread::Run(function<void()> command)
+{
+    if (IsRenderThread()) {
+        command();
+        return;
+    }
+
+    promise<void> isDone;
+    Post([&command, &isDone]() {
+        command();
+        isDone.set_value();
+    });
+    isDone.get_future().wait();
+}
+
+void RenderThread::RequestFrame()
+{
+    _isFrameRequested = true;
+    _Wake();
+}
+
+bool RenderThread::IsRenderThread() const
+{
+    return this_thread::get_id() == _thread.get_id();
+}
+
+bool RenderThread::Lock(mutex& mutex)
+{
+    while (!mutex.try_lock()) {
+        if (_isStopping) return false;
+        _RunCommands();
+
+        unique_lock<std::mutex> lock(_wakeMutex);
+        _wakeCondition.wait_for(lock, chrono::milliseconds(1));
+    }
+    return true;
+}
+
+void RenderThread::_Loop()
+{
+    MakeContextCurrentBackend(_context);
+
+    while (!_isStopping) {
+        {
+            unique_lock<mutex> lock(_wakeMutex);
+            _wakeCondition.wait(lock, [this]() {
+                return _isStopping || _isFrameRequested ||
+                       _head.load() != _tail.load();
+            });
+        }
+
+        _RunCommands();
+        if (!_isStopping && _isFrameRequested.exchange(false)) _renderFrame();
+    }
+
+    // the commands posted before the stop still run, the UI thread may be
+    // waiting for them
+    _RunCommands();
+    MakeContextCurrentBackend(nullptr);
+}
+
+void RenderThread::_RunCommands()
+{
+    size_t head = _head.load(memory_order_relaxed);
+    while (head != _tail.load(memory_order_acquire)) {
+        function<void()> command = std::move(_queue[head % _QUEUE_SIZE]);
+        _head.store(++head, memory_order_release);
+        command();
+    }
+}
+
+void RenderThread::_Wake()
+{
+    // taking the mutex orders the wake up with the wait of the render
+    // thread, the queue itself is never locked
+    { lock_guard<mutex> lock(_wakeMutex); }
+    _wakeCondition.notify_one();
+}
+
+PXR_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,123 @@
+/**
+ * @file renderthread.h
+ * @author Raphael Jouretz (rjouretz.com)
+ * @brief RenderThread runs the commands and the frames of an Engine on a
+ * dedicated thread owning a graphics context shared with the UI.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <pxr/pxr.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+using namespace std;
+
+/**
+ * @brief RenderThread runs the commands and the frames of an Engine on a
+ * dedicated thread owning a graphics context shared with the UI.
+ *
+ * The commands are posted by the UI thread through a lock-free single
+ * producer single consumer queue and run in order before the next frame. A
+ * frame request is coalesced with the ones not started yet, so that the
+ * render thread always renders the newest state.
+ */
+class RenderThread {
+    public:
+        /**
+         * @brief Construct a new RenderThread object and start the thread.
+         * The context must be created on the UI thread.
+         *
+         * @param context the graphics context made current on the thread
+         * @param renderFrame the function rendering a frame
+         */
+        RenderThread(void* context, function<void()> renderFrame);
+
+        /**
+         * @brief Stop the thread once the current command or frame is done
+         * and destroy the RenderThread object
+         *
+         */
+        ~RenderThread();
+
+        /**
+         * @brief Post a command to run on the render thread before the next
+         * frame, without waiting for it
+         *
+         * @param command the command to run
+         */
+        void Post(function<void()> command);
+
+        /**
+         * @brief Run a command on the render thread and wait for it
+         *
+         * @param command the command to run
+         */
+        void Run(function<void()> command);
+
+        /**
+         * @brief Request the render thread to render a frame
+         *
+         */
+        void RequestFrame();
+
+        /**
+         * @brief Check if the caller runs on the render thread
+         *
+         * @return true if called from the render thread
+         */
+        bool IsRenderThread() const;
+
+        /**
+         * @brief Lock a mutex shared with the UI thread from the render
+         * thread. The commands posted meanwhile keep running, as the UI
+         * thread may wait for one of them while holding the mutex.
+         *
+         * @param mutex the mutex to lock
+         * @return false if the thread is stopping, the mutex is not locked
+         */
+        bool Lock(mutex& mutex);
+
+    private:
+        const size_t _QUEUE_SIZE = 1024;
+
+        vector<function<void()>> _queue;
+        atomic<size_t> _head, _tail;
+        atomic<bool> _isFrameRequested, _isStopping;
+
+        mutex _wakeMutex;
+        condition_variable _wakeCondition;
+
+        void* _context;
+        function<void()> _renderFrame;
+        thread _thread;
+
+        /**
+         * @brief The loop of the render thread
+         *
+         */
+        void _Loop();
+
+        /**
+         * @brief Run the commands posted so far
+         *
+         */
+        void _RunCommands();
+
+        /**
+         * @brief Wake the render thread up
+         *
+         */
+        void _Wake();
+};
+
+PXR_NAMESPACE_CLOSE_SCOPE
@@ -57,6 +57,18 @@ void ColorFilterSceneIndex::SetDisplayColor(const SdfPath &primPath,
     _SendPrimsDirtied(entries);
 }
 
+size_t ColorFilterSceneIndex::GetMemoryUsage() const
+{
+    // the values do not fit in the local storage of VtValue and are held on
+    // the heap, each node of the dictionary holds its links and its pair
+    size_t memory = sizeof(VtDictionary);
+    for (auto &&it : _colorDict) {
+        memory += 3 * sizeof(void *) + sizeof(VtDictionary::value_type) +
+                  it.first.capacity() + sizeof(GfVec3f);
+    }
+    return memory;
+}
+
 HdSceneIndexPrim ColorFilterSceneIndex::GetPrim(const SdfPath &primPath) const
 {
     HdSceneIndexPrim prim = _GetInputSceneIndex()->GetPrim(primPath);
@@ -67,6 +67,14 @@ class ColorFilterSceneIndex : public HdSingleInputFilteringSceneIndexBase {
          */
         void SetDisplayColor(const SdfPath &primPath, GfVec3f color);
 
+        /**
+         * @brief Get an estimation of the memory used by the overwritten
+         * display colors
+         *
+         * @return size_t the memory used in bytes
+         */
+        size_t GetMemoryUsage() const;
+
         /**
          * @brief Override of
          * HdSingleInputFilteringSceneIndexBase::GetPrim
@@ -0,0 +1,539 @@
+#include "cullingsceneindex.h"
+
+#include "displaymodesceneindex.h"
+
+#include <pxr/base/gf/bbox3d.h>
+#include <pxr/base/gf/matrix4d.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/imaging/hd/extentSchema.h>
+#include <pxr/imaging/hd/instancedBySchema.h>
+#include <pxr/imaging/hd/overlayContainerDataSource.h>
+#include <pxr/imaging/hd/primvarsSchema.h>
+#include <pxr/imaging/hd/retainedDataSource.h>
+#include <pxr/imaging/hd/sceneIndexPrimView.h>
+#include <pxr/imaging/hd/tokens.h>
+#include <pxr/imaging/hd/visibilitySchema.h>
+#include <pxr/imaging/hd/xformSchema.h>
+
+#include <algorithm>
+#include <limits>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+CullingSceneIndex::CullingSceneIndex(
+    const HdSceneIndexBaseRefPtr &inputSceneIndex)
+    : HdSingleInputFilteringSceneIndexBase(inputSceneIndex),
+      _isEnabled(false),
+      _isTreeDirty(false),
+      _isDrawingSmallPrimsAsBounds(false),
+      _maxDistance(0),
+      _minScreenSize(0)
+{
+    SetDisplayName("CullingSceneIndex");
+}
+
+void CullingSceneIndex::SetEnabled(bool isEnabled)
+{
+    if (_isEnabled == isEnabled) return;
+    _isEnabled = isEnabled;
+
+    if (_isEnabled) {
+        _Populate();
+        _Cull();
+        return;
+    }
+
+    // show the culled prims back and stop tracking the bounds
+    HdSceneIndexObserver::DirtiedPrimEntries entries;
+    for (auto &&path : _culledPaths)
+        entries.push_back({path, HdVisibilitySchema::GetDefaultLocator()});
+
+    SdfPathVector smallPaths(_smallPaths.begin(), _smallPaths.end());
+
+    _culledPaths.clear();
+    _smallPaths.clear();
+    _bounds.clear();
+    _boundIndices.clear();
+    _nodes.clear();
+
+    if (!entries.empty()) _SendPrimsDirtied(entries);
+    _SendTypeChanges(smallPaths);
+}
+
+bool CullingSceneIndex::IsEnabled() const
+{
+    return _isEnabled;
+}
+
+void CullingSceneIndex::SetFrustum(const GfFrustum &frustum)
+{
+    if (frustum == _frustum) return;
+    _frustum = frustum;
+    _Cull();
+}
+
+void CullingSceneIndex::SetMaxDistance(double distance)
+{
+    if (distance == _maxDistance) return;
+    _maxDistance = distance;
+    _Cull();
+}
+
+double CullingSceneIndex::GetMaxDistance() const
+{
+    return _maxDistance;
+}
+
+void CullingSceneIndex::SetMinScreenSize(double size)
+{
+    if (size == _minScreenSize) return;
+    _minScreenSize = size;
+    _Cull();
+}
+
+double CullingSceneIndex::GetMinScreenSize() const
+{
+    return _minScreenSize;
+}
+
+void CullingSceneIndex::SetSmallPrimsAsBounds(bool isEnabled)
+{
+    if (isEnabled == _isDrawingSmallPrimsAsBounds) return;
+    _isDrawingSmallPrimsAsBounds = isEnabled;
+    _Cull();
+}
+
+bool CullingSceneIndex::IsDrawingSmallPrimsAsBounds() const
+{
+    return _isDrawingSmallPrimsAsBounds;
+}
+
+void CullingSceneIndex::CopySettings(const CullingSceneIndexRefPtr &other)
+{
+    // enabled last, so that the prims are only culled once
+    SetMaxDistance(other->_maxDistance);
+    SetMinScreenSize(other->_minScreenSize);
+    SetSmallPrimsAsBounds(other->_isDrawingSmallPrimsAsBounds);
+    SetFrustum(other->_frustum);
+    SetEnabled(other->_isEnabled);
+}
+
+size_t CullingSceneIndex::GetBoundCount() const
+{
+    return _bounds.size();
+}
+
+size_t CullingSceneIndex::GetCulledCount() const
+{
+    return _culledPaths.size();
+}
+
+HdSceneIndexPrim CullingSceneIndex::GetPrim(const SdfPath &primPath) const
+{
+    HdSceneIndexPrim prim = _GetInputSceneIndex()->GetPrim(primPath);
+    if (!prim.dataSource) return prim;
+
+    if (_smallPaths.count(primPath) && HdPrimTypeIsGprim(prim.primType))
+        return DisplayModeSceneIndex::BuildBoundsPrim(prim);
+
+    if (_culledPaths.count(primPath) == 0 && _smallPaths.count(primPath) == 0)
+        return prim;
+
+    prim.dataSource = HdOverlayContainerDataSource::New(
+        HdRetainedContainerDataSource::New(
+            HdVisibilitySchemaTokens->visibility,
+            HdVisibilitySchema::Builder()
+                .SetVisibility(
+                    HdRetainedTypedSampledDataSource<bool>::New(false))
+                .Build()),
+        prim.dataSource);
+
+    return prim;
+}
+
+SdfPathVector CullingSceneIndex::GetChildPrimPaths(
+    const SdfPath &primPath) const
+{
+    return _GetInputSceneIndex()->GetChildPrimPaths(primPath);
+}
+
+void CullingSceneIndex::_PrimsAdded(
+    const HdSceneIndexBase &sender,
+    const HdSceneIndexObserver::AddedPrimEntries &entries)
+{
+    if (_isEnabled) {
+        SdfPathVector primPaths;
+        for (auto &&entry : entries) primPaths.push_back(entry.primPath);
+        _UpdateBounds(primPaths);
+
+        // culled before being forwarded, so that hidden prims never sync
+        _Cull();
+    }
+
+    if (_smallPaths.empty()) {
+        _SendPrimsAdded(entries);
+        return;
+    }
+
+    HdSceneIndexObserver::AddedPrimEntries newEntries;
+    for (auto &&entry : entries) {
+        if (_smallPaths.count(entry.primPath))
+            newEntries.push_back({entry.primPath,
+                                  GetPrim(entry.primPath).primType});
+        else newEntries.push_back(entry);
+    }
+    _SendPrimsAdded(newEntries);
+}
+
+void CullingSceneIndex::_PrimsRemoved(
+    const HdSceneIndexBase &sender,
+    const HdSceneIndexObserver::RemovedPrimEntries &entries)
+{
+    if (_isEnabled) {
+        SdfPathVector primPaths;
+        for (auto &&entry : entries) primPaths.push_back(entry.primPath);
+        _RemoveBounds(primPaths);
+    }
+    _SendPrimsRemoved(entries);
+}
+
+void CullingSceneIndex::_PrimsDirtied(
+    const HdSceneIndexBase &sender,
+    const HdSceneIndexObserver::DirtiedPrimEntries &entries)
+{
+    static const HdDataSourceLocatorSet boundLocators = {
+        HdXformSchema::GetDefaultLocator(),
+        HdExtentSchema::GetDefaultLocator()};
+
+    // the boxes of the small prims follow their extent
+    HdSceneIndexObserver::DirtiedPrimEntries newEntries = entries;
+    SdfPathVector primPaths;
+    for (auto &&entry : newEntries) {
+        if (!entry.dirtyLocators.Intersects(boundLocators)) continue;
+        primPaths.push_back(entry.primPath);
+        if (_smallPaths.count(entry.primPath))
+            entry.dirtyLocators.insert(HdPrimvarsSchema::GetPointsLocator());
+    }
+
+    _SendPrimsDirtied(newEntries);
+    if (!_isEnabled) return;
+
+    if (primPaths.empty()) return;
+
+    _UpdateBounds(primPaths);
+    _Cull();
+}
+
+void CullingSceneIndex::_Populate()
+{
+    _bounds.clear();
+    _boundIndices.clear();
+    _culledPaths.clear();
+
+    SdfPathVector primPaths;
+    for (const SdfPath &primPath : HdSceneIndexPrimView(_GetInputSceneIndex()))
+        primPaths.push_back(primPath);
+
+    _UpdateBounds(primPaths);
+    _isTreeDirty = true;
+}
+
+void CullingSceneIndex::_UpdateBounds(const SdfPathVector &primPaths)
+{
+    // reading the prims is the costly part, it runs on all the cores
+    std::vector<GfRange3d> ranges(primPaths.size());
+    std::vector<char> hasBounds(primPaths.size(), 0);
+    WorkParallelForN(primPaths.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            hasBounds[i] = _ComputeBound(primPaths[i], &ranges[i]);
+    });
+
+    SdfPathVector removedPaths;
+    size_t movedCount = 0;
+    for (size_t i = 0; i < primPaths.size(); i++) {
+        auto it = _boundIndices.find(primPaths[i]);
+        if (!hasBounds[i]) {
+            if (it != _boundIndices.end()) removedPaths.push_back(it->first);
+        }
+        else if (it != _boundIndices.end()) {
+            _bounds[it->second].range = ranges[i];
+            movedCount++;
+        }
+        else {
+            _boundIndices[primPaths[i]] = _bounds.size();
+            _bounds.push_back({primPaths[i], ranges[i]});
+            _isTreeDirty = true;
+        }
+    }
+
+    // prims losing their extent are removed alone, not their descendants
+    if (!removedPaths.empty()) {
+        std::unordered_set<SdfPath, SdfPath::Hash> removed(
+            removedPaths.begin(), removedPaths.end());
+        _bounds.erase(std::remove_if(_bounds.begin(), _bounds.end(),
+                                     [&](const _Bound &bound) {
+                                         return removed.count(bound.path);
+                                     }),
+                      _bounds.end());
+        _boundIndices.clear();
+        for (size_t i = 0; i < _bounds.size(); i++)
+            _boundIndices[_bounds[i].path] = i;
+
+        // they stay culled until the next cull dirties them back
+        _isTreeDirty = true;
+    }
+
+    if (movedCount > _REBUILD_RATIO * _bounds.size()) _isTreeDirty = true;
+    if (!_isTreeDirty && !_nodes.empty()) _RefitNode(0);
+}
+
+void CullingSceneIndex::_RemoveBounds(const SdfPathVector &primPaths)
+{
+    auto isRemoved = [&](const SdfPath &path) {
+        for (auto &&primPath : primPaths)
+            if (path.HasPrefix(primPath)) return true;
+        return false;
+    };
+
+    _bounds.erase(std::remove_if(_bounds.begin(), _bounds.end(),
+                                 [&](const _Bound &bound) {
+                                     return isRemoved(bound.path);
+                                 }),
+                  _bounds.end());
+
+    for (auto paths : {&_culledPaths, &_smallPaths}) {
+        for (auto it = paths->begin(); it != paths->end();) {
+            if (isRemoved(*it)) it = paths->erase(it);
+            else ++it;
+        }
+    }
+
+    _boundIndices.clear();
+    for (size_t i = 0; i < _bounds.size(); i++)
+        _boundIndices[_bounds[i].path] = i;
+
+    _nodes.clear();
+    _isTreeDirty = true;
+}
+
+bool CullingSceneIndex::ComputeWorldBound(const HdSceneIndexPrim &prim,
+                                          GfRange3d *range)
+{
+    if (!prim.dataSource) return false;
+
+    // instanced prims are drawn at the location of their instances, the
+    // extent of their instancer covers them
+    if (HdInstancedBySchema::GetFromParent(prim.dataSource).IsDefined())
+        return false;
+
+    HdExtentSchema extentSchema = HdExtentSchema::GetFromParent(prim.dataSource);
+    if (!extentSchema.GetMin() || !extentSchema.GetMax()) return false;
+
+    HdSampledDataSource::Time time(0);
+    GfRange3d extent(extentSchema.GetMin()->GetTypedValue(time),
+                     extentSchema.GetMax()->GetTypedValue(time));
+    if (extent.IsEmpty()) return false;
+
+    // the xforms are flattened by the usd imaging scene indices
+    GfMatrix4d xform(1);
+    HdXformSchema xformSchema = HdXformSchema::GetFromParent(prim.dataSource);
+    if (xformSchema.GetMatrix())
+        xform = xformSchema.GetMatrix()->GetTypedValue(time);
+
+    *range = GfBBox3d(extent, xform).ComputeAlignedRange();
+    return true;
+}
+
+double CullingSceneIndex::ComputeScreenSize(const GfFrustum &frustum,
+                                            const GfRange3d &range)
+{
+    if (frustum.GetProjectionType() != GfFrustum::Perspective)
+        return std::numeric_limits<double>::infinity();
+
+    double radius = range.GetSize().GetLength() / 2;
+    double distance = (range.GetMidpoint() - frustum.GetPosition()).GetLength();
+    if (distance <= radius) return std::numeric_limits<double>::infinity();
+
+    // the window of the frustum lies on its reference plane
+    double halfHeight = frustum.GetWindow().GetSize()[1] / 2 /
+                        frustum.GetReferencePlaneDepth();
+    return radius / (distance * halfHeight);
+}
+
+bool CullingSceneIndex::_ComputeBound(const SdfPath &primPath,
+                                      GfRange3d *range) const
+{
+    return ComputeWorldBound(_GetInputSceneIndex()->GetPrim(primPath), range);
+}
+
+void CullingSceneIndex::_BuildTree()
+{
+    _isTreeDirty = false;
+    _nodes.clear();
+    if (_bounds.empty()) {
+        _boundIndices.clear();
+        return;
+    }
+
+    _nodes.resize(2 * _bounds.size() - 1);
+
+    WorkDispatcher dispatcher;
+    _BuildNode(0, 0, _bounds.size(), &dispatcher);
+    dispatcher.Wait();
+
+    // the bounds were reordered by the build
+    _boundIndices.clear();
+    for (size_t i = 0; i < _bounds.size(); i++)
+        _boundIndices[_bounds[i].path] = i;
+}
+
+void CullingSceneIndex::_BuildNode(size_t nodeIndex, size_t first,
+                                   size_t count, WorkDispatcher *dispatcher)
+{
+    _Node &node = _nodes[nodeIndex];
+    node.range = GfRange3d();
+    for (size_t i = first; i < first + count; i++)
+        node.range.UnionWith(_bounds[i].range);
+
+    node.first = first;
+    node.count = count;
+    node.isLeaf = count <= _LEAF_SIZE;
+    if (node.isLeaf) return;
+
+    // split at the median of the longest axis
+    GfVec3d size = node.range.GetSize();
+    int axis = size[0] > size[1] ? (size[0] > size[2] ? 0 : 2)
+                                 : (size[1] > size[2] ? 1 : 2);
+    size_t leftCount = count / 2;
+    auto begin = _bounds.begin() + first;
+    std::nth_element(begin, begin + leftCount, begin + count,
+                     [axis](const _Bound &a, const _Bound &b) {
+                         return a.range.GetMidpoint()[axis] <
+                                b.range.GetMidpoint()[axis];
+                     });
+
+    size_t left = nodeIndex + 1;
+    size_t right = nodeIndex + 2 * leftCount;
+    node.left = left;
+    node.right = right;
+
+    if (count > _PARALLEL_BUILD_SIZE) {
+        dispatcher->Run([this, left, first, leftCount, dispatcher]() {
+            _BuildNode(left, first, leftCount, dispatcher);
+        });
+    }
+    else _BuildNode(left, first, leftCount, dispatcher);
+    _BuildNode(right, first + leftCount, count - leftCount, dispatcher);
+}
+
+void CullingSceneIndex::_RefitNode(size_t nodeIndex)
+{
+    _Node &node = _nodes[nodeIndex];
+    node.range = GfRange3d();
+
+    if (node.isLeaf) {
+        for (size_t i = node.first; i < node.first + node.count; i++)
+            node.range.UnionWith(_bounds[i].range);
+        return;
+    }
+
+    _RefitNode(node.left);
+    _RefitNode(node.right);
+    node.range.UnionWith(_nodes[node.left].range);
+    node.range.UnionWith(_nodes[node.right].range);
+}
+
+void CullingSceneIndex::_Cull()
+{
+    if (!_isEnabled) return;
+    if (_isTreeDirty) _BuildTree();
+
+    std::unordered_set<SdfPath, SdfPath::Hash> culledPaths, smallPaths;
+    if (!_nodes.empty()) _CullNode(0, &culledPaths, &smallPaths);
+
+    // only the prims whose culling changed are dirtied
+    HdSceneIndexObserver::DirtiedPrimEntries entries;
+    for (auto &&path : culledPaths) {
+        if (_culledPaths.count(path) == 0)
+            entries.push_back({path, HdVisibilitySchema::GetDefaultLocator()});
+    }
+    for (auto &&path : _culledPaths) {
+        if (culledPaths.count(path) == 0)
+            entries.push_back({path, HdVisibilitySchema::GetDefaultLocator()});
+    }
+
+    // the prims switching between boxes and geometry change type
+    SdfPathVector typeChangedPaths;
+    for (auto &&path : smallPaths) {
+        if (_smallPaths.count(path) == 0) typeChangedPaths.push_back(path);
+    }
+    for (auto &&path : _smallPaths) {
+        if (smallPaths.count(path) == 0) typeChangedPaths.push_back(path);
+    }
+
+    _culledPaths.swap(culledPaths);
+    _smallPaths.swap(smallPaths);
+    if (!entries.empty()) _SendPrimsDirtied(entries);
+    _SendTypeChanges(typeChangedPaths);
+}
+
+void CullingSceneIndex::_SendTypeChanges(const SdfPathVector &primPaths)
+{
+    HdSceneIndexObserver::AddedPrimEntries entries;
+    for (auto &&path : primPaths) {
+        HdSceneIndexPrim prim = GetPrim(path);
+        if (prim.dataSource) entries.push_back({path, prim.primType});
+    }
+    if (!entries.empty()) _SendPrimsAdded(entries);
+}
+
+void CullingSceneIndex::_CullNode(
+    size_t nodeIndex, std::unordered_set<SdfPath, SdfPath::Hash> *culledPaths,
+    std::unordered_set<SdfPath, SdfPath::Hash> *smallPaths)
+{
+    const _Node &node = _nodes[nodeIndex];
+
+    if (_IsRangeCulled(node.range)) {
+        for (size_t i = node.first; i < node.first + node.count; i++)
+            culledPaths->insert(_bounds[i].path);
+        return;
+    }
+
+    if (node.isLeaf) {
+        for (size_t i = node.first; i < node.first + node.count; i++) {
+            const _Bound &bound = _bounds[i];
+            if (_IsRangeCulled(bound.range))
+                culledPaths->insert(bound.path);
+            else if (_IsRangeTooSmall(bound.range)) {
+                if (_isDrawingSmallPrimsAsBounds) smallPaths->insert(bound.path);
+                else culledPaths->insert(bound.path);
+            }
+        }
+        return;
+    }
+
+    _CullNode(node.left, culledPaths, smallPaths);
+    _CullNode(node.right, culledPaths, smallPaths);
+}
+
+bool CullingSceneIndex::_IsRangeCulled(const GfRange3d &range) const
+{
+    if (_maxDistance > 0) {
+        GfVec3d eye = _frustum.GetPosition();
+        GfVec3d closest;
+        for (int i = 0; i < 3; i++)
+            closest[i] = std::clamp(eye[i], range.GetMin()[i],
+                                    range.GetMax()[i]);
+        if ((closest - eye).GetLength() > _maxDistance) return true;
+    }
+
+    return !_frustum.Intersects(GfBBox3d(range));
+}
+
+bool CullingSceneIndex::_IsRangeTooSmall(const GfRange3d &range) const
+{
+    if (_minScreenSize <= 0) return false;
+    return ComputeScreenSize(_frustum, range) < _minScreenSize;
+}
+
+PXR_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,350 @@
+/**
+ * @file cullingsceneindex.h
+ * @author Raphael Jouretz (rjouretz.com)
+ * @brief Hydra Filter Scene Index that hides the Hydra Prims outside of a
+ * camera frustum, beyond a distance or too small on screen.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <pxr/base/gf/frustum.h>
+#include <pxr/base/gf/range3d.h>
+#include <pxr/base/work/dispatcher.h>
+#include <pxr/imaging/hd/filteringSceneIndex.h>
+#include <pxr/imaging/hd/sceneIndex.h>
+#include <pxr/pxr.h>
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+class CullingSceneIndex;
+
+TF_DECLARE_REF_PTRS(CullingSceneIndex);
+
+/**
+ * @class CullingSceneIndex
+ * @brief Hydra Filter Scene Index that hides the Hydra Prims outside of a
+ * camera frustum, beyond a distance or too small on screen.
+ *
+ * The world space bounds of the prims with an extent are kept in a bounding
+ * volume hierarchy. Moved prims only refit the hierarchy, it is rebuilt in
+ * parallel when prims are added or removed or when many prims moved. Culled
+ * prims get their visibility overlaid to false, so that the render delegate
+ * neither syncs nor draws them. The prims too small on screen can be drawn
+ * as bounding boxes instead. The culling depends on a single camera, it is
+ * meant to be rendered by a single engine.
+ */
+class CullingSceneIndex : public HdSingleInputFilteringSceneIndexBase {
+    public:
+        /**
+         * @brief Create a ref pointer to a culling scene index
+         *
+         * @return CullingSceneIndexRefPtr the ref pointer to a culling scene
+         * index
+         */
+        static CullingSceneIndexRefPtr New(
+            const HdSceneIndexBaseRefPtr &inputSceneIndex)
+        {
+            return TfCreateRefPtr(new CullingSceneIndex(inputSceneIndex));
+        }
+
+        /**
+         * @brief Construct a new Culling Scene Index object
+         *
+         * @param inputSceneIndex the scene index to cull the prims from
+         */
+        CullingSceneIndex(const HdSceneIndexBaseRefPtr &inputSceneIndex);
+
+        /**
+         * @brief Enable or disable the culling. The bounds are only tracked
+         * while the culling is enabled.
+         *
+         * @param isEnabled true to cull the prims, false to show them all
+         */
+        void SetEnabled(bool isEnabled);
+
+        /**
+         * @brief Get whether the culling is enabled
+         *
+         * @return true if the culling is enabled, false otherwise
+         */
+        bool IsEnabled() const;
+
+        /**
+         * @brief Set the frustum of the camera to cull the prims against
+         *
+         * @param frustum the frustum of the camera
+         */
+        void SetFrustum(const GfFrustum &frustum);
+
+        /**
+         * @brief Set the distance to the camera beyond which the prims are
+         * culled
+         *
+         * @param distance the maximum distance, 0 to disable
+         */
+        void SetMaxDistance(double distance);
+
+        /**
+         * @brief Get the distance to the camera beyond which the prims are
+         * culled
+         *
+         * @return double the maximum distance, 0 if disabled
+         */
+        double GetMaxDistance() const;
+
+        /**
+         * @brief Set the size on screen below which the prims are culled
+         *
+         * @param size the minimum size as a fraction of the screen height,
+         * 0 to disable
+         */
+        void SetMinScreenSize(double size);
+
+        /**
+         * @brief Get the size on screen below which the prims are culled
+         *
+         * @return double the minimum size as a fraction of the screen height
+         */
+        double GetMinScreenSize() const;
+
+        /**
+         * @brief Set whether the prims smaller than the minimum screen size
+         * are drawn as bounding boxes instead of being hidden
+         *
+         * @param isEnabled true to draw the small prims as boxes
+         */
+        void SetSmallPrimsAsBounds(bool isEnabled);
+
+        /**
+         * @brief Get whether the prims smaller than the minimum screen size
+         * are drawn as bounding boxes
+         *
+         * @return true if the small prims are drawn as boxes, false if they
+         * are hidden
+         */
+        bool IsDrawingSmallPrimsAsBounds() const;
+
+        /**
+         * @brief Copy the settings and the frustum of another culling scene
+         * index, used when the filter is created again on top of a new input
+         * @param other the culling scene index to copy the settings from
+         */
+        void CopySettings(const CullingSceneIndexRefPtr &other);
+
+        /**
+         * @brief Get the number of prims with bounds
+         *
+         * @return size_t the number of prims with bounds
+         */
+        size_t GetBoundCount() const;
+
+        /**
+         * @brief Get the number of culled prims
+         *
+         * @return size_t the number of culled prims
+         */
+        size_t GetCulledCount() const;
+
+        /**
+         * @brief Compute the world space bounds of a prim from its extent and
+         * its flattened xform
+         *
+         * @param prim the prim
+         * @param range the resulting bounds
+         * @return true if the prim has an extent, false otherwise
+         */
+        static bool ComputeWorldBound(const HdSceneIndexPrim &prim,
+                                      GfRange3d *range);
+
+        /**
+         * @brief Compute the size on screen of world space bounds
+         *
+         * @param frustum the frustum of the camera
+         * @param range the world space bounds
+         * @return double the size as a fraction of the screen height,
+         * infinity if the camera is inside the bounds or orthographic
+         */
+        static double ComputeScreenSize(const GfFrustum &frustum,
+                                        const GfRange3d &range);
+
+        /**
+         * @brief Override of
+         * HdSingleInputFilteringSceneIndexBase::GetPrim
+         */
+        virtual HdSceneIndexPrim GetPrim(
+            const SdfPath &primPath) const override;
+
+        /**
+         * @brief Override of
+         * HdSingleInputFilteringSceneIndexBase::GetChildPrimPaths
+         */
+        virtual SdfPathVector GetChildPrimPaths(
+            const SdfPath &primPath) const override;
+
+    protected:
+        /**
+         * @brief Override of
+         * HdSingleInputFilteringSceneIndexBase::_PrimsAdded
+         */
+        virtual void _PrimsAdded(
+            const HdSceneIndexBase &sender,
+            const HdSceneIndexObserver::AddedPrimEntries &entries)
+            override;
+
+        /**
+         * @brief Override of
+         * HdSingleInputFilteringSceneIndexBase::_PrimsRemoved
+         */
+        virtual void _PrimsRemoved(
+            const HdSceneIndexBase &sender,
+            const HdSceneIndexObserver::RemovedPrimEntries &entries)
+            override;
+
+        /**
+         * @brief Override of
+         * HdSingleInputFilteringSceneIndexBase::_PrimsDirtied
+         */
+        virtual void _PrimsDirtied(
+            const HdSceneIndexBase &sender,
+            const HdSceneIndexObserver::DirtiedPrimEntries &entries)
+            override;
+
+    private:
+        const size_t _LEAF_SIZE = 4;
+        const size_t _PARALLEL_BUILD_SIZE = 4096;
+        const double _REBUILD_RATIO = .1;
+
+        struct _Bound {
+            SdfPath path;
+            GfRange3d range;
+        };
+
+        struct _Node {
+            GfRange3d range;
+            size_t first, count;
+            size_t left, right;
+            bool isLeaf;
+        };
+
+        bool _isEnabled, _isTreeDirty, _isDrawingSmallPrimsAsBounds;
+        GfFrustum _frustum;
+        double _maxDistance, _minScreenSize;
+
+        std::vector<_Bound> _bounds;
+        std::unordered_map<SdfPath, size_t, SdfPath::Hash> _boundIndices;
+        std::vector<_Node> _nodes;
+        std::unordered_set<SdfPath, SdfPath::Hash> _culledPaths, _smallPaths;
+
+        /**
+         * @brief Collect the bounds of all the prims of the input scene
+         * index and build the hierarchy
+         *
+         */
+        void _Populate();
+
+        /**
+         * @brief Compute the world space bounds of the given prims in
+         * parallel and add, update or remove them. The hierarchy is refitted
+         * if only a few bounds moved, it is marked for rebuild otherwise.
+         *
+         * @param primPaths the paths of the prims
+         */
+        void _UpdateBounds(const SdfPathVector &primPaths);
+
+        /**
+         * @brief Remove the bounds of the prims under the given paths and
+         * mark the hierarchy for rebuild
+         *
+         * @param primPaths the paths of the removed prims
+         */
+        void _RemoveBounds(const SdfPathVector &primPaths);
+
+        /**
+         * @brief Compute the world space bounds of a prim of the input scene
+         * index
+         *
+         * @param primPath the path of the prim
+         * @param range the resulting bounds
+         * @return true if the prim has an extent, false otherwise
+         */
+        bool _ComputeBound(const SdfPath &primPath, GfRange3d *range) const;
+
+        /**
+         * @brief Build the bounding volume hierarchy over all the bounds
+         *
+         */
+        void _BuildTree();
+
+        /**
+         * @brief Build a node of the hierarchy over a range of bounds. A node
+         * over n bounds uses at most 2n - 1 nodes, its children are laid out
+         * right after it so that subtrees can be built concurrently.
+         *
+         * @param nodeIndex the index of the node to build
+         * @param first the index of the first bound of the node
+         * @param count the number of bounds of the node
+         * @param dispatcher the dispatcher running the subtree builds
+         */
+        void _BuildNode(size_t nodeIndex, size_t first, size_t count,
+                        WorkDispatcher *dispatcher);
+
+        /**
+         * @brief Update the range of a node and its descendants from the
+         * bounds
+         *
+         * @param nodeIndex the index of the node to refit
+         */
+        void _RefitNode(size_t nodeIndex);
+
+        /**
+         * @brief Cull the prims and dirty the visibility of those whose
+         * culling changed
+         *
+         */
+        void _Cull();
+
+        /**
+         * @brief Add back the given prims so that the observers pick up
+         * their new type
+         *
+         * @param primPaths the paths of the prims whose type changed
+         */
+        void _SendTypeChanges(const SdfPathVector &primPaths);
+
+        /**
+         * @brief Collect the culled bounds of a node and its descendants
+         *
+         * @param nodeIndex the index of the node to cull
+         * @param culledPaths the culled paths to add to
+         * @param smallPaths the paths drawn as boxes to add to
+         */
+        void _CullNode(
+            size_t nodeIndex,
+            std::unordered_set<SdfPath, SdfPath::Hash> *culledPaths,
+            std::unordered_set<SdfPath, SdfPath::Hash> *smallPaths);
+
+        /**
+         * @brief Get whether a range is outside the frustum or beyond the
+         * maximum distance
+         *
+         * @param range the range to test
+         * @return true if the range is culled, false otherwise
+         */
+        bool _IsRangeCulled(const GfRange3d &range) const;
+
+        /**
+         * @brief Get whether a range is smaller than the minimum screen size
+         *
+         * @param range the range to test
+         * @return true if the range is too small, false otherwise
+         */
+        bool _IsRangeTooSmall(const GfRange3d &range) const;
+};
+
+PXR_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,322 @@
+#include "displaymodesceneindex.h"
+
+#include <pxr/base/gf/vec3f.h>
+#include <pxr/base/vt/array.h>
+#include <pxr/imaging/hd/basisCurvesSchema.h>
+#include <pxr/imaging/hd/extentSchema.h>
+#include <pxr/imaging/hd/instancedBySchema.h>
+#include <pxr/imaging/hd/overlayContainerDataSource.h>
+#include <pxr/imaging/hd/primvarSchema.h>
+#include <pxr/imaging/hd/primvarsSchema.h>
+#include <pxr/imaging/hd/purposeSchema.h>
+#include <pxr/imaging/hd/retainedDataSource.h>
+#include <pxr/imaging/hd/sceneIndexPrimView.h>
+#include <pxr/imaging/hd/tokens.h>
+#include <pxr/imaging/hd/visibilitySchema.h>
+#include <pxr/imaging/hd/xformSchema.h>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+namespace {
+
+/**
+ * @brief Build a container with the data sources of a prim that do not
+ * depend on its type, followed by the given data sources
+ *
+ * @param dataSource the data source of the prim
+ * @param names the names of the additional data sources
+ * @param values the additional data sources
+ * @return HdContainerDataSourceHandle the container
+ */
+HdContainerDataSourceHandle _BuildContainer(
+    const HdContainerDataSourceHandle &dataSource, TfTokenVector names,
+    std::vector<HdDataSourceBaseHandle> values)
+{
+    static const TfTokenVector keptNames = {
+        HdXformSchemaTokens->xform, HdVisibilitySchemaTokens->visibility,
+        HdPurposeSchemaTokens->purpose, HdExtentSchemaTokens->extent,
+        HdInstancedBySchemaTokens->instancedBy};
+
+    for (auto &&name : keptNames) {
+        if (HdDataSourceBaseHandle value = dataSource->Get(name)) {
+            names.push_back(name);
+            values.push_back(value);
+        }
+    }
+    return HdRetainedContainerDataSource::New(names.size(), names.data(),
+                                              values.data());
+}
+
+/**
+ * @brief Get the displayColor primvar of a prim if its interpolation is one
+ * of the given interpolations
+ *
+ * @param primvars the primvars of the prim
+ * @param interpolations the accepted interpolations
+ * @return HdDataSourceBaseHandle the displayColor primvar, null otherwise
+ */
+HdDataSourceBaseHandle _GetDisplayColor(const HdPrimvarsSchema &primvars,
+                                        const TfTokenVector &interpolations)
+{
+    HdPrimvarSchema displayColor = primvars.GetPrimvar(HdTokens->displayColor);
+    if (!displayColor.GetInterpolation()) return nullptr;
+
+    TfToken interpolation = displayColor.GetInterpolation()->GetTypedValue(0);
+    for (auto &&accepted : interpolations)
+        if (interpolation == accepted) return displayColor.GetContainer();
+    return nullptr;
+}
+
+}  // namespace
+
+DisplayModeSceneIndex::DisplayModeSceneIndex(
+    const HdSceneIndexBaseRefPtr &inputSceneIndex)
+    : HdSingleInputFilteringSceneIndexBase(inputSceneIndex)
+{
+    SetDisplayName("DisplayModeSceneIndex");
+}
+
+DisplayModeSceneIndex::DisplayMode DisplayModeSceneIndex::GetDisplayMode(
+    const SdfPath &primPath) const
+{
+    if (_displayModes.empty()) return DisplayMode::Full;
+
+    for (SdfPath path = primPath; !path.IsEmpty();
+         path = path.GetParentPath()) {
+        auto it = _displayModes.find(path);
+        if (it != _displayModes.end()) return it->second;
+    }
+    return DisplayMode::Full;
+}
+
+void DisplayModeSceneIndex::SetDisplayMode(const SdfPath &primPath,
+                                           DisplayMode mode)
+{
+    if (GetDisplayMode(primPath) == mode) return;
+
+    // the descendants follow the new mode
+    auto it = _displayModes.lower_bound(primPath);
+    while (it != _displayModes.end() && it->first.HasPrefix(primPath))
+        it = _displayModes.erase(it);
+
+    if (GetDisplayMode(primPath.GetParentPath()) != mode)
+        _displayModes[primPath] = mode;
+
+    // the prim types might change, the geometric prims are added back
+    HdSceneIndexObserver::AddedPrimEntries entries;
+    for (const SdfPath &path :
+         HdSceneIndexPrimView(_GetInputSceneIndex(), primPath)) {
+        HdSceneIndexPrim prim = _GetInputSceneIndex()->GetPrim(path);
+        if (!HdPrimTypeIsGprim(prim.primType)) continue;
+        entries.push_back({path, GetPrim(path).primType});
+    }
+
+    if (!entries.empty()) _SendPrimsAdded(entries);
+}
+
+const char *DisplayModeSceneIndex::GetDisplayModeName(DisplayMode mode)
+{
+    switch (mode) {
+        case DisplayMode::Full: return "Full";
+        case DisplayMode::Proxy: return "Proxy";
+        case DisplayMode::Bounds: return "Bounds";
+        case DisplayMode::Points: return "Points";
+    }
+    return "";
+}
+
+HdSceneIndexPrim DisplayModeSceneIndex::BuildBoundsPrim(
+    const HdSceneIndexPrim &prim)
+{
+    HdExtentSchema extentSchema = HdExtentSchema::GetFromParent(prim.dataSource);
+    if (!extentSchema.GetMin() || !extentSchema.GetMax()) return prim;
+
+    HdSampledDataSource::Time time(0);
+    GfVec3d min = extentSchema.GetMin()->GetTypedValue(time);
+    GfVec3d max = extentSchema.GetMax()->GetTypedValue(time);
+
+    // the bit i of a corner index selects the min or max on the axis i
+    static const int edges[12][2] = {{0, 1}, {2, 3}, {4, 5}, {6, 7},
+                                     {0, 2}, {1, 3}, {4, 6}, {5, 7},
+                                     {0, 4}, {1, 5}, {2, 6}, {3, 7}};
+    VtVec3fArray points;
+    for (auto &&edge : edges) {
+        for (int corner : edge) {
+            points.push_back(GfVec3f(corner & 1 ? max[0] : min[0],
+                                     corner & 2 ? max[1] : min[1],
+                                     corner & 4 ? max[2] : min[2]));
+        }
+    }
+
+    using _IntArrayDataSource = HdRetainedTypedSampledDataSource<VtIntArray>;
+    using _TokenDataSource = HdRetainedTypedSampledDataSource<TfToken>;
+    using _PointDataSource = HdRetainedTypedSampledDataSource<VtVec3fArray>;
+
+    TfTokenVector primvarNames = {HdPrimvarsSchemaTokens->points};
+    std::vector<HdDataSourceBaseHandle> primvarValues = {
+        HdPrimvarSchema::Builder()
+            .SetPrimvarValue(_PointDataSource::New(points))
+            .SetRole(HdPrimvarSchema::BuildRoleDataSource(
+                HdPrimvarSchemaTokens->point))
+            .SetInterpolation(HdPrimvarSchema::BuildInterpolationDataSource(
+                HdPrimvarSchemaTokens->vertex))
+            .Build()};
+
+    HdPrimvarsSchema primvars = HdPrimvarsSchema::GetFromParent(prim.dataSource);
+    if (HdDataSourceBaseHandle displayColor = _GetDisplayColor(
+            primvars, {HdPrimvarSchemaTokens->constant})) {
+        primvarNames.push_back(HdTokens->displayColor);
+        primvarValues.push_back(displayColor);
+    }
+
+    HdContainerDataSourceHandle dataSource = _BuildContainer(
+        prim.dataSource,
+        {HdBasisCurvesSchemaTokens->basisCurves,
+         HdPrimvarsSchemaTokens->primvars},
+        {HdBasisCurvesSchema::Builder()
+             .SetTopology(
+                 HdBasisCurvesTopologySchema::Builder()
+                     .SetCurveVertexCounts(
+                         _IntArrayDataSource::New(VtIntArray(12, 2)))
+                     .SetBasis(_TokenDataSource::New(HdTokens->bezier))
+                     .SetType(_TokenDataSource::New(HdTokens->linear))
+                     .SetWrap(_TokenDataSource::New(HdTokens->nonperiodic))
+                     .Build())
+             .Build(),
+         HdRetainedContainerDataSource::New(
+             primvarNames.size(), primvarNames.data(), primvarValues.data())});
+
+    return {HdPrimTypeTokens->basisCurves, dataSource};
+}
+
+HdSceneIndexPrim DisplayModeSceneIndex::BuildPointsPrim(
+    const HdSceneIndexPrim &prim)
+{
+    HdPrimvarsSchema primvars = HdPrimvarsSchema::GetFromParent(prim.dataSource);
+    HdPrimvarSchema points = primvars.GetPrimvar(HdPrimvarsSchemaTokens->points);
+    if (!points) return prim;
+
+    TfTokenVector primvarNames = {HdPrimvarsSchemaTokens->points,
+                                  HdPrimvarsSchemaTokens->widths};
+    std::vector<HdDataSourceBaseHandle> primvarValues = {
+        points.GetContainer(),
+        HdPrimvarSchema::Builder()
+            .SetPrimvarValue(
+                HdRetainedTypedSampledDataSource<VtFloatArray>::New({1}))
+            .SetInterpolation(HdPrimvarSchema::BuildInterpolationDataSource(
+                HdPrimvarSchemaTokens->constant))
+            .Build()};
+
+    // the face varying colors of a mesh do not map to its points
+    if (HdDataSourceBaseHandle displayColor = _GetDisplayColor(
+            primvars, {HdPrimvarSchemaTokens->constant,
+                       HdPrimvarSchemaTokens->vertex,
+                       HdPrimvarSchemaTokens->varying})) {
+        primvarNames.push_back(HdTokens->displayColor);
+        primvarValues.push_back(displayColor);
+    }
+
+    HdContainerDataSourceHandle dataSource =
+        _BuildContainer(prim.dataSource, {HdPrimvarsSchemaTokens->primvars},
+                        {HdRetainedContainerDataSource::New(
+                            primvarNames.size(), primvarNames.data(),
+                            primvarValues.data())});
+
+    return {HdPrimTypeTokens->points, dataSource};
+}
+
+HdSceneIndexPrim DisplayModeSceneIndex::GetPrim(const SdfPath &primPath) const
+{
+    HdSceneIndexPrim prim = _GetInputSceneIndex()->GetPrim(primPath);
+    if (!prim.dataSource || !HdPrimTypeIsGprim(prim.primType)) return prim;
+
+    switch (GetDisplayMode(primPath)) {
+        case DisplayMode::Full: return prim;
+        case DisplayMode::Bounds: return BuildBoundsPrim(prim);
+        case DisplayMode::Points: return BuildPointsPrim(prim);
+        case DisplayMode::Proxy: break;
+    }
+
+    // in proxy mode, the prims for final renders only are hidden
+    HdPurposeSchema purposeSchema =
+        HdPurposeSchema::GetFromParent(prim.dataSource);
+    if (!purposeSchema.GetPurpose() ||
+        purposeSchema.GetPurpose()->GetTypedValue(0) !=
+            HdRenderTagTokens->render)
+        return prim;
+
+    prim.dataSource = HdOverlayContainerDataSource::New(
+        HdRetainedContainerDataSource::New(
+            HdVisibilitySchemaTokens->visibility,
+            HdVisibilitySchema::Builder()
+                .SetVisibility(
+                    HdRetainedTypedSampledDataSource<bool>::New(false))
+                .Build()),
+        prim.dataSource);
+
+    return prim;
+}
+
+SdfPathVector DisplayModeSceneIndex::GetChildPrimPaths(
+    const SdfPath &primPath) const
+{
+    return _GetInputSceneIndex()->GetChildPrimPaths(primPath);
+}
+
+void DisplayModeSceneIndex::_PrimsAdded(
+    const HdSceneIndexBase &sender,
+    const HdSceneIndexObserver::AddedPrimEntries &entries)
+{
+    if (_displayModes.empty()) {
+        _SendPrimsAdded(entries);
+        return;
+    }
+
+    HdSceneIndexObserver::AddedPrimEntries newEntries;
+    for (auto &&entry : entries) {
+        if (!HdPrimTypeIsGprim(entry.primType) ||
+            GetDisplayMode(entry.primPath) == DisplayMode::Full)
+            newEntries.push_back(entry);
+        else newEntries.push_back({entry.primPath,
+                                   GetPrim(entry.primPath).primType});
+    }
+    _SendPrimsAdded(newEntries);
+}
+
+void DisplayModeSceneIndex::_PrimsRemoved(
+    const HdSceneIndexBase &sender,
+    const HdSceneIndexObserver::RemovedPrimEntries &entries)
+{
+    _SendPrimsRemoved(entries);
+}
+
+void DisplayModeSceneIndex::_PrimsDirtied(
+    const HdSceneIndexBase &sender,
+    const HdSceneIndexObserver::DirtiedPrimEntries &entries)
+{
+    if (_displayModes.empty()) {
+        _SendPrimsDirtied(entries);
+        return;
+    }
+
+    // the boxes follow the extent of their prim and the hidden prims follow
+    // their purpose
+    HdSceneIndexObserver::DirtiedPrimEntries newEntries;
+    for (auto &&entry : entries) {
+        newEntries.push_back(entry);
+        DisplayMode mode = GetDisplayMode(entry.primPath);
+        if (mode == DisplayMode::Bounds &&
+            entry.dirtyLocators.Intersects(
+                HdExtentSchema::GetDefaultLocator()))
+            newEntries.back().dirtyLocators.insert(
+                HdPrimvarsSchema::GetPointsLocator());
+        if (mode == DisplayMode::Proxy &&
+            entry.dirtyLocators.Intersects(
+                HdPurposeSchema::GetDefaultLocator()))
+            newEntries.back().dirtyLocators.insert(
+                HdVisibilitySchema::GetDefaultLocator());
+    }
+    _SendPrimsDirtied(newEntries);
+}
+
+PXR_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,151 @@
+/**
+ * @file displaymodesceneindex.h
+ * @author Raphael Jouretz (rjouretz.com)
+ * @brief Hydra Filter Scene Index that overwrites the display of the Hydra
+ * Prims of a subtree with their proxy, their bounds or their points.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <pxr/imaging/hd/filteringSceneIndex.h>
+#include <pxr/imaging/hd/sceneIndex.h>
+#include <pxr/pxr.h>
+
+#include <map>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+class DisplayModeSceneIndex;
+
+TF_DECLARE_REF_PTRS(DisplayModeSceneIndex);
+
+/**
+ * @class DisplayModeSceneIndex
+ * @brief Hydra Filter Scene Index that overwrites the display of the Hydra
+ * Prims of a subtree with their proxy, their bounds or their points.
+ *
+ * The display mode of a prim is inherited by its descendants. Switching a
+ * mode only overlays Hydra data sources, the USD stage is not recomposed.
+ * The geometric prims of a subtree in bounds mode are drawn as basisCurves
+ * boxes, those in points mode as points prims.
+ */
+class DisplayModeSceneIndex : public HdSingleInputFilteringSceneIndexBase {
+    public:
+        /**
+         * @brief The ways of displaying a subtree
+         *
+         */
+        enum class DisplayMode { Full, Proxy, Bounds, Points };
+
+        /**
+         * @brief Create a ref pointer to a display mode scene index
+         *
+         * @return DisplayModeSceneIndexRefPtr the ref pointer to a display
+         * mode scene index
+         */
+        static DisplayModeSceneIndexRefPtr New(
+            const HdSceneIndexBaseRefPtr &inputSceneIndex)
+        {
+            return TfCreateRefPtr(new DisplayModeSceneIndex(inputSceneIndex));
+        }
+
+        /**
+         * @brief Construct a new Display Mode Scene Index object
+         *
+         * @param inputSceneIndex the scene index to overwrite from
+         */
+        DisplayModeSceneIndex(const HdSceneIndexBaseRefPtr &inputSceneIndex);
+
+        /**
+         * @brief Get the display mode of a prim, inherited from its closest
+         * ancestor with a display mode
+         *
+         * @param primPath the path of the prim
+         * @return DisplayMode the display mode of the prim
+         */
+        DisplayMode GetDisplayMode(const SdfPath &primPath) const;
+
+        /**
+         * @brief Set the display mode of a prim and its descendants
+         *
+         * @param primPath the path of the prim
+         * @param mode the display mode to set
+         */
+        void SetDisplayMode(const SdfPath &primPath, DisplayMode mode);
+
+        /**
+         * @brief Get the display name of a display mode
+         *
+         * @param mode the display mode
+         * @return const char* the display name of the mode
+         */
+        static const char *GetDisplayModeName(DisplayMode mode);
+
+        /**
+         * @brief Build a basisCurves prim drawing the extent of a geometric
+         * prim as a box
+         *
+         * @param prim the geometric prim
+         * @return HdSceneIndexPrim the box prim, the given prim if it has no
+         * extent
+         */
+        static HdSceneIndexPrim BuildBoundsPrim(const HdSceneIndexPrim &prim);
+
+        /**
+         * @brief Build a points prim drawing the points of a geometric prim
+         *
+         * @param prim the geometric prim
+         * @return HdSceneIndexPrim the points prim, the given prim if it has
+         * no points
+         */
+        static HdSceneIndexPrim BuildPointsPrim(const HdSceneIndexPrim &prim);
+
+        /**
+         * @brief Override of
+         * HdSingleInputFilteringSceneIndexBase::GetPrim
+         */
+        virtual HdSceneIndexPrim GetPrim(
+            const SdfPath &primPath) const override;
+
+        /**
+         * @brief Override of
+         * HdSingleInputFilteringSceneIndexBase::GetChildPrimPaths
+         */
+        virtual SdfPathVector GetChildPrimPaths(
+            const SdfPath &primPath) const override;
+
+    protected:
+        /**
+         * @brief Override of
+         * HdSingleInputFilteringSceneIndexBase::_PrimsAdded
+         */
+        virtual void _PrimsAdded(
+            const HdSceneIndexBase &sender,
+            const HdSceneIndexObserver::AddedPrimEntries &entries)
+            override;
+
+        /**
+         * @brief Override of
+         * HdSingleInputFilteringSceneIndexBase::_PrimsRemoved
+         */
+        virtual void _PrimsRemoved(
+            const HdSceneIndexBase &sender,
+            const HdSceneIndexObserver::RemovedPrimEntries &entries)
+            override;
+
+        /**
+         * @brief Override of
+         * HdSingleInputFilteringSceneIndexBase::_PrimsDirtied
+         */
+        virtual void _PrimsDirtied(
+            const HdSceneIndexBase &sender,
+            const HdSceneIndexObserver::DirtiedPrimEntries &entries)
+            override;
+
+    private:
+        std::map<SdfPath, DisplayMode> _displayModes;
+};
+
+PXR_NAMESPACE_CLOSE_SCOPE
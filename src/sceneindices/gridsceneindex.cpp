@@ -16,34 +16,71 @@
 #include "pxr/imaging/hd/materialBindingsSchema.h"
 #include "pxr/imaging/hd/materialConnectionSchema.h"
 
+#include <cmath>
+
 PXR_NAMESPACE_OPEN_SCOPE
 
 GridSceneIndex::GridSceneIndex()
+    : _isAdaptive(true),
+      _cameraPosition(0, 0, 0),
+      _level(0),
+      _fadeStep(0),
+      _centerX(0),
+      _centerZ(0)
 {
     SetDisplayName("GridSceneIndex");
 
     _gridPath = SdfPath("/Grid");
     _matPath = _gridPath.AppendPath(SdfPath("Material"));
     _prevSurfPath = _matPath.AppendPath(SdfPath("PreviewSurface"));
+    _primvarReaderPath = _matPath.AppendPath(SdfPath("PrimvarReader"));
+    _GenerateAdaptiveGrid(true);
     _gridPrim = _CreateGridPrim();
     _matPrim = _CreatePrevSurfPrim();
-    Populate(true);
+    _SendPrimsAdded({{_matPath, HdPrimTypeTokens->material},
+                     {_gridPath, HdPrimTypeTokens->basisCurves}});
 }
 
-void GridSceneIndex::Populate(bool populate)
+SdfPath GridSceneIndex::GetGridPath()
 {
-    if (populate && !_isPopulated) {
-        _SendPrimsAdded({
-            { _matPath, HdPrimTypeTokens->material},
-            {_gridPath, HdPrimTypeTokens->basisCurves}
+    return _gridPath;
+}
 
-            
-        });
-    }
-    else if (!populate && _isPopulated) {
-        _SendPrimsRemoved({{_gridPath},{_matPath}});
-    }
-    _isPopulated = populate;
+void GridSceneIndex::SetAdaptive(bool isAdaptive)
+{
+    if (_isAdaptive == isAdaptive) return;
+    _isAdaptive = isAdaptive;
+
+    if (_isAdaptive) _GenerateAdaptiveGrid(true);
+    else _GenerateFixedGrid();
+    _gridPrim = _CreateGridPrim();
+
+    // the number of lines differs between the fixed and adaptive grids
+    _SendPrimsDirtied(
+        {{_gridPath,
+          {HdBasisCurvesTopologySchema::GetDefaultLocator(),
+           HdPrimvarsSchema::GetPointsLocator(),
+           HdPrimvarsSchema::GetDefaultLocator().Append(
+               HdTokens->displayColor)}}});
+}
+
+bool GridSceneIndex::IsAdaptive()
+{
+    return _isAdaptive;
+}
+
+void GridSceneIndex::SetCameraPosition(const GfVec3d& position)
+{
+    _cameraPosition = position;
+    if (!_isAdaptive || !_GenerateAdaptiveGrid(false)) return;
+
+    // the topology is unchanged, only the primvars are uploaded again
+    _gridPrim = _CreateGridPrim();
+    _SendPrimsDirtied(
+        {{_gridPath,
+          {HdPrimvarsSchema::GetPointsLocator(),
+           HdPrimvarsSchema::GetDefaultLocator().Append(
+               HdTokens->displayColor)}}});
 }
 
 HdSceneIndexPrim GridSceneIndex::GetPrim(const SdfPath& primPath) const
@@ -55,51 +92,113 @@ HdSceneIndexPrim GridSceneIndex::GetPrim(const SdfPath& primPath) const
 
 SdfPathVector GridSceneIndex::GetChildPrimPaths(const SdfPath& primPath) const
 {
-    if (!_isPopulated) return {};
     if (primPath == SdfPath::AbsoluteRootPath()) return {_gridPath};
     if (primPath == _gridPath) return {_matPath};
     else return {};
 }
 
-HdSceneIndexPrim GridSceneIndex::_CreateGridPrim()
+void GridSceneIndex::_GenerateFixedGrid()
 {
-    VtVec3fArray colors = {};
-    VtVec3fArray pts = {};
-    VtIntArray vertexCounts = {};
-
-    GfVec3f mainColor(.0f, .0f, .0f);
-    GfVec3f subColor(.3f, .3f, .3f);
+    _points.clear();
+    _colors.clear();
+    _vertexCounts.clear();
 
-    int lines = 10;
+    int lines = _FIXED_LINES;
     float padding = 1;
 
-    pts.push_back(GfVec3f(0, 0, -padding * lines));
-    pts.push_back(GfVec3f(0, 0, padding * lines));
-    pts.push_back(GfVec3f(-padding * lines, 0, 0));
-    pts.push_back(GfVec3f(padding * lines, 0, 0));
+    _points.push_back(GfVec3f(0, 0, -padding * lines));
+    _points.push_back(GfVec3f(0, 0, padding * lines));
+    _points.push_back(GfVec3f(-padding * lines, 0, 0));
+    _points.push_back(GfVec3f(padding * lines, 0, 0));
 
     for (int j = 0; j < 2; j++) {
-        vertexCounts.push_back(2);
-        colors.push_back(mainColor);
+        _vertexCounts.push_back(2);
+        _colors.push_back(_MAIN_COLOR);
     }
 
     for (int i = 1; i <= lines; i++) {
-        pts.push_back(GfVec3f(-padding * i, 0, -padding * lines));
-        pts.push_back(GfVec3f(-padding * i, 0, padding * lines));
-        pts.push_back(GfVec3f(padding * i, 0, -padding * lines));
-        pts.push_back(GfVec3f(padding * i, 0, padding * lines));
+        _points.push_back(GfVec3f(-padding * i, 0, -padding * lines));
+        _points.push_back(GfVec3f(-padding * i, 0, padding * lines));
+        _points.push_back(GfVec3f(padding * i, 0, -padding * lines));
+        _points.push_back(GfVec3f(padding * i, 0, padding * lines));
 
-        pts.push_back(GfVec3f(-padding * lines, 0, -padding * i));
-        pts.push_back(GfVec3f(padding * lines, 0, -padding * i));
-        pts.push_back(GfVec3f(-padding * lines, 0, padding * i));
-        pts.push_back(GfVec3f(padding * lines, 0, padding * i));
+        _points.push_back(GfVec3f(-padding * lines, 0, -padding * i));
+        _points.push_back(GfVec3f(padding * lines, 0, -padding * i));
+        _points.push_back(GfVec3f(-padding * lines, 0, padding * i));
+        _points.push_back(GfVec3f(padding * lines, 0, padding * i));
 
         for (int j = 0; j < 4; j++) {
-            vertexCounts.push_back(2);
-            colors.push_back(subColor);
+            _vertexCounts.push_back(2);
+            _colors.push_back(_SUB_COLOR);
         }
     }
+}
+
+bool GridSceneIndex::_GenerateAdaptiveGrid(bool force)
+{
+    double height =
+        std::max(std::abs(_cameraPosition[1]), _MIN_CAMERA_HEIGHT);
+    double level = std::log10(height);
+    int majorLevel = static_cast<int>(std::floor(level));
+    int fadeStep = static_cast<int>((level - majorLevel) * _FADE_STEPS);
+    double majorSpacing = std::pow(10., majorLevel);
+    int64_t centerX = std::llround(_cameraPosition[0] / majorSpacing);
+    int64_t centerZ = std::llround(_cameraPosition[2] / majorSpacing);
+
+    if (!force && majorLevel == _level && fadeStep == _fadeStep &&
+        centerX == _centerX && centerZ == _centerZ)
+        return false;
+
+    _level = majorLevel;
+    _fadeStep = fadeStep;
+    _centerX = centerX;
+    _centerZ = centerZ;
+
+    _points.clear();
+    _colors.clear();
+    _vertexCounts.assign(8 * _ADAPTIVE_HALF_LINES + 4, 2);
+
+    // the finer lines fade out as the camera reaches the next level
+    float fade = static_cast<float>(fadeStep) / _FADE_STEPS;
+    GfVec3f minorColor = _SUB_COLOR * (1 - fade) + _FADE_COLOR * fade;
+
+    _AddAdaptiveLevel(majorSpacing, 1, _SUB_COLOR);
+    _AddAdaptiveLevel(majorSpacing / 10, 10, minorColor);
+    return true;
+}
+
+void GridSceneIndex::_AddAdaptiveLevel(double spacing, int levelScale,
+                                       const GfVec3f& color)
+{
+    int64_t centerX = _centerX * levelScale;
+    int64_t centerZ = _centerZ * levelScale;
+    float extent = spacing * _ADAPTIVE_HALF_LINES;
+
+    auto getColor = [&](int64_t line) {
+        if (line == 0) return _MAIN_COLOR;
+        if (line % levelScale == 0) return _SUB_COLOR;
+        return color;
+    };
+
+    for (int i = -_ADAPTIVE_HALF_LINES; i <= _ADAPTIVE_HALF_LINES; i++) {
+        int64_t lineX = centerX + i;
+        float x = lineX * spacing;
+        float z = centerZ * spacing;
+        _points.push_back(GfVec3f(x, 0, z - extent));
+        _points.push_back(GfVec3f(x, 0, z + extent));
+        _colors.push_back(getColor(lineX));
+
+        int64_t lineZ = centerZ + i;
+        x = centerX * spacing;
+        z = lineZ * spacing;
+        _points.push_back(GfVec3f(x - extent, 0, z));
+        _points.push_back(GfVec3f(x + extent, 0, z));
+        _colors.push_back(getColor(lineZ));
+    }
+}
 
+HdSceneIndexPrim GridSceneIndex::_CreateGridPrim()
+{
     using _IntArrayDataSource = HdRetainedTypedSampledDataSource<VtIntArray>;
     using _TokenDataSource = HdRetainedTypedSampledDataSource<TfToken>;
     using _PointDataSource = HdRetainedTypedSampledDataSource<VtVec3fArray>;
@@ -125,7 +224,7 @@ HdSceneIndexPrim GridSceneIndex::_CreateGridPrim()
                 .SetTopology(
                     HdBasisCurvesTopologySchema::Builder()
                         .SetCurveVertexCounts(
-                            _IntArrayDataSource::New(vertexCounts))
+                            _IntArrayDataSource::New(_vertexCounts))
                         .SetBasis(_TokenDataSource::New(HdTokens->bezier))
                         .SetType(_TokenDataSource::New(HdTokens->linear))
                         .SetWrap(_TokenDataSource::New(HdTokens->nonperiodic))
@@ -135,13 +234,22 @@ HdSceneIndexPrim GridSceneIndex::_CreateGridPrim()
             HdRetainedContainerDataSource::New(
                 HdPrimvarsSchemaTokens->points,
                 HdPrimvarSchema::Builder()
-                    .SetPrimvarValue(_PointDataSource::New(pts))
+                    .SetPrimvarValue(_PointDataSource::New(_points))
                     .SetRole(HdPrimvarSchema::BuildRoleDataSource(
                         HdPrimvarSchemaTokens->point))
                     .SetInterpolation(
                         HdPrimvarSchema::BuildInterpolationDataSource(
                             HdPrimvarSchemaTokens->vertex))
                     .Build(),
+                HdTokens->displayColor,
+                HdPrimvarSchema::Builder()
+                    .SetPrimvarValue(_PointDataSource::New(_colors))
+                    .SetRole(HdPrimvarSchema::BuildRoleDataSource(
+                        HdPrimvarSchemaTokens->color))
+                    .SetInterpolation(
+                        HdPrimvarSchema::BuildInterpolationDataSource(
+                            HdPrimvarSchemaTokens->uniform))
+                    .Build(),
                 HdPrimvarsSchemaTokens->widths,
                 HdPrimvarSchema::Builder()
                     .SetPrimvarValue(_FloatDataSource::New({1}))
@@ -188,16 +296,34 @@ HdSceneIndexPrim GridSceneIndex::_CreatePrevSurfPrim()
     auto black = HdMaterialNodeParameterSchema::Builder()
         .SetValue(_Vec3fDataSource::New(GfVec3f(.0f, .0f, .0f))).Build();
 
+    // the lines are unlit, their color is the displayColor primvar
+    auto primvarReaderNode = HdMaterialNodeSchema::Builder()
+        .SetNodeIdentifier(_TokenDataSource::New(
+            UsdImagingTokens->UsdPrimvarReader_float3))
+        .SetParameters(HdRetainedContainerDataSource::New(
+            TfToken("varname"), HdMaterialNodeParameterSchema::Builder()
+                .SetValue(_TokenDataSource::New(HdTokens->displayColor))
+                .Build()))
+        .SetInputConnections(HdRetainedContainerDataSource::New()).Build();
+
+    HdDataSourceBaseHandle displayColor = HdMaterialConnectionSchema::Builder()
+        .SetUpstreamNodePath(
+            _TokenDataSource::New(_primvarReaderPath.GetToken()))
+        .SetUpstreamNodeOutputName(_TokenDataSource::New(TfToken("result")))
+        .Build();
+
     auto surfaceNode = HdMaterialNodeSchema::Builder()
         .SetNodeIdentifier(_TokenDataSource::New(UsdImagingTokens->UsdPreviewSurface))
         .SetParameters(HdRetainedContainerDataSource::New(
-            TfToken("emissiveColor"), black,
             TfToken("diffuseColor"),  black,
             TfToken("specular"),      zero,
             TfToken("metallic"),      zero,
             TfToken("roughness"),     one,
             TfToken("opacity"),       one))
-        .SetInputConnections(HdRetainedContainerDataSource::New()).Build();
+        .SetInputConnections(HdRetainedContainerDataSource::New(
+            TfToken("emissiveColor"),
+            HdRetainedSmallVectorDataSource::New(1, &displayColor)))
+        .Build();
 
     auto terminals = HdRetainedContainerDataSource::New(
         HdMaterialTerminalTokens->surface,
@@ -217,7 +343,9 @@ HdSceneIndexPrim GridSceneIndex::_CreatePrevSurfPrim()
         HdMaterialNetworkSchema::Builder()
         .SetNodes( HdRetainedContainerDataSource::New(
                 _prevSurfPath.GetToken(),
-                surfaceNode))
+                surfaceNode,
+                _primvarReaderPath.GetToken(),
+                primvarReaderNode))
         .SetTerminals(terminals)
         .Build()
     );
@@ -8,6 +8,9 @@
  */
 #pragma once
 
+#include <pxr/base/gf/vec3d.h>
+#include <pxr/base/gf/vec3f.h>
+#include <pxr/base/vt/array.h>
 #include <pxr/imaging/hd/sceneIndex.h>
 #include "pxr/pxr.h"
 
@@ -21,6 +24,11 @@ TF_DECLARE_REF_PTRS(GridSceneIndex);
  * @class GridSceneIndex
  * @brief Hydra Scene Index that creates a grid at the origin.
  *
+ * In adaptive mode, the line spacing follows the height of the camera above
+ * the grid by powers of ten and the grid is centered under the camera. The
+ * lines of the finer level fade out as the camera moves away. The number of
+ * lines is fixed, only the points and colors are regenerated when the camera
+ * crosses a cell, a level or a fade step.
  */
 class GridSceneIndex : public HdSceneIndexBase {
     public:
@@ -41,11 +49,32 @@ class GridSceneIndex : public HdSceneIndexBase {
         GridSceneIndex();
 
         /**
-         * @brief Populate the grid scene index
+         * @brief Get the path of the grid prim
          *
-         * @param populate true to populate the scene index, false otherwise
+         * @return SdfPath the path of the grid prim
          */
-        void Populate(bool populate);
+        SdfPath GetGridPath();
+
+        /**
+         * @brief Set whether the grid adapts to the camera position
+         *
+         * @param isAdaptive true to adapt the grid, false for a fixed grid
+         */
+        void SetAdaptive(bool isAdaptive);
+
+        /**
+         * @brief Get whether the grid adapts to the camera position
+         *
+         * @return true if the grid is adaptive, false otherwise
+         */
+        bool IsAdaptive();
+
+        /**
+         * @brief Set the position of the camera the adaptive grid follows
+         *
+         * @param position the position of the camera
+         */
+        void SetCameraPosition(const GfVec3d& position);
 
         /**
          * @brief Get the prim at the given path
@@ -64,17 +93,61 @@ class GridSceneIndex : public HdSceneIndexBase {
         virtual SdfPathVector GetChildPrimPaths(const SdfPath& primPath) const;
 
     private:
-        SdfPath _gridPath, _matPath, _prevSurfPath;
+        const int _FIXED_LINES = 10;
+        const int _ADAPTIVE_HALF_LINES = 20;
+        const int _FADE_STEPS = 8;
+        const double _MIN_CAMERA_HEIGHT = .1;
+        const GfVec3f _MAIN_COLOR = GfVec3f(.0f, .0f, .0f);
+        const GfVec3f _SUB_COLOR = GfVec3f(.3f, .3f, .3f);
+        const GfVec3f _FADE_COLOR = GfVec3f(.1f, .1f, .1f);
+
+        SdfPath _gridPath, _matPath, _prevSurfPath, _primvarReaderPath;
         HdSceneIndexPrim _gridPrim, _matPrim;
-        bool _isPopulated;
+        bool _isAdaptive;
+
+        VtVec3fArray _points, _colors;
+        VtIntArray _vertexCounts;
+        GfVec3d _cameraPosition;
+        int _level, _fadeStep;
+        int64_t _centerX, _centerZ;
 
         /**
-         * @brief Create the grid hydra prim
+         * @brief Create the grid hydra prim from the current points, colors
+         * and vertex counts
          * 
          * @return HdSceneIndexPrim the hydra prim of the grid
          */
         HdSceneIndexPrim _CreateGridPrim();
 
+        /**
+         * @brief Generate the lines of the fixed grid
+         *
+         */
+        void _GenerateFixedGrid();
+
+        /**
+         * @brief Generate the lines of the adaptive grid for the current
+         * camera position if it crossed a cell, a level or a fade step
+         *
+         * @param force true to generate the lines even if nothing was
+         * crossed
+         * @return true if the lines were generated, false otherwise
+         */
+        bool _GenerateAdaptiveGrid(bool force);
+
+        /**
+         * @brief Add the lines of one level of the adaptive grid, parallel
+         * to the X and Z axes
+         *
+         * @param spacing the distance between two lines
+         * @param levelScale the number of lines of this level between two
+         * lines of the coarser level
+         * @param color the color of the lines not shared with the coarser
+         * level
+         */
+        void _AddAdaptiveLevel(double spacing, int levelScale,
+                               const GfVec3f& color);
+
         HdSceneIndexPrim _CreatePrevSurfPrim();
 };
 
@@ -0,0 +1,698 @@
+#include "instancingsceneindex.h"
+
+#include <pxr/base/tf/hash.h>
+#include <pxr/base/work/loops.h>
+#include <pxr/imaging/hd/instancedBySchema.h>
+#include <pxr/imaging/hd/instancerTopologySchema.h>
+#include <pxr/imaging/hd/materialBindingSchema.h>
+#include <pxr/imaging/hd/materialBindingsSchema.h>
+#include <pxr/imaging/hd/meshSchema.h>
+#include <pxr/imaging/hd/meshTopologySchema.h>
+#include <pxr/imaging/hd/overlayContainerDataSource.h>
+#include <pxr/imaging/hd/primvarSchema.h>
+#include <pxr/imaging/hd/primvarsSchema.h>
+#include <pxr/imaging/hd/purposeSchema.h>
+#include <pxr/imaging/hd/retainedDataSource.h>
+#include <pxr/imaging/hd/sceneIndexPrimView.h>
+#include <pxr/imaging/hd/tokens.h>
+#include <pxr/imaging/hd/visibilitySchema.h>
+#include <pxr/imaging/hd/xformSchema.h>
+
+#include <iterator>
+#include <map>
+#include <set>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+namespace {
+
+using _PathArrayDataSource = HdRetainedTypedSampledDataSource<VtArray<SdfPath>>;
+
+/**
+ * @brief Get the world xform of a prim
+ *
+ * @param prim the prim
+ * @return GfMatrix4d the world xform, identity if the prim has none
+ */
+GfMatrix4d _GetXform(const HdSceneIndexPrim &prim)
+{
+    // the xforms are flattened by the usd imaging scene indices
+    HdXformSchema xformSchema = HdXformSchema::GetFromParent(prim.dataSource);
+    if (!xformSchema.GetMatrix()) return GfMatrix4d(1);
+    return xformSchema.GetMatrix()->GetTypedValue(0);
+}
+
+/**
+ * @brief Get the value of a primvar at the current time
+ *
+ * @param primvar the primvar
+ * @return VtValue the value, empty if the primvar has none
+ */
+VtValue _GetPrimvarValue(const HdPrimvarSchema &primvar)
+{
+    if (primvar.GetPrimvarValue())
+        return primvar.GetPrimvarValue()->GetValue(0);
+    if (primvar.GetIndexedPrimvarValue())
+        return primvar.GetIndexedPrimvarValue()->GetValue(0);
+    return VtValue();
+}
+
+}  // namespace
+
+InstancingSceneIndex::InstancingSceneIndex(
+    const HdSceneIndexBaseRefPtr &inputSceneIndex)
+    : HdSingleInputFilteringSceneIndexBase(inputSceneIndex),
+      _isEnabled(false),
+      _rootPath("/__AutoInstancer"),
+      _nextGroupId(0),
+      _activeGroupCount(0)
+{
+    SetDisplayName("InstancingSceneIndex");
+}
+
+void InstancingSceneIndex::SetEnabled(bool isEnabled)
+{
+    if (_isEnabled == isEnabled) return;
+    _isEnabled = isEnabled;
+    _Rebuild();
+}
+
+bool InstancingSceneIndex::IsEnabled() const
+{
+    return _isEnabled;
+}
+
+size_t InstancingSceneIndex::GetPrototypeCount() const
+{
+    return _activeGroupCount;
+}
+
+size_t InstancingSceneIndex::GetInstanceCount() const
+{
+    size_t count = 0;
+    for (auto &&it : _groups) {
+        if (_IsActive(it.second)) count += it.second.instancePaths.size();
+    }
+    return count;
+}
+
+size_t InstancingSceneIndex::GetMemorySaved() const
+{
+    size_t memory = 0;
+    for (auto &&it : _groups) {
+        const _Group &group = it.second;
+        if (_IsActive(group))
+            memory += (group.instancePaths.size() - 1) * group.meshMemoryUsage;
+    }
+    return memory;
+}
+
+size_t InstancingSceneIndex::GetDrawCallsSaved() const
+{
+    return GetInstanceCount() - _activeGroupCount;
+}
+
+SdfPath InstancingSceneIndex::GetInstancedMeshPath(
+    const SdfPath &instancerPath, int instanceIndex) const
+{
+    auto it = _instancerGroups.find(instancerPath);
+    if (it == _instancerGroups.end()) return SdfPath();
+
+    // the instances are indexed in the order of the paths of their meshes
+    const _Group &group = _groups.at(it->second);
+    if (!_IsActive(group) || instanceIndex < 0 ||
+        size_t(instanceIndex) >= group.instancePaths.size())
+        return SdfPath();
+    return *std::next(group.instancePaths.begin(), instanceIndex);
+}
+
+bool InstancingSceneIndex::GetInstance(const SdfPath &primPath,
+                                       SdfPath *prototypePath,
+                                       int *instanceIndex) const
+{
+    auto it = _meshGroups.find(primPath);
+    if (it == _meshGroups.end()) return false;
+
+    const _Group &group = _groups.at(it->second);
+    if (!_IsActive(group)) return false;
+
+    *prototypePath = group.prototypePath;
+    *instanceIndex = int(std::distance(group.instancePaths.begin(),
+                                       group.instancePaths.find(primPath)));
+    return true;
+}
+
+HdSceneIndexPrim InstancingSceneIndex::GetPrim(const SdfPath &primPath) const
+{
+    if (_activeGroupCount == 0)
+        return _GetInputSceneIndex()->GetPrim(primPath);
+
+    if (primPath == _rootPath) {
+        return {TfToken(), HdRetainedContainerDataSource::New()};
+    }
+
+    // the groups with a single mesh are tracked but not drawn
+    auto instancerIt = _instancerGroups.find(primPath);
+    if (instancerIt != _instancerGroups.end()) {
+        const _Group &group = _groups.at(instancerIt->second);
+        if (_IsActive(group)) return _GetInstancerPrim(group);
+    }
+
+    auto prototypeIt = _prototypeGroups.find(primPath);
+    if (prototypeIt != _prototypeGroups.end()) {
+        const _Group &group = _groups.at(prototypeIt->second);
+        if (_IsActive(group)) return _GetPrototypePrim(group);
+    }
+
+    // the instanced meshes lose their type so that they are not drawn, their
+    // data stays available to the outliner and the editor
+    HdSceneIndexPrim prim = _GetInputSceneIndex()->GetPrim(primPath);
+    if (_IsInstanced(primPath)) prim.primType = TfToken();
+    return prim;
+}
+
+SdfPathVector InstancingSceneIndex::GetChildPrimPaths(
+    const SdfPath &primPath) const
+{
+    if (_activeGroupCount == 0)
+        return _GetInputSceneIndex()->GetChildPrimPaths(primPath);
+
+    if (primPath == SdfPath::AbsoluteRootPath()) {
+        SdfPathVector childPaths =
+            _GetInputSceneIndex()->GetChildPrimPaths(primPath);
+        childPaths.push_back(_rootPath);
+        return childPaths;
+    }
+    if (primPath == _rootPath) {
+        SdfPathVector childPaths;
+        for (auto &&it : _groups) {
+            if (_IsActive(it.second))
+                childPaths.push_back(it.second.instancerPath);
+        }
+        return childPaths;
+    }
+
+    auto instancerIt = _instancerGroups.find(primPath);
+    if (instancerIt != _instancerGroups.end()) {
+        const _Group &group = _groups.at(instancerIt->second);
+        if (_IsActive(group)) return {group.prototypePath};
+    }
+    if (_prototypeGroups.count(primPath)) return {};
+
+    return _GetInputSceneIndex()->GetChildPrimPaths(primPath);
+}
+
+void InstancingSceneIndex::_PrimsAdded(
+    const HdSceneIndexBase &sender,
+    const HdSceneIndexObserver::AddedPrimEntries &entries)
+{
+    if (!_isEnabled) {
+        _SendPrimsAdded(entries);
+        return;
+    }
+
+    HdSceneIndexObserver::AddedPrimEntries addedEntries;
+    SdfPathVector meshPaths;
+    for (auto &&entry : entries) {
+        addedEntries.push_back(entry);
+        if (_IsInstanced(entry.primPath))
+            addedEntries.back().primType = TfToken();
+        if (entry.primType == HdPrimTypeTokens->mesh)
+            meshPaths.push_back(entry.primPath);
+    }
+    _SendPrimsAdded(addedEntries);
+
+    // a prim added again may have changed, it leaves its group first
+    _Changes changes{_activeGroupCount};
+    for (auto &&entry : entries) {
+        _deformingMeshes.erase(entry.primPath);
+        auto it = _meshGroups.find(entry.primPath);
+        if (it != _meshGroups.end()) _RemoveMesh(it, &changes);
+    }
+
+    // only the added meshes are hashed, they join the groups of their
+    // identical meshes
+    std::vector<size_t> hashes = _ComputeMeshHashes(meshPaths);
+    for (size_t i = 0; i < meshPaths.size(); i++)
+        _AddMesh(meshPaths[i], hashes[i], &changes);
+
+    _SendChanges(changes);
+}
+
+void InstancingSceneIndex::_PrimsRemoved(
+    const HdSceneIndexBase &sender,
+    const HdSceneIndexObserver::RemovedPrimEntries &entries)
+{
+    _SendPrimsRemoved(entries);
+
+    // removing a prim removes its whole subtree
+    for (auto &&entry : entries) {
+        auto it = _deformingMeshes.lower_bound(entry.primPath);
+        while (it != _deformingMeshes.end() &&
+               it->HasPrefix(entry.primPath))
+            it = _deformingMeshes.erase(it);
+    }
+    if (!_isEnabled) return;
+
+    _Changes changes{_activeGroupCount};
+    for (auto &&entry : entries) {
+        auto it = _meshGroups.lower_bound(entry.primPath);
+        while (it != _meshGroups.end() && it->first.HasPrefix(entry.primPath))
+            it = _RemoveMesh(it, &changes);
+    }
+
+    // the removed meshes are not added back
+    changes.meshes.clear();
+    _SendChanges(changes);
+}
+
+void InstancingSceneIndex::_PrimsDirtied(
+    const HdSceneIndexBase &sender,
+    const HdSceneIndexObserver::DirtiedPrimEntries &entries)
+{
+    _SendPrimsDirtied(entries);
+    if (!_isEnabled) return;
+
+    // the other primvars are not hashed again, the animated ones would
+    // regroup the meshes on every time change
+    static const HdDataSourceLocatorSet meshLocators = {
+        HdMeshSchema::GetTopologyLocator(),
+        HdMaterialBindingsSchema::GetDefaultLocator(),
+        HdVisibilitySchema::GetDefaultLocator(),
+        HdPurposeSchema::GetDefaultLocator()};
+
+    // the meshes whose points change are deforming, they leave the
+    // instancing for good
+    _Changes changes{_activeGroupCount};
+    SdfPathVector changedPaths;
+    for (auto &&entry : entries) {
+        if (entry.dirtyLocators.Intersects(
+                HdPrimvarsSchema::GetPointsLocator()) &&
+            _deformingMeshes.insert(entry.primPath).second) {
+            auto it = _meshGroups.find(entry.primPath);
+            if (it != _meshGroups.end()) _RemoveMesh(it, &changes);
+            continue;
+        }
+        if (entry.dirtyLocators.Intersects(meshLocators))
+            changedPaths.push_back(entry.primPath);
+    }
+
+    // the meshes only change group when their hash changes
+    std::vector<size_t> hashes = _ComputeMeshHashes(changedPaths);
+    for (size_t i = 0; i < changedPaths.size(); i++) {
+        auto it = _meshGroups.find(changedPaths[i]);
+        size_t prevHash =
+            it != _meshGroups.end() ? _groups.at(it->second).hash : 0;
+        if (hashes[i] == prevHash) continue;
+
+        if (it != _meshGroups.end()) _RemoveMesh(it, &changes);
+        _AddMesh(changedPaths[i], hashes[i], &changes);
+    }
+    _SendChanges(changes);
+
+    // the moved instances only dirty the transforms of their instancer, the
+    // prototype follows its source mesh
+    std::set<size_t> movedGroups;
+    HdSceneIndexObserver::DirtiedPrimEntries dirtiedEntries;
+    for (auto &&entry : entries) {
+        auto it = _meshGroups.find(entry.primPath);
+        if (it == _meshGroups.end()) continue;
+        const _Group &group = _groups.at(it->second);
+        if (!_IsActive(group)) continue;
+
+        if (entry.dirtyLocators.Intersects(HdXformSchema::GetDefaultLocator()))
+            movedGroups.insert(it->second);
+        if (*group.instancePaths.begin() == entry.primPath) {
+            dirtiedEntries.push_back(
+                {group.prototypePath, entry.dirtyLocators});
+        }
+    }
+    for (size_t groupId : movedGroups) {
+        dirtiedEntries.push_back(
+            {_groups.at(groupId).instancerPath,
+             HdPrimvarsSchema::GetDefaultLocator().Append(
+                 HdInstancerTokens->instanceTransforms)});
+    }
+    if (!dirtiedEntries.empty()) _SendPrimsDirtied(dirtiedEntries);
+}
+
+void InstancingSceneIndex::_Rebuild()
+{
+    _Changes changes{_activeGroupCount};
+    auto it = _meshGroups.begin();
+    while (it != _meshGroups.end()) it = _RemoveMesh(it, &changes);
+
+    if (_isEnabled) {
+        SdfPathVector meshPaths;
+        for (const SdfPath &primPath :
+             HdSceneIndexPrimView(_GetInputSceneIndex())) {
+            if (_GetInputSceneIndex()->GetPrim(primPath).primType ==
+                HdPrimTypeTokens->mesh)
+                meshPaths.push_back(primPath);
+        }
+
+        std::vector<size_t> hashes = _ComputeMeshHashes(meshPaths);
+        for (size_t i = 0; i < meshPaths.size(); i++)
+            _AddMesh(meshPaths[i], hashes[i], &changes);
+    }
+
+    _SendChanges(changes);
+}
+
+std::vector<size_t> InstancingSceneIndex::_ComputeMeshHashes(
+    const SdfPathVector &primPaths) const
+{
+    // the meshes are hashed on worker threads, the data sources of the
+    // scene indices are thread safe
+    std::vector<size_t> hashes(primPaths.size());
+    WorkParallelForN(primPaths.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            if (_GetInputSceneIndex()->GetPrim(primPaths[i]).primType ==
+                HdPrimTypeTokens->mesh)
+                hashes[i] = _ComputeMeshHash(primPaths[i]);
+        }
+    });
+    return hashes;
+}
+
+void InstancingSceneIndex::_AddMesh(const SdfPath &primPath, size_t hash,
+                                    _Changes *changes)
+{
+    if (hash == 0) return;
+    changes->meshes.insert({primPath, false});
+
+    // the meshes of a hash are split by their actual data in case of
+    // collisions
+    auto range = _hashGroups.equal_range(hash);
+    auto hashIt = range.first;
+    while (hashIt != range.second &&
+           !_AreMeshesEqual(*_groups.at(hashIt->second).instancePaths.begin(),
+                            primPath))
+        ++hashIt;
+
+    size_t groupId;
+    if (hashIt != range.second) groupId = hashIt->second;
+    else {
+        groupId = _nextGroupId++;
+        SdfPath instancerPath = _rootPath.AppendChild(
+            TfToken("Instancer_" + std::to_string(groupId)));
+        _groups[groupId] = {hash, instancerPath,
+                            instancerPath.AppendChild(TfToken("Prototype")),
+                            {}, _ComputeMemoryUsage(primPath)};
+        _hashGroups.insert({hash, groupId});
+        _instancerGroups[instancerPath] = groupId;
+        _prototypeGroups[_groups[groupId].prototypePath] = groupId;
+    }
+
+    _RecordGroup(groupId, changes);
+    _Group &group = _groups.at(groupId);
+    bool wasActive = _IsActive(group);
+    group.instancePaths.insert(primPath);
+    if (!wasActive && _IsActive(group)) _activeGroupCount++;
+    _meshGroups[primPath] = groupId;
+}
+
+InstancingSceneIndex::_MeshGroups::iterator InstancingSceneIndex::_RemoveMesh(
+    _MeshGroups::iterator it, _Changes *changes)
+{
+    changes->meshes.insert({it->first, _IsInstanced(it->first)});
+
+    size_t groupId = it->second;
+    _RecordGroup(groupId, changes);
+    _Group &group = _groups.at(groupId);
+    bool wasActive = _IsActive(group);
+    group.instancePaths.erase(it->first);
+    if (wasActive && !_IsActive(group)) _activeGroupCount--;
+
+    if (group.instancePaths.empty()) {
+        auto range = _hashGroups.equal_range(group.hash);
+        for (auto hashIt = range.first; hashIt != range.second; ++hashIt) {
+            if (hashIt->second == groupId) {
+                _hashGroups.erase(hashIt);
+                break;
+            }
+        }
+        _instancerGroups.erase(group.instancerPath);
+        _prototypeGroups.erase(group.prototypePath);
+        _groups.erase(groupId);
+    }
+    return _meshGroups.erase(it);
+}
+
+void InstancingSceneIndex::_RecordGroup(size_t groupId,
+                                        _Changes *changes) const
+{
+    if (changes->groups.count(groupId)) return;
+
+    const _Group &group = _groups.at(groupId);
+    SdfPath sourcePath = group.instancePaths.empty()
+                             ? SdfPath()
+                             : *group.instancePaths.begin();
+    changes->groups[groupId] = {_IsActive(group), group.instancerPath,
+                                sourcePath};
+}
+
+void InstancingSceneIndex::_SendChanges(const _Changes &changes)
+{
+    HdSceneIndexObserver::RemovedPrimEntries removedEntries;
+    HdSceneIndexObserver::AddedPrimEntries addedEntries;
+    HdSceneIndexObserver::DirtiedPrimEntries dirtiedEntries;
+
+    // removing the root removes all the instancers
+    if (changes.activeGroupCount > 0 && _activeGroupCount == 0)
+        removedEntries.push_back({_rootPath});
+    if (changes.activeGroupCount == 0 && _activeGroupCount > 0)
+        addedEntries.push_back({_rootPath, TfToken()});
+
+    // the meshes of the groups drawn or hidden change their type
+    std::map<SdfPath, bool> instancedPaths;
+    for (auto &&[groupId, state] : changes.groups) {
+        auto it = _groups.find(groupId);
+        bool isActive = it != _groups.end() && _IsActive(it->second);
+
+        if (state.wasActive && !isActive) {
+            if (_activeGroupCount > 0)
+                removedEntries.push_back({state.instancerPath});
+            if (it == _groups.end()) continue;
+            for (auto &&path : it->second.instancePaths)
+                instancedPaths[path] = false;
+        }
+        else if (!state.wasActive && isActive) {
+            const _Group &group = it->second;
+            addedEntries.push_back(
+                {group.instancerPath, HdPrimTypeTokens->instancer});
+            addedEntries.push_back(
+                {group.prototypePath, HdPrimTypeTokens->mesh});
+            for (auto &&path : group.instancePaths) instancedPaths[path] = true;
+        }
+        else if (isActive) {
+            const _Group &group = it->second;
+            dirtiedEntries.push_back(
+                {group.instancerPath,
+                 {HdInstancerTopologySchema::GetDefaultLocator(),
+                  HdPrimvarsSchema::GetDefaultLocator()}});
+            if (*group.instancePaths.begin() != state.prototypeSourcePath) {
+                dirtiedEntries.push_back(
+                    {group.prototypePath,
+                     HdDataSourceLocatorSet::UniversalSet()});
+            }
+        }
+    }
+
+    // the meshes that moved between groups drawn or not
+    for (auto &&[path, wasInstanced] : changes.meshes) {
+        if (instancedPaths.count(path)) continue;
+        bool isInstanced = _IsInstanced(path);
+        if (isInstanced != wasInstanced) instancedPaths[path] = isInstanced;
+    }
+    for (auto &&[path, isInstanced] : instancedPaths) {
+        addedEntries.push_back(
+            {path, isInstanced
+                       ? TfToken()
+                       : _GetInputSceneIndex()->GetPrim(path).primType});
+    }
+
+    if (!removedEntries.empty()) _SendPrimsRemoved(removedEntries);
+    if (!addedEntries.empty()) _SendPrimsAdded(addedEntries);
+    if (!dirtiedEntries.empty()) _SendPrimsDirtied(dirtiedEntries);
+}
+
+bool InstancingSceneIndex::_IsActive(const _Group &group) const
+{
+    return group.instancePaths.size() >= _MIN_INSTANCE_COUNT;
+}
+
+bool InstancingSceneIndex::_IsInstanced(const SdfPath &primPath) const
+{
+    auto it = _meshGroups.find(primPath);
+    return it != _meshGroups.end() && _IsActive(_groups.at(it->second));
+}
+
+size_t InstancingSceneIndex::_ComputeMemoryUsage(const SdfPath &primPath) const
+{
+    HdSceneIndexPrim prim = _GetInputSceneIndex()->GetPrim(primPath);
+    HdMeshTopologySchema topology =
+        HdMeshSchema::GetFromParent(prim.dataSource).GetTopology();
+    VtValue points =
+        _GetPrimvarValue(HdPrimvarsSchema::GetFromParent(prim.dataSource)
+                             .GetPrimvar(HdPrimvarsSchemaTokens->points));
+
+    return topology.GetFaceVertexCounts()->GetTypedValue(0).size() *
+               sizeof(int) +
+           topology.GetFaceVertexIndices()->GetTypedValue(0).size() *
+               sizeof(int) +
+           points.UncheckedGet<VtVec3fArray>().size() * sizeof(GfVec3f);
+}
+
+size_t InstancingSceneIndex::_ComputeMeshHash(const SdfPath &primPath) const
+{
+    if (_deformingMeshes.count(primPath)) return 0;
+
+    HdSceneIndexPrim prim = _GetInputSceneIndex()->GetPrim(primPath);
+    if (!prim.dataSource) return 0;
+
+    // the meshes already instanced or hidden are left as they are
+    if (HdInstancedBySchema::GetFromParent(prim.dataSource).IsDefined())
+        return 0;
+    HdVisibilitySchema visibility =
+        HdVisibilitySchema::GetFromParent(prim.dataSource);
+    if (visibility.GetVisibility() &&
+        !visibility.GetVisibility()->GetTypedValue(0))
+        return 0;
+
+    HdMeshSchema mesh = HdMeshSchema::GetFromParent(prim.dataSource);
+    HdMeshTopologySchema topology = mesh.GetTopology();
+    if (!topology.GetFaceVertexCounts() || !topology.GetFaceVertexIndices())
+        return 0;
+
+    HdPrimvarsSchema primvars = HdPrimvarsSchema::GetFromParent(prim.dataSource);
+    VtValue points =
+        _GetPrimvarValue(primvars.GetPrimvar(HdPrimvarsSchemaTokens->points));
+    if (!points.IsHolding<VtVec3fArray>()) return 0;
+
+    size_t hash = TfHash::Combine(
+        topology.GetFaceVertexCounts()->GetTypedValue(0),
+        topology.GetFaceVertexIndices()->GetTypedValue(0),
+        points.UncheckedGet<VtVec3fArray>());
+
+    if (topology.GetOrientation())
+        hash = TfHash::Combine(hash, topology.GetOrientation()->GetTypedValue(0));
+    if (mesh.GetSubdivisionScheme())
+        hash = TfHash::Combine(hash, mesh.GetSubdivisionScheme()->GetTypedValue(0));
+    if (mesh.GetDoubleSided())
+        hash = TfHash::Combine(hash, mesh.GetDoubleSided()->GetTypedValue(0));
+
+    HdPurposeSchema purpose = HdPurposeSchema::GetFromParent(prim.dataSource);
+    if (purpose.GetPurpose())
+        hash = TfHash::Combine(hash, purpose.GetPurpose()->GetTypedValue(0));
+
+    HdMaterialBindingSchema materialBinding =
+        HdMaterialBindingsSchema::GetFromParent(prim.dataSource)
+            .GetMaterialBinding(HdMaterialBindingsSchemaTokens->allPurpose);
+    if (materialBinding.GetPath())
+        hash = TfHash::Combine(hash, materialBinding.GetPath()->GetTypedValue(0));
+
+    // the instances share the primvars of their prototype
+    for (auto &&name : primvars.GetPrimvarNames()) {
+        if (name == HdPrimvarsSchemaTokens->points) continue;
+
+        HdPrimvarSchema primvar = primvars.GetPrimvar(name);
+        hash = TfHash::Combine(hash, name, _GetPrimvarValue(primvar).GetHash());
+        if (primvar.GetInterpolation())
+            hash = TfHash::Combine(hash, primvar.GetInterpolation()->GetTypedValue(0));
+        if (primvar.GetIndices())
+            hash = TfHash::Combine(hash, primvar.GetIndices()->GetTypedValue(0));
+    }
+
+    // 0 flags the meshes that cannot be instanced
+    return hash ? hash : 1;
+}
+
+bool InstancingSceneIndex::_AreMeshesEqual(const SdfPath &primPath,
+                                           const SdfPath &otherPrimPath) const
+{
+    HdSceneIndexPrim prim = _GetInputSceneIndex()->GetPrim(primPath);
+    HdSceneIndexPrim otherPrim = _GetInputSceneIndex()->GetPrim(otherPrimPath);
+
+    HdMeshTopologySchema topology =
+        HdMeshSchema::GetFromParent(prim.dataSource).GetTopology();
+    HdMeshTopologySchema otherTopology =
+        HdMeshSchema::GetFromParent(otherPrim.dataSource).GetTopology();
+    if (topology.GetFaceVertexCounts()->GetTypedValue(0) !=
+            otherTopology.GetFaceVertexCounts()->GetTypedValue(0) ||
+        topology.GetFaceVertexIndices()->GetTypedValue(0) !=
+            otherTopology.GetFaceVertexIndices()->GetTypedValue(0))
+        return false;
+
+    return _GetPrimvarValue(HdPrimvarsSchema::GetFromParent(prim.dataSource)
+                                .GetPrimvar(HdPrimvarsSchemaTokens->points)) ==
+           _GetPrimvarValue(
+               HdPrimvarsSchema::GetFromParent(otherPrim.dataSource)
+                   .GetPrimvar(HdPrimvarsSchemaTokens->points));
+}
+
+HdSceneIndexPrim InstancingSceneIndex::_GetInstancerPrim(
+    const _Group &group) const
+{
+    VtIntArray instanceIndices(group.instancePaths.size());
+    VtMatrix4dArray instanceTransforms(group.instancePaths.size());
+    size_t i = 0;
+    for (auto &&instancePath : group.instancePaths) {
+        instanceIndices[i] = int(i);
+        instanceTransforms[i++] =
+            _GetXform(_GetInputSceneIndex()->GetPrim(instancePath));
+    }
+
+    HdDataSourceBaseHandle indices =
+        HdRetainedTypedSampledDataSource<VtIntArray>::New(instanceIndices);
+    HdContainerDataSourceHandle topology =
+        HdInstancerTopologySchema::Builder()
+            .SetPrototypes(_PathArrayDataSource::New({group.prototypePath}))
+            .SetInstanceIndices(HdRetainedSmallVectorDataSource::New(1, &indices))
+            .Build();
+
+    HdContainerDataSourceHandle primvars = HdRetainedContainerDataSource::New(
+        HdInstancerTokens->instanceTransforms,
+        HdPrimvarSchema::Builder()
+            .SetPrimvarValue(
+                HdRetainedTypedSampledDataSource<VtMatrix4dArray>::New(
+                    instanceTransforms))
+            .SetInterpolation(HdPrimvarSchema::BuildInterpolationDataSource(
+                HdPrimvarSchemaTokens->instance))
+            .Build());
+
+    return {HdPrimTypeTokens->instancer,
+            HdRetainedContainerDataSource::New(
+                HdInstancerTopologySchemaTokens->instancerTopology, topology,
+                HdPrimvarsSchemaTokens->primvars, primvars,
+                HdXformSchemaTokens->xform,
+                HdXformSchema::Builder()
+                    .SetMatrix(HdRetainedTypedSampledDataSource<GfMatrix4d>::New(
+                        GfMatrix4d(1)))
+                    .Build())};
+}
+
+HdSceneIndexPrim InstancingSceneIndex::_GetPrototypePrim(
+    const _Group &group) const
+{
+    // the prototype is a copy of the first instance, placed by the instancer
+    HdSceneIndexPrim prim =
+        _GetInputSceneIndex()->GetPrim(*group.instancePaths.begin());
+
+    HdContainerDataSourceHandle overlay = HdRetainedContainerDataSource::New(
+        HdXformSchemaTokens->xform,
+        HdXformSchema::Builder()
+            .SetMatrix(
+                HdRetainedTypedSampledDataSource<GfMatrix4d>::New(GfMatrix4d(1)))
+            .Build(),
+        HdInstancedBySchemaTokens->instancedBy,
+        HdInstancedBySchema::Builder()
+            .SetPaths(_PathArrayDataSource::New({group.instancerPath}))
+            .SetPrototypeRoots(_PathArrayDataSource::New({group.prototypePath}))
+            .Build());
+
+    return {HdPrimTypeTokens->mesh,
+            HdOverlayContainerDataSource::New(overlay, prim.dataSource)};
+}
+
+PXR_NAMESPACE_CLOSE_SCOPE
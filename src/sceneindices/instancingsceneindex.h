@@ -0,0 +1,332 @@
+/**
+ * @file instancingsceneindex.h
+ * @author Raphael Jouretz (rjouretz.com)
+ * @brief Hydra Filter Scene Index that draws the identical meshes of the
+ * scene as instances of a single prototype.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <pxr/imaging/hd/filteringSceneIndex.h>
+#include <pxr/imaging/hd/sceneIndex.h>
+#include <pxr/pxr.h>
+
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+class InstancingSceneIndex;
+
+TF_DECLARE_REF_PTRS(InstancingSceneIndex);
+
+/**
+ * @class InstancingSceneIndex
+ * @brief Hydra Filter Scene Index that draws the identical meshes of the
+ * scene as instances of a single prototype.
+ *
+ * The meshes are hashed by topology, points, primvars and material binding.
+ * Each group of identical meshes is drawn by an instancer prim under
+ * /__AutoInstancer holding a copy of the first mesh as prototype, with the
+ * world xforms of the meshes as instance transforms. The original meshes
+ * lose their type so that the render delegate drops them, they keep their
+ * data for the other views. The added, removed or edited meshes only update
+ * the groups they leave or join, the whole scene is only hashed when the
+ * instancing is enabled. The meshes whose points are dirtied, e.g. the
+ * animated ones, are left out of the instancing rather than hashed and
+ * grouped again on every time change. The instances map back to their
+ * meshes, so that
+ * the picking and the selection work on the paths of the meshes.
+ */
+class InstancingSceneIndex : public HdSingleInputFilteringSceneIndexBase {
+    public:
+        /**
+         * @brief Create a ref pointer to an instancing scene index
+         *
+         * @return InstancingSceneIndexRefPtr the ref pointer to an instancing
+         * scene index
+         */
+        static InstancingSceneIndexRefPtr New(
+            const HdSceneIndexBaseRefPtr &inputSceneIndex)
+        {
+            return TfCreateRefPtr(new InstancingSceneIndex(inputSceneIndex));
+        }
+
+        /**
+         * @brief Construct a new Instancing Scene Index object
+         *
+         * @param inputSceneIndex the scene index to instance the meshes from
+         */
+        InstancingSceneIndex(const HdSceneIndexBaseRefPtr &inputSceneIndex);
+
+        /**
+         * @brief Enable or disable the automatic instancing
+         *
+         * @param isEnabled true to instance the identical meshes, false to
+         * draw them all separately
+         */
+        void SetEnabled(bool isEnabled);
+
+        /**
+         * @brief Get whether the automatic instancing is enabled
+         *
+         * @return true if the automatic instancing is enabled, false
+         * otherwise
+         */
+        bool IsEnabled() const;
+
+        /**
+         * @brief Get the number of prototypes drawn
+         *
+         * @return size_t the number of prototypes
+         */
+        size_t GetPrototypeCount() const;
+
+        /**
+         * @brief Get the number of meshes drawn as instances
+         *
+         * @return size_t the number of instanced meshes
+         */
+        size_t GetInstanceCount() const;
+
+        /**
+         * @brief Get an estimation of the GPU memory saved by uploading each
+         * prototype once
+         *
+         * @return size_t the memory saved in bytes
+         */
+        size_t GetMemorySaved() const;
+
+        /**
+         * @brief Get the number of draw calls saved by drawing the instances
+         * of each prototype at once
+         *
+         * @return size_t the number of draw calls saved
+         */
+        size_t GetDrawCallsSaved() const;
+
+        /**
+         * @brief Get the mesh drawn by an instance of an instancer
+         *
+         * @param instancerPath the path of the instancer
+         * @param instanceIndex the index of the instance
+         * @return SdfPath the path of the mesh, empty if the instancer is not
+         * one of the automatic instancers
+         */
+        SdfPath GetInstancedMeshPath(const SdfPath &instancerPath,
+                                     int instanceIndex) const;
+
+        /**
+         * @brief Get the instance drawing a mesh
+         *
+         * @param primPath the path of the mesh
+         * @param prototypePath the path of the prototype drawing the mesh
+         * @param instanceIndex the index of the instance of the mesh
+         * @return true if the mesh is drawn as an instance, false otherwise
+         */
+        bool GetInstance(const SdfPath &primPath, SdfPath *prototypePath,
+                         int *instanceIndex) const;
+
+        /**
+         * @brief Override of
+         * HdSingleInputFilteringSceneIndexBase::GetPrim
+         */
+        virtual HdSceneIndexPrim GetPrim(
+            const SdfPath &primPath) const override;
+
+        /**
+         * @brief Override of
+         * HdSingleInputFilteringSceneIndexBase::GetChildPrimPaths
+         */
+        virtual SdfPathVector GetChildPrimPaths(
+            const SdfPath &primPath) const override;
+
+    protected:
+        /**
+         * @brief Override of
+         * HdSingleInputFilteringSceneIndexBase::_PrimsAdded
+         */
+        virtual void _PrimsAdded(
+            const HdSceneIndexBase &sender,
+            const HdSceneIndexObserver::AddedPrimEntries &entries)
+            override;
+
+        /**
+         * @brief Override of
+         * HdSingleInputFilteringSceneIndexBase::_PrimsRemoved
+         */
+        virtual void _PrimsRemoved(
+            const HdSceneIndexBase &sender,
+            const HdSceneIndexObserver::RemovedPrimEntries &entries)
+            override;
+
+        /**
+         * @brief Override of
+         * HdSingleInputFilteringSceneIndexBase::_PrimsDirtied
+         */
+        virtual void _PrimsDirtied(
+            const HdSceneIndexBase &sender,
+            const HdSceneIndexObserver::DirtiedPrimEntries &entries)
+            override;
+
+    private:
+        const size_t _MIN_INSTANCE_COUNT = 2;
+
+        struct _Group {
+            size_t hash;
+            SdfPath instancerPath, prototypePath;
+            std::set<SdfPath> instancePaths;
+            size_t meshMemoryUsage;
+        };
+
+        struct _GroupState {
+            bool wasActive;
+            SdfPath instancerPath, prototypeSourcePath;
+        };
+
+        /**
+         * @brief The state of the groups and meshes before a batch of
+         * changes, kept at their first change
+         *
+         * @param activeGroupCount the number of groups drawn
+         * @param groups the state of the changed groups by identifier
+         * @param meshes whether the changed meshes were instanced
+         */
+        struct _Changes {
+            size_t activeGroupCount;
+            std::map<size_t, _GroupState> groups;
+            std::unordered_map<SdfPath, bool, SdfPath::Hash> meshes;
+        };
+
+        using _MeshGroups = std::map<SdfPath, size_t>;
+
+        bool _isEnabled;
+        SdfPath _rootPath;
+        size_t _nextGroupId, _activeGroupCount;
+        std::map<size_t, _Group> _groups;
+        std::unordered_multimap<size_t, size_t> _hashGroups;
+        _MeshGroups _meshGroups;
+        std::unordered_map<SdfPath, size_t, SdfPath::Hash> _instancerGroups;
+        std::unordered_map<SdfPath, size_t, SdfPath::Hash> _prototypeGroups;
+        std::set<SdfPath> _deformingMeshes;
+
+        /**
+         * @brief Group the identical meshes of the input scene index from
+         * scratch, or ungroup them all if the instancing is disabled
+         *
+         */
+        void _Rebuild();
+
+        /**
+         * @brief Hash the given meshes on worker threads
+         *
+         * @param primPaths the paths of the prims
+         * @return std::vector<size_t> the hashes, 0 for the prims that are
+         * not meshes or cannot be instanced
+         */
+        std::vector<size_t> _ComputeMeshHashes(
+            const SdfPathVector &primPaths) const;
+
+        /**
+         * @brief Add a mesh to the group of its identical meshes, creating
+         * the group if needed
+         *
+         * @param primPath the path of the mesh, in no group
+         * @param hash the hash of the mesh, 0 if it cannot be instanced
+         * @param changes the changes to record the previous state in
+         */
+        void _AddMesh(const SdfPath &primPath, size_t hash,
+                      _Changes *changes);
+
+        /**
+         * @brief Remove a mesh from its group, removing the group once empty
+         *
+         * @param it the iterator of the mesh in the mesh groups
+         * @param changes the changes to record the previous state in
+         * @return _MeshGroups::iterator the iterator of the next mesh
+         */
+        _MeshGroups::iterator _RemoveMesh(_MeshGroups::iterator it,
+                                          _Changes *changes);
+
+        /**
+         * @brief Record the state of a group before its first change
+         *
+         * @param groupId the identifier of the group
+         * @param changes the changes to record the state in
+         */
+        void _RecordGroup(size_t groupId, _Changes *changes) const;
+
+        /**
+         * @brief Send the notices of the groups drawn or hidden and of the
+         * meshes whose instancing changed since the given state
+         *
+         * @param changes the state before the changes
+         */
+        void _SendChanges(const _Changes &changes);
+
+        /**
+         * @brief Get whether a group has enough meshes to be drawn
+         *
+         * @param group the group of identical meshes
+         * @return true if the group is drawn by an instancer, false otherwise
+         */
+        bool _IsActive(const _Group &group) const;
+
+        /**
+         * @brief Get whether a mesh is drawn as an instance
+         *
+         * @param primPath the path of the mesh
+         * @return true if the mesh is in a drawn group, false otherwise
+         */
+        bool _IsInstanced(const SdfPath &primPath) const;
+
+        /**
+         * @brief Estimate the GPU memory used by the topology and points of
+         * a mesh
+         *
+         * @param primPath the path of the mesh
+         * @return size_t the memory usage in bytes
+         */
+        size_t _ComputeMemoryUsage(const SdfPath &primPath) const;
+
+        /**
+         * @brief Compute the hash of a mesh, 0 if the mesh cannot be
+         * instanced
+         *
+         * @param primPath the path of the mesh
+         * @return size_t the hash of the mesh
+         */
+        size_t _ComputeMeshHash(const SdfPath &primPath) const;
+
+        /**
+         * @brief Get whether two meshes have the same topology and points
+         *
+         * @param primPath the path of the first mesh
+         * @param otherPrimPath the path of the second mesh
+         * @return true if the meshes are identical, false otherwise
+         */
+        bool _AreMeshesEqual(const SdfPath &primPath,
+                             const SdfPath &otherPrimPath) const;
+
+        /**
+         * @brief Get the instancer prim of a group
+         *
+         * @param group the group of identical meshes
+         * @return HdSceneIndexPrim the instancer prim
+         */
+        HdSceneIndexPrim _GetInstancerPrim(const _Group &group) const;
+
+        /**
+         * @brief Get the prototype prim of a group
+         *
+         * @param group the group of identical meshes
+         * @return HdSceneIndexPrim the prototype prim
+         */
+        HdSceneIndexPrim _GetPrototypePrim(const _Group &group) const;
+};
+
+PXR_NAMESPACE_CLOSE_SCOPE
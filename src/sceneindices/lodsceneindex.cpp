@@ -0,0 +1,582 @@
+#include "lodsceneindex.h"
+
+#include "cullingsceneindex.h"
+
+#include <pxr/base/gf/range3f.h>
+#include <pxr/base/tf/hash.h>
+#include <pxr/imaging/hd/extentSchema.h>
+#include <pxr/imaging/hd/meshSchema.h>
+#include <pxr/imaging/hd/meshTopologySchema.h>
+#include <pxr/imaging/hd/primvarSchema.h>
+#include <pxr/imaging/hd/primvarsSchema.h>
+#include <pxr/imaging/hd/retainedDataSource.h>
+#include <pxr/imaging/hd/sceneIndexPrimView.h>
+#include <pxr/imaging/hd/tokens.h>
+#include <pxr/imaging/hd/xformSchema.h>
+
+#include <algorithm>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+namespace {
+
+/**
+ * @brief Get the points of a mesh
+ *
+ * @param prim the mesh prim
+ * @return VtVec3fArray the points, empty if the mesh has none
+ */
+VtVec3fArray _GetPoints(const HdSceneIndexPrim &prim)
+{
+    HdPrimvarsSchema primvars = HdPrimvarsSchema::GetFromParent(prim.dataSource);
+    HdPrimvarSchema points = primvars.GetPrimvar(HdPrimvarsSchemaTokens->points);
+    if (!points.GetPrimvarValue()) return VtVec3fArray();
+
+    VtValue value = points.GetPrimvarValue()->GetValue(0);
+    if (!value.IsHolding<VtVec3fArray>()) return VtVec3fArray();
+    return value.UncheckedGet<VtVec3fArray>();
+}
+
+/**
+ * @brief Get the face vertex counts and indices of a mesh
+ *
+ * @param prim the mesh prim
+ * @param faceVertexCounts the resulting face vertex counts
+ * @param faceVertexIndices the resulting face vertex indices
+ * @return true if the mesh has a topology, false otherwise
+ */
+bool _GetTopology(const HdSceneIndexPrim &prim, VtIntArray *faceVertexCounts,
+                  VtIntArray *faceVertexIndices)
+{
+    HdMeshTopologySchema topology =
+        HdMeshSchema::GetFromParent(prim.dataSource).GetTopology();
+    if (!topology.GetFaceVertexCounts() || !topology.GetFaceVertexIndices())
+        return false;
+
+    *faceVertexCounts = topology.GetFaceVertexCounts()->GetTypedValue(0);
+    *faceVertexIndices = topology.GetFaceVertexIndices()->GetTypedValue(0);
+    return true;
+}
+
+}  // namespace
+
+LodSceneIndex::LodSceneIndex(const HdSceneIndexBaseRefPtr &inputSceneIndex)
+    : HdSingleInputFilteringSceneIndexBase(inputSceneIndex),
+      _isEnabled(false),
+      _isDirty(false),
+      _screenSizeThreshold(.05),
+      _cacheBudget(256 * 1024 * 1024),
+      _cacheMemoryUsage(0),
+      _hitCount(0),
+      _missCount(0)
+{
+    SetDisplayName("LodSceneIndex");
+}
+
+LodSceneIndex::~LodSceneIndex()
+{
+    _dispatcher.Wait();
+}
+
+void LodSceneIndex::SetEnabled(bool isEnabled)
+{
+    if (_isEnabled == isEnabled) return;
+    _isEnabled = isEnabled;
+
+    if (_isEnabled) {
+        _Populate();
+        return;
+    }
+
+    // restore the full detail and release the cache
+    HdSceneIndexObserver::DirtiedPrimEntries entries;
+    for (auto &&it : _simplifiedPaths) {
+        entries.push_back({it.first,
+                           {HdMeshSchema::GetDefaultLocator(),
+                            HdPrimvarsSchema::GetDefaultLocator()}});
+    }
+
+    _meshes.clear();
+    _simplifiedPaths.clear();
+    _cache.clear();
+    _lruKeys.clear();
+    _cacheMemoryUsage = 0;
+
+    if (!entries.empty()) _SendPrimsDirtied(entries);
+}
+
+bool LodSceneIndex::IsEnabled() const
+{
+    return _isEnabled;
+}
+
+void LodSceneIndex::SetFrustum(const GfFrustum &frustum)
+{
+    if (frustum == _frustum) return;
+    _frustum = frustum;
+    _isDirty = true;
+}
+
+void LodSceneIndex::SetScreenSizeThreshold(double size)
+{
+    if (size == _screenSizeThreshold) return;
+    _screenSizeThreshold = size;
+    _isDirty = true;
+}
+
+double LodSceneIndex::GetScreenSizeThreshold() const
+{
+    return _screenSizeThreshold;
+}
+
+void LodSceneIndex::SetCacheBudget(size_t bytes)
+{
+    _cacheBudget = bytes;
+    _EvictCache();
+}
+
+size_t LodSceneIndex::GetCacheBudget() const
+{
+    return _cacheBudget;
+}
+
+void LodSceneIndex::CopySettings(const LodSceneIndexRefPtr &other)
+{
+    _screenSizeThreshold = other->_screenSizeThreshold;
+    _cacheBudget = other->_cacheBudget;
+    _frustum = other->_frustum;
+
+    // the cache is keyed by the meshes, it stays valid on a new input
+    _cache.clear();
+    _lruKeys.clear();
+    _cacheMemoryUsage = 0;
+    for (size_t key : other->_lruKeys) {
+        const _Simplified &simplified = other->_cache.at(key).first;
+        _lruKeys.push_back(key);
+        _cacheMemoryUsage += simplified.memoryUsage;
+        _cache[key] = {simplified, std::prev(_lruKeys.end())};
+    }
+
+    SetEnabled(other->_isEnabled);
+    _isDirty = true;
+}
+
+size_t LodSceneIndex::GetCacheMemoryUsage() const
+{
+    return _cacheMemoryUsage;
+}
+
+size_t LodSceneIndex::GetHitCount() const
+{
+    return _hitCount;
+}
+
+size_t LodSceneIndex::GetMissCount() const
+{
+    return _missCount;
+}
+
+size_t LodSceneIndex::GetSimplifiedCount() const
+{
+    return _simplifiedPaths.size();
+}
+
+size_t LodSceneIndex::GetPendingCount() const
+{
+    return _pendingKeys.size();
+}
+
+void LodSceneIndex::Update()
+{
+    std::vector<std::pair<size_t, _Simplified>> completed;
+    {
+        std::lock_guard<std::mutex> lock(_completedMutex);
+        completed.swap(_completed);
+    }
+
+    for (auto &&[key, simplified] : completed) {
+        _pendingKeys.erase(key);
+
+        // disabled while simplifying
+        if (!_isEnabled || _cache.count(key)) continue;
+
+        _lruKeys.push_front(key);
+        _cacheMemoryUsage += simplified.memoryUsage;
+        _cache[key] = {std::move(simplified), _lruKeys.begin()};
+        _isDirty = true;
+    }
+
+    if (_isEnabled && _isDirty) _Evaluate();
+}
+
+HdSceneIndexPrim LodSceneIndex::GetPrim(const SdfPath &primPath) const
+{
+    HdSceneIndexPrim prim = _GetInputSceneIndex()->GetPrim(primPath);
+    if (!prim.dataSource || _simplifiedPaths.empty()) return prim;
+
+    auto it = _simplifiedPaths.find(primPath);
+    if (it == _simplifiedPaths.end()) return prim;
+    auto cacheIt = _cache.find(it->second);
+    if (cacheIt == _cache.end()) return prim;
+    const _Simplified &simplified = cacheIt->second.first;
+
+    using _IntArrayDataSource = HdRetainedTypedSampledDataSource<VtIntArray>;
+    using _PointDataSource = HdRetainedTypedSampledDataSource<VtVec3fArray>;
+
+    HdMeshSchema meshSchema = HdMeshSchema::GetFromParent(prim.dataSource);
+    HdContainerDataSourceHandle mesh =
+        HdMeshSchema::Builder()
+            .SetTopology(
+                HdMeshTopologySchema::Builder()
+                    .SetFaceVertexCounts(
+                        _IntArrayDataSource::New(simplified.faceVertexCounts))
+                    .SetFaceVertexIndices(
+                        _IntArrayDataSource::New(simplified.faceVertexIndices))
+                    .SetOrientation(meshSchema.GetTopology().GetOrientation())
+                    .Build())
+            .SetSubdivisionScheme(meshSchema.GetSubdivisionScheme())
+            .SetDoubleSided(meshSchema.GetDoubleSided())
+            .Build();
+
+    // only the constant primvars still apply to the simplified topology
+    HdPrimvarsSchema primvarsSchema =
+        HdPrimvarsSchema::GetFromParent(prim.dataSource);
+    TfTokenVector primvarNames;
+    std::vector<HdDataSourceBaseHandle> primvarValues;
+    for (auto &&name : primvarsSchema.GetPrimvarNames()) {
+        HdPrimvarSchema primvar = primvarsSchema.GetPrimvar(name);
+        if (name == HdPrimvarsSchemaTokens->points) {
+            primvarNames.push_back(name);
+            primvarValues.push_back(
+                HdPrimvarSchema::Builder()
+                    .SetPrimvarValue(_PointDataSource::New(simplified.points))
+                    .SetRole(HdPrimvarSchema::BuildRoleDataSource(
+                        HdPrimvarSchemaTokens->point))
+                    .SetInterpolation(
+                        HdPrimvarSchema::BuildInterpolationDataSource(
+                            HdPrimvarSchemaTokens->vertex))
+                    .Build());
+        }
+        else if (primvar.GetInterpolation() &&
+                 primvar.GetInterpolation()->GetTypedValue(0) ==
+                     HdPrimvarSchemaTokens->constant) {
+            primvarNames.push_back(name);
+            primvarValues.push_back(primvar.GetContainer());
+        }
+    }
+
+    TfTokenVector names = prim.dataSource->GetNames();
+    std::vector<HdDataSourceBaseHandle> values;
+    for (auto &&name : names) {
+        if (name == HdMeshSchemaTokens->mesh) values.push_back(mesh);
+        else if (name == HdPrimvarsSchemaTokens->primvars) {
+            values.push_back(HdRetainedContainerDataSource::New(
+                primvarNames.size(), primvarNames.data(),
+                primvarValues.data()));
+        }
+        else values.push_back(prim.dataSource->Get(name));
+    }
+
+    prim.dataSource = HdRetainedContainerDataSource::New(
+        names.size(), names.data(), values.data());
+    return prim;
+}
+
+SdfPathVector LodSceneIndex::GetChildPrimPaths(const SdfPath &primPath) const
+{
+    return _GetInputSceneIndex()->GetChildPrimPaths(primPath);
+}
+
+void LodSceneIndex::_PrimsAdded(
+    const HdSceneIndexBase &sender,
+    const HdSceneIndexObserver::AddedPrimEntries &entries)
+{
+    _SendPrimsAdded(entries);
+    if (!_isEnabled) return;
+
+    SdfPathVector primPaths;
+    for (auto &&entry : entries) primPaths.push_back(entry.primPath);
+    _UpdateMeshes(primPaths, true);
+}
+
+void LodSceneIndex::_PrimsRemoved(
+    const HdSceneIndexBase &sender,
+    const HdSceneIndexObserver::RemovedPrimEntries &entries)
+{
+    _SendPrimsRemoved(entries);
+    if (!_isEnabled) return;
+
+    // removing a prim removes its whole subtree
+    for (auto &&entry : entries) {
+        auto it = _meshes.lower_bound(entry.primPath);
+        while (it != _meshes.end() && it->first.HasPrefix(entry.primPath))
+            it = _meshes.erase(it);
+
+        auto simplifiedIt = _simplifiedPaths.lower_bound(entry.primPath);
+        while (simplifiedIt != _simplifiedPaths.end() &&
+               simplifiedIt->first.HasPrefix(entry.primPath))
+            simplifiedIt = _simplifiedPaths.erase(simplifiedIt);
+    }
+}
+
+void LodSceneIndex::_PrimsDirtied(
+    const HdSceneIndexBase &sender,
+    const HdSceneIndexObserver::DirtiedPrimEntries &entries)
+{
+    _SendPrimsDirtied(entries);
+    if (!_isEnabled) return;
+
+    static const HdDataSourceLocatorSet boundLocators = {
+        HdPrimvarsSchema::GetPointsLocator(),
+        HdXformSchema::GetDefaultLocator(),
+        HdExtentSchema::GetDefaultLocator()};
+
+    // the points of an animated mesh are dirtied every frame, only its
+    // bound is updated
+    SdfPathVector changedPaths, movedPaths, deformedPaths;
+    for (auto &&entry : entries) {
+        if (entry.dirtyLocators.Intersects(HdMeshSchema::GetDefaultLocator()))
+            changedPaths.push_back(entry.primPath);
+        else if (entry.dirtyLocators.Intersects(boundLocators)) {
+            movedPaths.push_back(entry.primPath);
+            if (entry.dirtyLocators.Intersects(
+                    HdPrimvarsSchema::GetPointsLocator()))
+                deformedPaths.push_back(entry.primPath);
+        }
+    }
+    if (!changedPaths.empty()) _UpdateMeshes(changedPaths, true);
+    if (!movedPaths.empty()) _UpdateMeshes(movedPaths, false);
+
+    for (auto &&primPath : deformedPaths) {
+        auto it = _meshes.find(primPath);
+        if (it != _meshes.end()) it->second.isDeforming = true;
+    }
+}
+
+void LodSceneIndex::_Populate()
+{
+    _meshes.clear();
+    _simplifiedPaths.clear();
+
+    SdfPathVector primPaths;
+    for (const SdfPath &primPath : HdSceneIndexPrimView(_GetInputSceneIndex()))
+        primPaths.push_back(primPath);
+
+    _UpdateMeshes(primPaths, true);
+}
+
+void LodSceneIndex::_UpdateMeshes(const SdfPathVector &primPaths,
+                                  bool isTopologyChanged)
+{
+    for (auto &&primPath : primPaths) {
+        HdSceneIndexPrim prim = _GetInputSceneIndex()->GetPrim(primPath);
+
+        // the points of a tracked mesh are not read again
+        auto it = _meshes.find(primPath);
+        if (it != _meshes.end() && !isTopologyChanged) {
+            if (!CullingSceneIndex::ComputeWorldBound(prim, &it->second.bound))
+                _meshes.erase(it);
+            continue;
+        }
+
+        GfRange3d bound;
+        bool isMesh = prim.primType == HdPrimTypeTokens->mesh &&
+                      _GetPoints(prim).size() >= _MIN_POINT_COUNT &&
+                      CullingSceneIndex::ComputeWorldBound(prim, &bound);
+
+        // the meshes no longer simplified are restored by the evaluation
+        if (!isMesh) {
+            _meshes.erase(primPath);
+            continue;
+        }
+
+        bool isSmall = it != _meshes.end() && it->second.isSmall;
+        _meshes[primPath] = {bound, 0, false, isSmall, false};
+    }
+    _isDirty = true;
+}
+
+bool LodSceneIndex::_ComputeKey(const SdfPath &primPath, size_t *key) const
+{
+    HdSceneIndexPrim prim = _GetInputSceneIndex()->GetPrim(primPath);
+
+    VtIntArray faceVertexCounts, faceVertexIndices;
+    if (!_GetTopology(prim, &faceVertexCounts, &faceVertexIndices))
+        return false;
+
+    VtVec3fArray points = _GetPoints(prim);
+    if (points.empty()) return false;
+
+    *key = TfHash::Combine(faceVertexCounts, faceVertexIndices, points);
+    return true;
+}
+
+void LodSceneIndex::_Simplify(const SdfPath &primPath, size_t key)
+{
+    HdSceneIndexPrim prim = _GetInputSceneIndex()->GetPrim(primPath);
+
+    VtIntArray faceVertexCounts, faceVertexIndices;
+    if (!_GetTopology(prim, &faceVertexCounts, &faceVertexIndices)) return;
+    VtVec3fArray points = _GetPoints(prim);
+
+    _pendingKeys.insert(key);
+    _missCount++;
+
+    // the arrays are shared copies, the worker never reads the scene
+    int resolution = _CLUSTER_RESOLUTION;
+    _dispatcher.Run([this, key, faceVertexCounts, faceVertexIndices, points,
+                     resolution]() {
+        _Simplified simplified = _ClusterVertices(
+            faceVertexCounts, faceVertexIndices, points, resolution);
+
+        std::lock_guard<std::mutex> lock(_completedMutex);
+        _completed.push_back({key, std::move(simplified)});
+    });
+}
+
+void LodSceneIndex::_Evaluate()
+{
+    _isDirty = false;
+
+    std::map<SdfPath, size_t> simplifiedPaths;
+    for (auto &&[path, mesh] : _meshes) {
+        // a simplified mesh is restored a bit further than it is simplified
+        // so that it does not flicker at the threshold
+        double size = CullingSceneIndex::ComputeScreenSize(_frustum, mesh.bound);
+        double threshold = _screenSizeThreshold;
+        if (mesh.isSmall) threshold *= _RESTORE_RATIO;
+
+        bool wasSmall = mesh.isSmall;
+        mesh.isSmall = size < threshold;
+        if (!mesh.isSmall || mesh.isDeforming) continue;
+
+        if (!mesh.isKeyValid) {
+            if (!_ComputeKey(path, &mesh.key)) continue;
+            mesh.isKeyValid = true;
+        }
+
+        auto it = _cache.find(mesh.key);
+        if (it != _cache.end()) {
+            if (!wasSmall) _hitCount++;
+            _lruKeys.splice(_lruKeys.begin(), _lruKeys, it->second.second);
+            simplifiedPaths[path] = mesh.key;
+        }
+        else if (_pendingKeys.count(mesh.key) == 0 &&
+                 _cacheMemoryUsage < _cacheBudget) {
+            _Simplify(path, mesh.key);
+        }
+    }
+
+    // only the meshes whose level of detail changed are dirtied
+    HdDataSourceLocatorSet locators = {HdMeshSchema::GetDefaultLocator(),
+                                       HdPrimvarsSchema::GetDefaultLocator()};
+    HdSceneIndexObserver::DirtiedPrimEntries entries;
+    for (auto &&it : simplifiedPaths) {
+        auto prevIt = _simplifiedPaths.find(it.first);
+        if (prevIt == _simplifiedPaths.end() || prevIt->second != it.second)
+            entries.push_back({it.first, locators});
+    }
+    for (auto &&it : _simplifiedPaths) {
+        if (simplifiedPaths.count(it.first) == 0)
+            entries.push_back({it.first, locators});
+    }
+
+    _simplifiedPaths.swap(simplifiedPaths);
+    if (!entries.empty()) _SendPrimsDirtied(entries);
+
+    _EvictCache();
+}
+
+void LodSceneIndex::_EvictCache()
+{
+    if (_cacheMemoryUsage <= _cacheBudget) return;
+
+    std::unordered_set<size_t> usedKeys;
+    for (auto &&it : _simplifiedPaths) usedKeys.insert(it.second);
+
+    auto it = _lruKeys.end();
+    while (_cacheMemoryUsage > _cacheBudget && it != _lruKeys.begin()) {
+        --it;
+        if (usedKeys.count(*it)) continue;
+
+        auto cacheIt = _cache.find(*it);
+        _cacheMemoryUsage -= cacheIt->second.first.memoryUsage;
+        _cache.erase(cacheIt);
+        it = _lruKeys.erase(it);
+    }
+}
+
+LodSceneIndex::_Simplified LodSceneIndex::_ClusterVertices(
+    const VtIntArray &faceVertexCounts, const VtIntArray &faceVertexIndices,
+    const VtVec3fArray &points, int resolution)
+{
+    _Simplified simplified;
+
+    GfRange3f range;
+    for (auto &&point : points) range.UnionWith(point);
+    GfVec3f size = range.GetSize();
+    float cellSize = std::max({size[0], size[1], size[2]}) / resolution;
+    if (cellSize <= 0) cellSize = 1;
+
+    // each point is replaced by the average of the points of its cell
+    std::unordered_map<int64_t, int> cellIndices;
+    std::vector<GfVec3f> sums;
+    std::vector<int> counts;
+    std::vector<int> remap(points.size());
+    for (size_t i = 0; i < points.size(); i++) {
+        GfVec3f cell = (points[i] - range.GetMin()) / cellSize;
+        int64_t x = std::min(static_cast<int>(cell[0]), resolution);
+        int64_t y = std::min(static_cast<int>(cell[1]), resolution);
+        int64_t z = std::min(static_cast<int>(cell[2]), resolution);
+        int64_t cellKey = (x * (resolution + 1) + y) * (resolution + 1) + z;
+
+        auto inserted = cellIndices.insert({cellKey, int(sums.size())});
+        if (inserted.second) {
+            sums.push_back(GfVec3f(0));
+            counts.push_back(0);
+        }
+        int index = inserted.first->second;
+        sums[index] += points[i];
+        counts[index]++;
+        remap[i] = index;
+    }
+
+    simplified.points.reserve(sums.size());
+    for (size_t i = 0; i < sums.size(); i++)
+        simplified.points.push_back(sums[i] / counts[i]);
+
+    // the faces are triangulated as fans, the triangles collapsed in a cell
+    // or an edge are dropped
+    size_t offset = 0;
+    for (int count : faceVertexCounts) {
+        if (offset + count > faceVertexIndices.size()) break;
+        for (int j = 1; j + 1 < count; j++) {
+            int corners[3] = {faceVertexIndices[offset],
+                              faceVertexIndices[offset + j],
+                              faceVertexIndices[offset + j + 1]};
+            bool isValid = true;
+            for (int &corner : corners) {
+                if (corner < 0 || size_t(corner) >= remap.size())
+                    isValid = false;
+                else corner = remap[corner];
+            }
+            if (!isValid || corners[0] == corners[1] ||
+                corners[1] == corners[2] || corners[0] == corners[2])
+                continue;
+
+            simplified.faceVertexCounts.push_back(3);
+            for (int corner : corners)
+                simplified.faceVertexIndices.push_back(corner);
+        }
+        offset += count;
+    }
+
+    simplified.memoryUsage =
+        sizeof(_Simplified) +
+        simplified.faceVertexCounts.size() * sizeof(int) +
+        simplified.faceVertexIndices.size() * sizeof(int) +
+        simplified.points.size() * sizeof(GfVec3f);
+    return simplified;
+}
+
+PXR_NAMESPACE_CLOSE_SCOPE
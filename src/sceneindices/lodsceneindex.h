@@ -0,0 +1,323 @@
+/**
+ * @file lodsceneindex.h
+ * @author Raphael Jouretz (rjouretz.com)
+ * @brief Hydra Filter Scene Index that swaps the meshes small on screen with
+ * simplified versions computed in the background.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <pxr/base/gf/frustum.h>
+#include <pxr/base/gf/range3d.h>
+#include <pxr/base/vt/array.h>
+#include <pxr/base/work/dispatcher.h>
+#include <pxr/imaging/hd/filteringSceneIndex.h>
+#include <pxr/imaging/hd/sceneIndex.h>
+#include <pxr/pxr.h>
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+class LodSceneIndex;
+
+TF_DECLARE_REF_PTRS(LodSceneIndex);
+
+/**
+ * @class LodSceneIndex
+ * @brief Hydra Filter Scene Index that swaps the meshes small on screen with
+ * simplified versions computed in the background.
+ *
+ * The simplified meshes are computed by vertex clustering on worker threads
+ * and cached by the hash of their topology and points, so that identical
+ * meshes share a single simplification. The least recently used entries are
+ * evicted beyond the memory budget of the cache. The simplified topology
+ * only keeps the points and the constant primvars of the mesh. The meshes
+ * whose points change without their topology are deforming, they keep their
+ * full detail rather than being hashed and simplified again every frame. The
+ * level of detail depends on a single camera, it is meant to be rendered by
+ * a single engine.
+ */
+class LodSceneIndex : public HdSingleInputFilteringSceneIndexBase {
+    public:
+        /**
+         * @brief Create a ref pointer to a LOD scene index
+         *
+         * @return LodSceneIndexRefPtr the ref pointer to a LOD scene index
+         */
+        static LodSceneIndexRefPtr New(
+            const HdSceneIndexBaseRefPtr &inputSceneIndex)
+        {
+            return TfCreateRefPtr(new LodSceneIndex(inputSceneIndex));
+        }
+
+        /**
+         * @brief Construct a new LOD Scene Index object
+         *
+         * @param inputSceneIndex the scene index to simplify the meshes from
+         */
+        LodSceneIndex(const HdSceneIndexBaseRefPtr &inputSceneIndex);
+
+        /**
+         * @brief Destroy the LOD Scene Index object, waits for the running
+         * simplifications
+         *
+         */
+        ~LodSceneIndex();
+
+        /**
+         * @brief Enable or disable the simplification
+         *
+         * @param isEnabled true to simplify the small meshes, false to show
+         * them all in full detail
+         */
+        void SetEnabled(bool isEnabled);
+
+        /**
+         * @brief Get whether the simplification is enabled
+         *
+         * @return true if the simplification is enabled, false otherwise
+         */
+        bool IsEnabled() const;
+
+        /**
+         * @brief Set the frustum of the camera to measure the meshes against
+         *
+         * @param frustum the frustum of the camera
+         */
+        void SetFrustum(const GfFrustum &frustum);
+
+        /**
+         * @brief Set the size on screen below which the meshes are simplified
+         *
+         * @param size the size as a fraction of the screen height
+         */
+        void SetScreenSizeThreshold(double size);
+
+        /**
+         * @brief Get the size on screen below which the meshes are simplified
+         *
+         * @return double the size as a fraction of the screen height
+         */
+        double GetScreenSizeThreshold() const;
+
+        /**
+         * @brief Set the memory budget of the cache of simplified meshes
+         *
+         * @param bytes the budget in bytes
+         */
+        void SetCacheBudget(size_t bytes);
+
+        /**
+         * @brief Get the memory budget of the cache of simplified meshes
+         *
+         * @return size_t the budget in bytes
+         */
+        size_t GetCacheBudget() const;
+
+        /**
+         * @brief Copy the settings, the frustum and the cached
+         * simplifications of another LOD scene index, used when the filter
+         * is created again on top of a new input. The simplifications are
+         * shared arrays, they are not copied.
+         *
+         * @param other the LOD scene index to copy the settings from
+         */
+        void CopySettings(const LodSceneIndexRefPtr &other);
+
+        /**
+         * @brief Get the memory used by the cache of simplified meshes
+         *
+         * @return size_t the memory used in bytes
+         */
+        size_t GetCacheMemoryUsage() const;
+
+        /**
+         * @brief Get the number of times a simplified mesh was found in the
+         * cache
+         *
+         * @return size_t the number of cache hits
+         */
+        size_t GetHitCount() const;
+
+        /**
+         * @brief Get the number of times a simplified mesh had to be computed
+         *
+         * @return size_t the number of cache misses
+         */
+        size_t GetMissCount() const;
+
+        /**
+         * @brief Get the number of meshes currently simplified
+         *
+         * @return size_t the number of simplified meshes
+         */
+        size_t GetSimplifiedCount() const;
+
+        /**
+         * @brief Get the number of simplifications running in the background
+         *
+         * @return size_t the number of pending simplifications
+         */
+        size_t GetPendingCount() const;
+
+        /**
+         * @brief Pick up the simplifications completed in the background and
+         * swap the meshes whose level of detail changed. Must be called on
+         * the main thread, once per frame.
+         *
+         */
+        void Update();
+
+        /**
+         * @brief Override of
+         * HdSingleInputFilteringSceneIndexBase::GetPrim
+         */
+        virtual HdSceneIndexPrim GetPrim(
+            const SdfPath &primPath) const override;
+
+        /**
+         * @brief Override of
+         * HdSingleInputFilteringSceneIndexBase::GetChildPrimPaths
+         */
+        virtual SdfPathVector GetChildPrimPaths(
+            const SdfPath &primPath) const override;
+
+    protected:
+        /**
+         * @brief Override of
+         * HdSingleInputFilteringSceneIndexBase::_PrimsAdded
+         */
+        virtual void _PrimsAdded(
+            const HdSceneIndexBase &sender,
+            const HdSceneIndexObserver::AddedPrimEntries &entries)
+            override;
+
+        /**
+         * @brief Override of
+         * HdSingleInputFilteringSceneIndexBase::_PrimsRemoved
+         */
+        virtual void _PrimsRemoved(
+            const HdSceneIndexBase &sender,
+            const HdSceneIndexObserver::RemovedPrimEntries &entries)
+            override;
+
+        /**
+         * @brief Override of
+         * HdSingleInputFilteringSceneIndexBase::_PrimsDirtied
+         */
+        virtual void _PrimsDirtied(
+            const HdSceneIndexBase &sender,
+            const HdSceneIndexObserver::DirtiedPrimEntries &entries)
+            override;
+
+    private:
+        const size_t _MIN_POINT_COUNT = 1000;
+        const int _CLUSTER_RESOLUTION = 24;
+        const double _RESTORE_RATIO = 1.25;
+
+        struct _Mesh {
+            GfRange3d bound;
+            size_t key;
+            bool isKeyValid, isSmall, isDeforming;
+        };
+
+        struct _Simplified {
+            VtIntArray faceVertexCounts, faceVertexIndices;
+            VtVec3fArray points;
+            size_t memoryUsage;
+        };
+
+        using _Cache = std::unordered_map<
+            size_t, std::pair<_Simplified, std::list<size_t>::iterator>>;
+
+        bool _isEnabled, _isDirty;
+        GfFrustum _frustum;
+        double _screenSizeThreshold;
+
+        std::map<SdfPath, _Mesh> _meshes;
+        std::map<SdfPath, size_t> _simplifiedPaths;
+
+        _Cache _cache;
+        std::list<size_t> _lruKeys;
+        size_t _cacheBudget, _cacheMemoryUsage;
+        size_t _hitCount, _missCount;
+
+        WorkDispatcher _dispatcher;
+        std::unordered_set<size_t> _pendingKeys;
+        std::mutex _completedMutex;
+        std::vector<std::pair<size_t, _Simplified>> _completed;
+
+        /**
+         * @brief Collect the meshes of the input scene index
+         *
+         */
+        void _Populate();
+
+        /**
+         * @brief Add or update the tracked bounds of the given prims if they
+         * are meshes worth simplifying
+         *
+         * @param primPaths the paths of the prims
+         * @param isTopologyChanged true if the topology of the prims might
+         * have changed, false if only their points or xform changed, in
+         * which case the key of a tracked mesh is kept
+         */
+        void _UpdateMeshes(const SdfPathVector &primPaths,
+                           bool isTopologyChanged);
+
+        /**
+         * @brief Compute the cache key of a mesh from its topology and points
+         *
+         * @param primPath the path of the mesh
+         * @param key the resulting key
+         * @return true if the mesh has a topology and points, false otherwise
+         */
+        bool _ComputeKey(const SdfPath &primPath, size_t *key) const;
+
+        /**
+         * @brief Start the simplification of a mesh in the background
+         *
+         * @param primPath the path of the mesh
+         * @param key the cache key of the mesh
+         */
+        void _Simplify(const SdfPath &primPath, size_t key);
+
+        /**
+         * @brief Decide the level of detail of every mesh and dirty the
+         * meshes whose level of detail changed
+         *
+         */
+        void _Evaluate();
+
+        /**
+         * @brief Evict the least recently used simplifications no mesh
+         * displays until the cache fits its budget
+         *
+         */
+        void _EvictCache();
+
+        /**
+         * @brief Simplify a mesh by clustering its points on a regular grid
+         * and keeping the triangles whose corners fall in different cells
+         *
+         * @param faceVertexCounts the vertex counts of the faces
+         * @param faceVertexIndices the vertex indices of the faces
+         * @param points the points of the mesh
+         * @param resolution the number of cells along the longest axis
+         * @return _Simplified the simplified mesh
+         */
+        static _Simplified _ClusterVertices(
+            const VtIntArray &faceVertexCounts,
+            const VtIntArray &faceVertexIndices, const VtVec3fArray &points,
+            int resolution);
+};
+
+PXR_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,269 @@
+#include "sampledvaluecachesceneindex.h"
+
+#include <pxr/base/gf/matrix4d.h>
+#include <pxr/base/gf/vec2f.h>
+#include <pxr/base/gf/vec3f.h>
+#include <pxr/base/vt/array.h>
+#include <pxr/base/vt/value.h>
+#include <pxr/imaging/hd/retainedDataSource.h>
+
+#include <typeinfo>
+#include <vector>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+namespace {
+
+/**
+ * @brief Container data source that serves the sampled values of a prim
+ * from the cache of a SampledValueCacheSceneIndex
+ *
+ */
+class _CachingContainerDataSource : public HdContainerDataSource {
+    public:
+        HD_DECLARE_DATASOURCE(_CachingContainerDataSource);
+
+        TfTokenVector GetNames() override { return _input->GetNames(); }
+
+        HdDataSourceBaseHandle Get(const TfToken &name) override
+        {
+            HdDataSourceBaseHandle dataSource = _input->Get(name);
+            if (!dataSource || !_owner) return dataSource;
+
+            HdDataSourceLocator locator = _locator.Append(name);
+
+            if (auto container = HdContainerDataSource::Cast(dataSource)) {
+                return _CachingContainerDataSource::New(_owner, _primPath,
+                                                        locator, container);
+            }
+            if (auto sampled = HdSampledDataSource::Cast(dataSource)) {
+                return _owner->GetCachedValue(_primPath, locator, sampled);
+            }
+            return dataSource;
+        }
+
+    private:
+        _CachingContainerDataSource(
+            const SampledValueCacheSceneIndexPtr &owner,
+            const SdfPath &primPath, const HdDataSourceLocator &locator,
+            const HdContainerDataSourceHandle &input)
+            : _owner(owner),
+              _primPath(primPath),
+              _locator(locator),
+              _input(input)
+        {
+        }
+
+        SampledValueCacheSceneIndexPtr _owner;
+        SdfPath _primPath;
+        HdDataSourceLocator _locator;
+        HdContainerDataSourceHandle _input;
+};
+
+template <typename T>
+bool _AddArrayMemoryUsage(const VtValue &value, size_t *memoryUsage)
+{
+    if (!value.IsHolding<VtArray<T>>()) return false;
+    *memoryUsage += value.UncheckedGet<VtArray<T>>().size() * sizeof(T);
+    return true;
+}
+
+}  // namespace
+
+SampledValueCacheSceneIndex::SampledValueCacheSceneIndex(
+    const HdSceneIndexBaseRefPtr &inputSceneIndex)
+    : HdSingleInputFilteringSceneIndexBase(inputSceneIndex),
+      _entryCount(0),
+      _memoryUsage(0),
+      _generation(0),
+      _hitCount(0),
+      _missCount(0)
+{
+    SetDisplayName("SampledValueCacheSceneIndex");
+}
+
+void SampledValueCacheSceneIndex::Flush()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _cache.clear();
+    _generation++;
+    _entryCount = 0;
+    _memoryUsage = 0;
+}
+
+size_t SampledValueCacheSceneIndex::GetEntryCount() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _entryCount;
+}
+
+size_t SampledValueCacheSceneIndex::GetMemoryUsage() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _memoryUsage;
+}
+
+size_t SampledValueCacheSceneIndex::GetHitCount() const
+{
+    return _hitCount;
+}
+
+size_t SampledValueCacheSceneIndex::GetMissCount() const
+{
+    return _missCount;
+}
+
+HdDataSourceBaseHandle SampledValueCacheSceneIndex::GetCachedValue(
+    const SdfPath &primPath, const HdDataSourceLocator &locator,
+    const HdSampledDataSourceHandle &dataSource) const
+{
+    // the static values are read once by the consumers, they are served by
+    // the input
+    std::vector<HdSampledDataSource::Time> sampleTimes;
+    if (!dataSource->GetContributingSampleTimesForInterval(0, 0, &sampleTimes))
+        return dataSource;
+
+    size_t generation;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto primIt = _cache.find(primPath);
+        if (primIt != _cache.end()) {
+            auto it = primIt->second.find(locator);
+            if (it != primIt->second.end()) {
+                _hitCount++;
+                return it->second.dataSource;
+            }
+        }
+        generation = _generation;
+    }
+
+    // resolve outside of the lock, Hydra syncs prims in parallel
+    _missCount++;
+    VtValue value = dataSource->GetValue(0);
+
+    // schemas cast to typed data sources, values of types without a typed
+    // retained data source are not cached
+    HdSampledDataSourceHandle cached = HdCreateTypedRetainedDataSource(value);
+    if (!cached || typeid(*cached) == typeid(HdRetainedSampledDataSource))
+        return dataSource;
+
+    // a flush since the resolution may have made the value stale, it is
+    // returned without being cached
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_generation != generation) return cached;
+
+    _LocatorEntries &entries = _cache[primPath];
+    auto inserted =
+        entries.insert({locator, {cached, _EstimateMemoryUsage(value)}});
+    if (inserted.second) {
+        _entryCount++;
+        _memoryUsage += inserted.first->second.memoryUsage;
+    }
+    return inserted.first->second.dataSource;
+}
+
+HdSceneIndexPrim SampledValueCacheSceneIndex::GetPrim(
+    const SdfPath &primPath) const
+{
+    HdSceneIndexPrim prim = _GetInputSceneIndex()->GetPrim(primPath);
+    if (!prim.dataSource) return prim;
+
+    SampledValueCacheSceneIndexPtr self(
+        const_cast<SampledValueCacheSceneIndex *>(this));
+    prim.dataSource = _CachingContainerDataSource::New(
+        self, primPath, HdDataSourceLocator(), prim.dataSource);
+    return prim;
+}
+
+SdfPathVector SampledValueCacheSceneIndex::GetChildPrimPaths(
+    const SdfPath &primPath) const
+{
+    return _GetInputSceneIndex()->GetChildPrimPaths(primPath);
+}
+
+void SampledValueCacheSceneIndex::_PrimsAdded(
+    const HdSceneIndexBase &sender,
+    const HdSceneIndexObserver::AddedPrimEntries &entries)
+{
+    {
+        // added prims are resynced, their values may all be different
+        std::lock_guard<std::mutex> lock(_mutex);
+        HdDataSourceLocatorSet all{HdDataSourceLocator()};
+        _generation++;
+        for (auto &&entry : entries) {
+            auto primIt = _cache.find(entry.primPath);
+            if (primIt != _cache.end()) _FlushPrim(primIt, all);
+        }
+    }
+    _SendPrimsAdded(entries);
+}
+
+void SampledValueCacheSceneIndex::_PrimsRemoved(
+    const HdSceneIndexBase &sender,
+    const HdSceneIndexObserver::RemovedPrimEntries &entries)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        HdDataSourceLocatorSet all{HdDataSourceLocator()};
+        _generation++;
+
+        // removing a prim removes its whole subtree
+        for (auto &&entry : entries) {
+            auto it = _cache.lower_bound(entry.primPath);
+            while (it != _cache.end() && it->first.HasPrefix(entry.primPath))
+                it = _FlushPrim(it, all);
+        }
+    }
+    _SendPrimsRemoved(entries);
+}
+
+void SampledValueCacheSceneIndex::_PrimsDirtied(
+    const HdSceneIndexBase &sender,
+    const HdSceneIndexObserver::DirtiedPrimEntries &entries)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _generation++;
+        for (auto &&entry : entries) {
+            auto primIt = _cache.find(entry.primPath);
+            if (primIt != _cache.end())
+                _FlushPrim(primIt, entry.dirtyLocators);
+        }
+    }
+    _SendPrimsDirtied(entries);
+}
+
+std::map<SdfPath, SampledValueCacheSceneIndex::_LocatorEntries>::iterator
+SampledValueCacheSceneIndex::_FlushPrim(
+    std::map<SdfPath, _LocatorEntries>::iterator primIt,
+    const HdDataSourceLocatorSet &locators)
+{
+    _LocatorEntries &primEntries = primIt->second;
+    for (auto it = primEntries.begin(); it != primEntries.end();) {
+        if (locators.Intersects(it->first)) {
+            _entryCount--;
+            _memoryUsage -= it->second.memoryUsage;
+            it = primEntries.erase(it);
+        }
+        else ++it;
+    }
+
+    if (primEntries.empty()) return _cache.erase(primIt);
+    return ++primIt;
+}
+
+size_t SampledValueCacheSceneIndex::_EstimateMemoryUsage(const VtValue &value)
+{
+    size_t memoryUsage = sizeof(VtValue) + sizeof(_Entry);
+
+    // only the array types that dominate geometry are accounted for
+    _AddArrayMemoryUsage<GfVec3f>(value, &memoryUsage) ||
+        _AddArrayMemoryUsage<GfVec2f>(value, &memoryUsage) ||
+        _AddArrayMemoryUsage<float>(value, &memoryUsage) ||
+        _AddArrayMemoryUsage<int>(value, &memoryUsage) ||
+        _AddArrayMemoryUsage<GfMatrix4d>(value, &memoryUsage);
+
+    return memoryUsage;
+}
+
+PXR_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,191 @@
+/**
+ * @file sampledvaluecachesceneindex.h
+ * @author Raphael Jouretz (rjouretz.com)
+ * @brief Hydra Filter Scene Index that memoizes the sampled values of Hydra
+ * Prims until they are dirtied.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <pxr/imaging/hd/dataSourceLocator.h>
+#include <pxr/imaging/hd/filteringSceneIndex.h>
+#include <pxr/imaging/hd/sceneIndex.h>
+#include <pxr/pxr.h>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+class SampledValueCacheSceneIndex;
+
+TF_DECLARE_REF_PTRS(SampledValueCacheSceneIndex);
+TF_DECLARE_WEAK_PTRS(SampledValueCacheSceneIndex);
+
+/**
+ * @class SampledValueCacheSceneIndex
+ * @brief Hydra Filter Scene Index that memoizes the sampled values of Hydra
+ * Prims until they are dirtied.
+ *
+ * Values are cached per prim and per data source locator for the current
+ * time of the input scene index (shutter offset 0), for the time varying
+ * values only, the others are served by the input. Entries are flushed by
+ * the PrimsDirtied notices of the input, which the stage scene index sends
+ * for every time varying prim when the time changes. The scene indices and
+ * views downstream then share a single resolution of each value per frame.
+ *
+ * Cached values are retained data sources: the samples at other shutter
+ * offsets (motion blur) are not forwarded.
+ */
+class SampledValueCacheSceneIndex
+    : public HdSingleInputFilteringSceneIndexBase {
+    public:
+        /**
+         * @brief Create a ref pointer to a sampled value cache scene index
+         *
+         * @return SampledValueCacheSceneIndexRefPtr the ref pointer to a
+         * sampled value cache scene index
+         */
+        static SampledValueCacheSceneIndexRefPtr New(
+            const HdSceneIndexBaseRefPtr &inputSceneIndex)
+        {
+            return TfCreateRefPtr(
+                new SampledValueCacheSceneIndex(inputSceneIndex));
+        }
+
+        /**
+         * @brief Construct a new Sampled Value Cache Scene Index object
+         *
+         * @param inputSceneIndex the scene index to cache the values from
+         */
+        SampledValueCacheSceneIndex(
+            const HdSceneIndexBaseRefPtr &inputSceneIndex);
+
+        /**
+         * @brief Remove all the cached values
+         *
+         */
+        void Flush();
+
+        /**
+         * @brief Get the number of cached values
+         *
+         * @return size_t the number of cached values
+         */
+        size_t GetEntryCount() const;
+
+        /**
+         * @brief Get an estimation of the memory used by the cached values
+         *
+         * @return size_t the memory used in bytes
+         */
+        size_t GetMemoryUsage() const;
+
+        /**
+         * @brief Get the number of values served from the cache
+         *
+         * @return size_t the number of cache hits
+         */
+        size_t GetHitCount() const;
+
+        /**
+         * @brief Get the number of values resolved from the input scene
+         * index
+         *
+         * @return size_t the number of cache misses
+         */
+        size_t GetMissCount() const;
+
+        /**
+         * @brief Get the cached data source of a sampled value, resolve and
+         * cache it if missing. A value that does not vary over time is not
+         * cached, its data source is returned.
+         *
+         * @param primPath the path of the prim holding the value
+         * @param locator the locator of the value within the prim
+         * @param dataSource the data source of the value in the input
+         * @return HdDataSourceBaseHandle the cached data source
+         */
+        HdDataSourceBaseHandle GetCachedValue(
+            const SdfPath &primPath, const HdDataSourceLocator &locator,
+            const HdSampledDataSourceHandle &dataSource) const;
+
+        /**
+         * @brief Override of
+         * HdSingleInputFilteringSceneIndexBase::GetPrim
+         */
+        virtual HdSceneIndexPrim GetPrim(
+            const SdfPath &primPath) const override;
+
+        /**
+         * @brief Override of
+         * HdSingleInputFilteringSceneIndexBase::GetChildPrimPaths
+         */
+        virtual SdfPathVector GetChildPrimPaths(
+            const SdfPath &primPath) const override;
+
+    protected:
+        /**
+         * @brief Override of
+         * HdSingleInputFilteringSceneIndexBase::_PrimsAdded
+         */
+        virtual void _PrimsAdded(
+            const HdSceneIndexBase &sender,
+            const HdSceneIndexObserver::AddedPrimEntries &entries)
+            override;
+
+        /**
+         * @brief Override of
+         * HdSingleInputFilteringSceneIndexBase::_PrimsRemoved
+         */
+        virtual void _PrimsRemoved(
+            const HdSceneIndexBase &sender,
+            const HdSceneIndexObserver::RemovedPrimEntries &entries)
+            override;
+
+        /**
+         * @brief Override of
+         * HdSingleInputFilteringSceneIndexBase::_PrimsDirtied
+         */
+        virtual void _PrimsDirtied(
+            const HdSceneIndexBase &sender,
+            const HdSceneIndexObserver::DirtiedPrimEntries &entries)
+            override;
+
+    private:
+        struct _Entry {
+            HdDataSourceBaseHandle dataSource;
+            size_t memoryUsage;
+        };
+        using _LocatorEntries = std::map<HdDataSourceLocator, _Entry>;
+
+        mutable std::mutex _mutex;
+        mutable std::map<SdfPath, _LocatorEntries> _cache;
+        mutable size_t _entryCount, _memoryUsage, _generation;
+        mutable std::atomic<size_t> _hitCount, _missCount;
+
+        /**
+         * @brief Remove the cached values of the given prim that intersect
+         * the given locators. The mutex must be locked.
+         *
+         * @param primIt the cached values of the prim to flush
+         * @param locators the locators to flush
+         * @return the iterator following the prim
+         */
+        std::map<SdfPath, _LocatorEntries>::iterator _FlushPrim(
+            std::map<SdfPath, _LocatorEntries>::iterator primIt,
+            const HdDataSourceLocatorSet &locators);
+
+        /**
+         * @brief Estimate the memory used by a value
+         *
+         * @param value the value
+         * @return size_t the memory used in bytes
+         */
+        static size_t _EstimateMemoryUsage(const VtValue &value);
+};
+
+PXR_NAMESPACE_CLOSE_SCOPE
@@ -3,6 +3,7 @@
 #include <pxr/base/vt/value.h>
 #include <pxr/imaging/hd/overlayContainerDataSource.h>
 #include <pxr/imaging/hd/retainedDataSource.h>
+#include <pxr/imaging/hd/sceneIndexPrimView.h>
 #include <pxr/imaging/hd/tokens.h>
 #include <pxr/imaging/hd/xformSchema.h>
 
@@ -17,31 +18,51 @@ XformFilterSceneIndex::XformFilterSceneIndex(
 
 GfMatrix4d XformFilterSceneIndex::GetXform(const SdfPath &primPath) const
 {
-    const VtValue *value = _xformDict.GetValueAtPath(primPath.GetAsString());
-    if (value && !value->IsEmpty()) return value->Get<GfMatrix4d>();
+    auto it = _xforms.find(primPath);
+    if (it != _xforms.end()) return it->second;
 
-    HdSceneIndexPrim prim = _GetInputSceneIndex()->GetPrim(primPath);
-
-    HdXformSchema xformSchema = HdXformSchema::GetFromParent(prim.dataSource);
-    if (!xformSchema.IsDefined()) return GfMatrix4d(1);
+    GfMatrix4d xform = _GetInputXform(primPath);
+    if (_xforms.empty()) return xform;
 
-    HdSampledDataSource::Time time(0);
-    GfMatrix4d xform =
-        xformSchema.GetMatrix()->GetValue(time).Get<GfMatrix4d>();
+    // the prim keeps its transform relative to the nearest overwritten
+    // ancestor
+    for (SdfPath path = primPath.GetParentPath(); !path.IsEmpty();
+         path = path.GetParentPath()) {
+        auto ancestor = _xforms.find(path);
+        if (ancestor == _xforms.end()) continue;
 
+        return xform * _GetInputXform(path).GetInverse() * ancestor->second;
+    }
     return xform;
 }
 
 void XformFilterSceneIndex::SetXform(const SdfPath &primPath, GfMatrix4d xform)
 {
-    _xformDict.SetValueAtPath(primPath.GetAsString(), VtValue(xform));
+    // the overwritten descendants follow the prim as well
+    GfMatrix4d delta = GetXform(primPath).GetInverse() * xform;
+    for (auto &&it : _xforms) {
+        if (it.first != primPath && it.first.HasPrefix(primPath))
+            it.second = it.second * delta;
+    }
+    _xforms[primPath] = xform;
 
     HdSceneIndexObserver::DirtiedPrimEntries entries;
-    entries.push_back({primPath, HdXformSchema::GetDefaultLocator()});
+    for (const SdfPath &path :
+         HdSceneIndexPrimView(_GetInputSceneIndex(), primPath))
+        entries.push_back({path, HdXformSchema::GetDefaultLocator()});
 
     _SendPrimsDirtied(entries);
 }
 
+size_t XformFilterSceneIndex::GetMemoryUsage() const
+{
+    // each node of the map holds its link and its pair, the buckets hold a
+    // pointer each
+    using Node = std::pair<SdfPath, GfMatrix4d>;
+    return sizeof(_xforms) + _xforms.bucket_count() * sizeof(void *) +
+           _xforms.size() * (sizeof(void *) + sizeof(Node));
+}
+
 HdSceneIndexPrim XformFilterSceneIndex::GetPrim(const SdfPath &primPath) const
 {
     HdSceneIndexPrim prim = _GetInputSceneIndex()->GetPrim(primPath);
@@ -62,6 +83,21 @@ HdSceneIndexPrim XformFilterSceneIndex::GetPrim(const SdfPath &primPath) const
     return prim;
 }
 
+GfMatrix4d XformFilterSceneIndex::_GetInputXform(
+    const SdfPath &primPath) const
+{
+    HdSceneIndexPrim prim = _GetInputSceneIndex()->GetPrim(primPath);
+
+    HdXformSchema xformSchema = HdXformSchema::GetFromParent(prim.dataSource);
+    if (!xformSchema.IsDefined()) return GfMatrix4d(1);
+
+    HdSampledDataSource::Time time(0);
+    GfMatrix4d xform =
+        xformSchema.GetMatrix()->GetValue(time).Get<GfMatrix4d>();
+
+    return xform;
+}
+
 SdfPathVector XformFilterSceneIndex::GetChildPrimPaths(
     const SdfPath &primPath) const
 {
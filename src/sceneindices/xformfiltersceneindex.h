@@ -9,11 +9,12 @@
 #pragma once
 
 #include <pxr/base/gf/matrix4d.h>
-#include <pxr/base/vt/dictionary.h>
 #include <pxr/imaging/hd/filteringSceneIndex.h>
 #include <pxr/imaging/hd/sceneIndex.h>
 #include <pxr/pxr.h>
 
+#include <unordered_map>
+
 PXR_NAMESPACE_OPEN_SCOPE
 
 class XformFilterSceneIndex;
@@ -24,6 +25,9 @@ TF_DECLARE_REF_PTRS(XformFilterSceneIndex);
  * @class XformFilterSceneIndex
  * @brief Hydra Filter Scene Index that overwrites xform of Hydra Prims.
  *
+ * The input xforms are flattened by the usd imaging scene indices, so the
+ * overwritten xforms are world space too. The descendants of an overwritten
+ * prim keep their transform relative to it and move along with it.
  */
 class XformFilterSceneIndex : public HdSingleInputFilteringSceneIndexBase {
     public:
@@ -49,7 +53,7 @@ class XformFilterSceneIndex : public HdSingleInputFilteringSceneIndexBase {
             const HdSceneIndexBaseRefPtr &inputSceneIndex);
 
         /**
-         * @brief Get the Xform of a hydra prim at the given path
+         * @brief Get the world space Xform of a hydra prim at the given path
          *
          * @param primPath the path of the prim to get the xform from
          * @return GfMatrix4d the xform of the prim
@@ -57,13 +61,22 @@ class XformFilterSceneIndex : public HdSingleInputFilteringSceneIndexBase {
         GfMatrix4d GetXform(const SdfPath &primPath) const;
 
         /**
-         * @brief Set the Xform of a hydra prim at the given path
+         * @brief Set the world space Xform of a hydra prim at the given path,
+         * its descendants are dirtied and move along with it
          *
          * @param primPath the path to the prim to set the xform
          * @param xform the new xform to set
          */
         void SetXform(const SdfPath &primPath, GfMatrix4d xform);
 
+        /**
+         * @brief Get an estimation of the memory used by the overwritten
+         * xforms
+         *
+         * @return size_t the memory used in bytes
+         */
+        size_t GetMemoryUsage() const;
+
         /**
          * @brief Override of
          * HdSingleInputFilteringSceneIndexBase::GetPrim
@@ -107,7 +120,15 @@ class XformFilterSceneIndex : public HdSingleInputFilteringSceneIndexBase {
             override;
 
     private:
-        VtDictionary _xformDict;
+        std::unordered_map<SdfPath, GfMatrix4d, SdfPath::Hash> _xforms;
+
+        /**
+         * @brief Get the Xform of a hydra prim from the input scene index
+         *
+         * @param primPath the path of the prim
+         * @return GfMatrix4d the input xform, identity if it has none
+         */
+        GfMatrix4d _GetInputXform(const SdfPath &primPath) const;
 };
 
 PXR_NAMESPACE_CLOSE_SCOPE
\ No newline at end of file
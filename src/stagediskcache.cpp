@@ -0,0 +1,268 @@
+#include "stagediskcache.h"
+
+#include <pxr/base/tf/diagnostic.h>
+#include <pxr/base/tf/hash.h>
+#include <pxr/base/tf/pathUtils.h>
+#include <pxr/base/tf/stringUtils.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+void StageDiskCache::Enable(const string& directory, size_t maxBytes)
+{
+    error_code error;
+    filesystem::create_directories(directory, error);
+    if (error) {
+        TF_WARN("Cannot create the stage cache directory %s.",
+                directory.c_str());
+        return;
+    }
+
+    _directory = directory;
+    _maxBytes = maxBytes;
+}
+
+bool StageDiskCache::IsEnabled()
+{
+    return !_directory.empty();
+}
+
+UsdStageRefPtr StageDiskCache::Open(const string& filePath)
+{
+    if (!IsEnabled()) return UsdStage::Open(filePath);
+
+    string cachePath = _GetCachePath(filePath);
+    string stagePath = cachePath + ".usdc";
+    string manifestPath = cachePath + ".manifest";
+
+    // the cached file is renamed once complete, it is never read while
+    // being written
+    error_code error;
+    if (filesystem::exists(stagePath, error) &&
+        _IsManifestValid(manifestPath)) {
+        UsdStageRefPtr stage = UsdStage::Open(stagePath);
+        if (stage) {
+            _hitCount++;
+            filesystem::last_write_time(
+                stagePath, filesystem::file_time_type::clock::now(), error);
+            TF_STATUS("Stage cache hit for %s (%zu hits, %zu misses).",
+                      filePath.c_str(), _hitCount, _missCount);
+            return stage;
+        }
+    }
+
+    _missCount++;
+    TF_STATUS("Stage cache miss for %s (%zu hits, %zu misses).",
+              filePath.c_str(), _hitCount, _missCount);
+
+    UsdStageRefPtr stage = UsdStage::Open(filePath);
+    if (!stage) return stage;
+
+    // a single stage is cached at a time, the next opening of the others
+    // will miss again
+    if (!_exporter) _exporter = make_unique<StageExporter>();
+    if (_exporter->IsRunning()) return stage;
+
+    vector<string> layerPaths;
+    size_t layerBytes = 0;
+    for (auto&& layer : stage->GetUsedLayers()) {
+        if (layer->IsAnonymous()) continue;
+        layerPaths.push_back(layer->GetRealPath());
+        size_t bytes = filesystem::file_size(layerPaths.back(), error);
+        if (!error) layerBytes += bytes;
+    }
+
+    // a manifest with unknown layers never matches, such a stage would be
+    // written for nothing
+    string manifestText = _BuildManifest(layerPaths);
+    if (manifestText.find("\t?\n") != string::npos) return stage;
+
+    // the previous file is removed first, so that it never matches the new
+    // manifest
+    filesystem::remove(stagePath, error);
+    _Evict(layerBytes);
+
+    ofstream manifest(manifestPath, ios::binary);
+    manifest << manifestText;
+    manifest.close();
+
+    // the worker composes and flattens its own stage from the layers already
+    // opened, the stage just opened is not blocked meanwhile
+    if (manifest) _exporter->Start(stage, stagePath, true, true);
+
+    return stage;
+}
+
+bool StageDiskCache::IsCached(const UsdStageRefPtr& stage)
+{
+    if (!IsEnabled() || !stage) return false;
+
+    filesystem::path path = stage->GetRootLayer()->GetRealPath();
+    error_code error;
+    return filesystem::equivalent(path.parent_path(), _directory, error);
+}
+
+vector<string> StageDiskCache::GetSourceLayerPaths(const string& filePath)
+{
+    if (!IsEnabled()) return {};
+
+    vector<string> lines = _ReadManifest(_GetCachePath(filePath) +
+                                         ".manifest");
+    vector<string> layerPaths;
+    for (size_t i = 1; i < lines.size(); i++) {
+        if (!lines[i].empty())
+            layerPaths.push_back(lines[i].substr(0, lines[i].find('\t')));
+    }
+    return layerPaths;
+}
+
+void StageDiskCache::Invalidate(const string& filePath)
+{
+    if (!IsEnabled()) return;
+
+    string cachePath = _GetCachePath(filePath);
+    error_code error;
+    filesystem::remove(cachePath + ".usdc", error);
+    filesystem::remove(cachePath + ".manifest", error);
+}
+
+void StageDiskCache::Wait()
+{
+    if (_exporter) _exporter->Wait();
+}
+
+void StageDiskCache::Cancel()
+{
+    if (_exporter) _exporter->Cancel();
+}
+
+bool StageDiskCache::IsRunning()
+{
+    return _exporter && _exporter->IsRunning();
+}
+
+void StageDiskCache::Shutdown()
+{
+    Cancel();
+    Wait();
+    _exporter.reset();
+}
+
+size_t StageDiskCache::GetHitCount()
+{
+    return _hitCount;
+}
+
+size_t StageDiskCache::GetMissCount()
+{
+    return _missCount;
+}
+
+string StageDiskCache::_GetCachePath(const string& filePath)
+{
+    string absPath = TfAbsPath(filePath);
+    string name = TfGetBaseName(absPath) + "." +
+                  TfStringPrintf("%016zx", size_t(TfHash()(absPath)));
+    return (filesystem::path(_directory) / name).string();
+}
+
+string StageDiskCache::_BuildManifest(vector<string> layerPaths)
+{
+    sort(layerPaths.begin(), layerPaths.end());
+
+    // a layer that cannot be checked (e.g. inside a package) is written as
+    // unknown, which never matches
+    ostringstream manifest;
+    manifest << _MANIFEST_VERSION << "\n";
+    for (auto&& path : layerPaths) {
+        error_code timeError, sizeError;
+        auto time = filesystem::last_write_time(path, timeError);
+        auto size = filesystem::file_size(path, sizeError);
+
+        manifest << path << "\t";
+        if (timeError || sizeError) manifest << "?";
+        else manifest << time.time_since_epoch().count() << "\t" << size;
+        manifest << "\n";
+    }
+    return manifest.str();
+}
+
+vector<string> StageDiskCache::_ReadManifest(const string& manifestPath)
+{
+    ifstream file(manifestPath, ios::binary);
+    if (!file) return {};
+
+    ostringstream content;
+    content << file.rdbuf();
+
+    vector<string> lines = TfStringSplit(content.str(), "\n");
+    if (lines.empty() || lines[0] != _MANIFEST_VERSION) return {};
+    return lines;
+}
+
+bool StageDiskCache::_IsManifestValid(const string& manifestPath)
+{
+    vector<string> lines = _ReadManifest(manifestPath);
+    if (lines.empty()) return false;
+
+    vector<string> layerPaths;
+    for (size_t i = 1; i < lines.size(); i++) {
+        if (lines[i].empty()) continue;
+        if (TfStringEndsWith(lines[i], "\t?")) return false;
+        layerPaths.push_back(lines[i].substr(0, lines[i].find('\t')));
+    }
+    return _BuildManifest(layerPaths) == TfStringJoin(lines, "\n");
+}
+
+void StageDiskCache::_Evict(size_t extraBytes)
+{
+    struct CachedStage {
+        filesystem::path path;
+        filesystem::file_time_type time;
+        size_t bytes;
+    };
+
+    // the temporary files have no manifest, the ones left by an
+    // interrupted writing are removed unless a writing is running
+    bool isRunning = IsRunning();
+    vector<CachedStage> cachedStages;
+    size_t totalBytes = 0;
+    error_code error;
+    for (auto&& entry : filesystem::directory_iterator(_directory, error)) {
+        filesystem::path path = entry.path();
+        if (path.extension() != ".usdc") continue;
+        if (TfStringEndsWith(path.string(), ".usdc.tmp.usdc")) {
+            if (!isRunning) filesystem::remove(path, error);
+            continue;
+        }
+        if (!filesystem::exists(
+                filesystem::path(path).replace_extension(".manifest"), error))
+            continue;
+
+        CachedStage cachedStage{path, entry.last_write_time(error),
+                                size_t(entry.file_size(error))};
+        totalBytes += cachedStage.bytes;
+        cachedStages.push_back(cachedStage);
+    }
+
+    sort(cachedStages.begin(), cachedStages.end(),
+         [](const CachedStage& a, const CachedStage& b) {
+             return a.time < b.time;
+         });
+
+    for (auto&& cachedStage : cachedStages) {
+        if (totalBytes + extraBytes <= _maxBytes) break;
+
+        filesystem::remove(cachedStage.path, error);
+        filesystem::remove(
+            filesystem::path(cachedStage.path).replace_extension(".manifest"),
+            error);
+        totalBytes -= cachedStage.bytes;
+    }
+}
+
+PXR_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,191 @@
+/**
+ * @file stagediskcache.h
+ * @author Raphael Jouretz (rjouretz.com)
+ * @brief StageDiskCache keeps flattened copies of the opened stages in a
+ * local directory, so that an unchanged stage is reopened without composing
+ * its layers again.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <pxr/usd/usd/stage.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "stageexporter.h"
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+using namespace std;
+
+/**
+ * @brief StageDiskCache keeps flattened copies of the opened stages in a
+ * local directory, so that an unchanged stage is reopened without composing
+ * its layers again.
+ *
+ * The cache is disabled unless a directory is set. A stage is cached as a
+ * flattened usdc file named after the hash of the path of its root layer.
+ * Once the stage is opened, a worker composes it again from its layers,
+ * flattens it and writes it, next to a manifest listing the path,
+ * modification time and size of every layer used by the stage. A stage
+ * using a layer that cannot be checked on disk is not cached. The cached
+ * file is only used while the manifest still matches the layers on disk, and
+ * is read through the memory mapped crate reader of USD. The least recently
+ * used files are evicted beyond the maximum size, along with the temporary
+ * files left by an interrupted writing.
+ *
+ * A stage opened from the cache only uses its flattened file, the layers
+ * listed in its manifest are the ones to watch for changes, the entry being
+ * invalidated once one of them changes.
+ */
+class StageDiskCache {
+    public:
+        /**
+         * @brief Enable the cache
+         *
+         * @param directory the directory of the cached files, created if it
+         * does not exist
+         * @param maxBytes the maximum size of the cached files in bytes
+         */
+        static void Enable(const string& directory, size_t maxBytes);
+
+        /**
+         * @brief Check if the cache is enabled
+         *
+         * @return true if a directory is set
+         */
+        static bool IsEnabled();
+
+        /**
+         * @brief Open a stage from the cache if it is up to date, from the
+         * file otherwise, in which case it is cached in the background
+         *
+         * @param filePath the path of the root layer of the stage
+         * @return the opened stage, null if it cannot be opened
+         */
+        static UsdStageRefPtr Open(const string& filePath);
+
+        /**
+         * @brief Check if a stage was opened from the cache
+         *
+         * @param stage the stage to check
+         * @return true if the root layer of the stage is a cached file
+         */
+        static bool IsCached(const UsdStageRefPtr& stage);
+
+        /**
+         * @brief Get the layers a cached stage was flattened from, as listed
+         * in its manifest
+         *
+         * @param filePath the path of the root layer of the stage
+         * @return the real paths of the layers, empty if it is not cached
+         */
+        static vector<string> GetSourceLayerPaths(const string& filePath);
+
+        /**
+         * @brief Remove the cached files of a stage, so that its next opening
+         * composes its layers again
+         *
+         * @param filePath the path of the root layer of the stage
+         */
+        static void Invalidate(const string& filePath);
+
+        /**
+         * @brief Wait for the stage being cached to be written
+         *
+         */
+        static void Wait();
+
+        /**
+         * @brief Cancel the writing of the stage being cached, without
+         * waiting for it
+         *
+         */
+        static void Cancel();
+
+        /**
+         * @brief Check if a stage is being cached
+         *
+         * @return true if a cached file is being written
+         */
+        static bool IsRunning();
+
+        /**
+         * @brief Cancel the writing of the stage being cached and wait for
+         * it, to be called before exiting rather than from the destruction
+         * of the static members
+         *
+         */
+        static void Shutdown();
+
+        /**
+         * @brief Get the number of stages opened from the cache
+         *
+         * @return the number of hits
+         */
+        static size_t GetHitCount();
+
+        /**
+         * @brief Get the number of stages opened from their file
+         *
+         * @return the number of misses
+         */
+        static size_t GetMissCount();
+
+    private:
+        inline static const string _MANIFEST_VERSION = "1";
+
+        inline static string _directory;
+        inline static size_t _maxBytes = 0;
+        inline static size_t _hitCount = 0, _missCount = 0;
+        inline static unique_ptr<StageExporter> _exporter;
+
+        /**
+         * @brief Get the path of the cached files of a stage, without
+         * extension
+         *
+         * @param filePath the path of the root layer of the stage
+         * @return the path of the cached files
+         */
+        static string _GetCachePath(const string& filePath);
+
+        /**
+         * @brief Build the manifest of the layers used by a stage
+         *
+         * @param layerPaths the real paths of the layers
+         * @return the manifest, one line per layer
+         */
+        static string _BuildManifest(vector<string> layerPaths);
+
+        /**
+         * @brief Read the manifest of a cached stage
+         *
+         * @param manifestPath the path of the manifest
+         * @return the lines of the manifest, empty if it cannot be read or
+         * has another version
+         */
+        static vector<string> _ReadManifest(const string& manifestPath);
+
+        /**
+         * @brief Check if the manifest of a cached stage matches the layers
+         * on disk
+         *
+         * @param manifestPath the path of the manifest
+         * @return true if every layer is unchanged
+         */
+        static bool _IsManifestValid(const string& manifestPath);
+
+        /**
+         * @brief Remove the least recently used cached stages until the
+         * cache fits in its maximum size
+         *
+         * @param extraBytes the bytes to make room for
+         */
+        static void _Evict(size_t extraBytes);
+};
+
+PXR_NAMESPACE_CLOSE_SCOPE
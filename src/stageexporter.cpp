@@ -0,0 +1,185 @@
+#include "stageexporter.h"
+
+#include <pxr/base/tf/diagnostic.h>
+#include <pxr/base/tf/fileUtils.h>
+#include <pxr/base/tf/pathUtils.h>
+#include <pxr/usd/usdUtils/flattenLayerStack.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+StageExporter::StageExporter()
+    : _progress(0), _isCanceled(false), _estimatedBytes(0)
+{
+}
+
+StageExporter::~StageExporter()
+{
+    Cancel();
+    Wait();
+}
+
+bool StageExporter::Start(UsdStageRefPtr stage, const string& filePath,
+                          bool isBinary, bool isFlattened)
+{
+    if (!stage || IsRunning()) return false;
+
+    // the session layer is the only one edited meanwhile, it is copied
+    // while the caller owns it
+    SdfLayerRefPtr sessionLayer = SdfLayer::CreateAnonymous(".usda");
+    sessionLayer->TransferContent(stage->GetSessionLayer());
+
+    // the written file is expected about as big as the layers it flattens
+    size_t estimatedBytes = 0;
+    for (auto&& layer : stage->GetUsedLayers()) {
+        if (layer->IsAnonymous()) continue;
+        error_code error;
+        size_t bytes = filesystem::file_size(layer->GetRealPath(), error);
+        if (!error) estimatedBytes += bytes;
+    }
+    _estimatedBytes = estimatedBytes;
+
+    _isCanceled = false;
+    _SetStatus(0, "Composing");
+    _result = async(launch::async, &StageExporter::_Export, this,
+                    stage->GetRootLayer(), sessionLayer, stage->GetLoadRules(),
+                    filePath, isBinary, isFlattened);
+    return true;
+}
+
+void StageExporter::Cancel()
+{
+    _isCanceled = true;
+}
+
+void StageExporter::Wait()
+{
+    if (_result.valid()) _result.wait();
+}
+
+bool StageExporter::IsRunning()
+{
+    return _result.valid() &&
+           _result.wait_for(chrono::seconds(0)) != future_status::ready;
+}
+
+float StageExporter::GetProgress()
+{
+    lock_guard<mutex> lock(_statusMutex);
+    if (_writtenFilePath.empty() || _estimatedBytes == 0) return _progress;
+
+    // the writer streams to the temporary file, its size tells how far it is
+    error_code error;
+    size_t bytes = filesystem::file_size(_writtenFilePath, error);
+    if (error) return _progress;
+
+    float ratio = min(float(bytes) / float(_estimatedBytes), 1.f);
+    return _WRITE_PROGRESS + (1 - _WRITE_PROGRESS) * ratio;
+}
+
+string StageExporter::GetStatus()
+{
+    lock_guard<mutex> lock(_statusMutex);
+    return _status;
+}
+
+bool StageExporter::_Export(SdfLayerRefPtr rootLayer,
+                            SdfLayerRefPtr sessionLayer,
+                            UsdStageLoadRules loadRules, string filePath,
+                            bool isBinary, bool isFlattened)
+{
+    UsdStageRefPtr stage =
+        UsdStage::Open(rootLayer, sessionLayer, UsdStage::LoadNone);
+    if (stage) _LoadPayloads(stage, loadRules);
+
+    if (_isCanceled || !stage) {
+        _SetStatus(1, stage ? "Canceled" : "Failed");
+        return false;
+    }
+
+    // a single call to USD, it is not interrupted by a cancel
+    _SetStatus(_FLATTEN_PROGRESS, "Flattening");
+    SdfLayerRefPtr layer =
+        isFlattened ? stage->Flatten() : UsdUtilsFlattenLayerStack(stage);
+    stage = nullptr;
+
+    if (_isCanceled || !layer) {
+        _SetStatus(1, layer ? "Canceled" : "Failed");
+        return false;
+    }
+
+    _SetStatus(_WRITE_PROGRESS, "Writing");
+    return _Write(layer, filePath, isBinary);
+}
+
+bool StageExporter::_Write(SdfLayerRefPtr layer, string filePath,
+                           bool isBinary)
+{
+    // the layer is streamed to a temporary file of the same format, renamed
+    // once complete
+    string extension = TfGetExtension(filePath);
+    string tmpFilePath = filePath + ".tmp." + extension;
+
+    SdfLayer::FileFormatArguments args;
+    if (extension == "usd") args["format"] = isBinary ? "usdc" : "usda";
+
+    {
+        lock_guard<mutex> lock(_statusMutex);
+        _writtenFilePath = tmpFilePath;
+    }
+    bool isWritten = layer->Export(tmpFilePath, string(), args);
+    layer = nullptr;
+    {
+        lock_guard<mutex> lock(_statusMutex);
+        _writtenFilePath.clear();
+    }
+
+    error_code error;
+    if (!_isCanceled && isWritten)
+        filesystem::rename(tmpFilePath, filePath, error);
+
+    if (_isCanceled || !isWritten || error) {
+        if (TfIsFile(tmpFilePath)) TfDeleteFile(tmpFilePath);
+        if (!_isCanceled)
+            TF_WARN("The stage could not be exported to %s.",
+                    filePath.c_str());
+        _SetStatus(1, _isCanceled ? "Canceled" : "Failed");
+        return false;
+    }
+
+    _SetStatus(1, "Done");
+    return true;
+}
+
+void StageExporter::_LoadPayloads(UsdStageRefPtr stage,
+                                  const UsdStageLoadRules& loadRules)
+{
+    SdfPathVector loadPaths;
+    for (auto&& path : stage->FindLoadable()) {
+        if (loadRules.IsLoaded(path)) loadPaths.push_back(path);
+    }
+
+    size_t batchSize = max(loadPaths.size() / _LOAD_STEP_COUNT, size_t(1));
+    for (size_t i = 0; i < loadPaths.size() && !_isCanceled; i += batchSize) {
+        size_t end = min(i + batchSize, loadPaths.size());
+        stage->LoadAndUnload(SdfPathSet(loadPaths.begin() + i,
+                                        loadPaths.begin() + end),
+                             SdfPathSet(), UsdLoadWithoutDescendants);
+        _progress = _FLATTEN_PROGRESS * end / loadPaths.size();
+    }
+
+    // the nested payloads and the exact rules are applied at once
+    if (!_isCanceled) stage->SetLoadRules(loadRules);
+}
+
+void StageExporter::_SetStatus(float progress, const string& status)
+{
+    lock_guard<mutex> lock(_statusMutex);
+    _progress = progress;
+    _status = status;
+}
+
+PXR_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,164 @@
+/**
+ * @file stageexporter.h
+ * @author Raphael Jouretz (rjouretz.com)
+ * @brief StageExporter writes a snapshot of a UsdStage to a file on a worker
+ * thread, so that the editor stays usable while a big stage is exported.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include <pxr/usd/usd/stage.h>
+
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <string>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+using namespace std;
+
+/**
+ * @brief StageExporter writes a snapshot of a UsdStage to a file on a worker
+ * thread, so that the editor stays usable while a big stage is exported.
+ *
+ * The session layer is copied when the export starts, the other layers are
+ * only read by the worker since the editor only authors the session layer.
+ * The worker composes its own stage from them, flattens it and writes the
+ * result to a temporary file renamed once complete, so that a canceled or
+ * failed export never leaves a partial file behind.
+ *
+ * The progress of the composition follows the payloads loaded, the one of
+ * the writing follows the size of the temporary file against the size of
+ * the layers. The flattening is a single call to USD, it can neither be
+ * measured nor interrupted: a cancel during the flattening only takes effect
+ * once it returns.
+ */
+class StageExporter {
+    public:
+        /**
+         * @brief Construct a new StageExporter object
+         *
+         */
+        StageExporter();
+
+        /**
+         * @brief Destroy the StageExporter object, cancels the running export
+         * and waits for it
+         *
+         */
+        ~StageExporter();
+
+        /**
+         * @brief Start exporting a stage, unless an export is running
+         *
+         * @param stage the stage to export
+         * @param filePath the path of the file to write, its extension
+         * gives the file format
+         * @param isBinary true to write a .usd file in the usdc format rather
+         * than the usda one
+         * @param isFlattened true to flatten the whole stage, false to only
+         * flatten its layer stack, keeping the references and payloads
+         * @return true if the export started, false otherwise
+         */
+        bool Start(UsdStageRefPtr stage, const string& filePath, bool isBinary,
+                   bool isFlattened);
+
+        /**
+         * @brief Cancel the running export, the file is not written. The
+         * export stops at the next payload loaded or once the flattening or
+         * the writing returns, a running flattening cannot be interrupted.
+         *
+         */
+        void Cancel();
+
+        /**
+         * @brief Wait for the running export to end
+         *
+         */
+        void Wait();
+
+        /**
+         * @brief Check if an export is running
+         *
+         * @return true if an export is running
+         */
+        bool IsRunning();
+
+        /**
+         * @brief Get the progress of the last export, within its current
+         * step
+         *
+         * @return the progress, from 0 to 1
+         */
+        float GetProgress();
+
+        /**
+         * @brief Get the current step of the last export
+         *
+         * @return the name of the step
+         */
+        string GetStatus();
+
+    private:
+        inline static const float _FLATTEN_PROGRESS = .3f;
+        inline static const float _WRITE_PROGRESS = .6f;
+        inline static const size_t _LOAD_STEP_COUNT = 100;
+
+        atomic<float> _progress;
+        atomic<bool> _isCanceled;
+        mutex _statusMutex;
+        string _status;
+        string _writtenFilePath;
+        size_t _estimatedBytes;
+        future<bool> _result;
+
+        /**
+         * @brief Export a snapshot, called on the worker thread
+         *
+         * @param rootLayer the root layer of the stage
+         * @param sessionLayer the copy of the session layer of the stage
+         * @param loadRules the load rules of the stage
+         * @param filePath the path of the file to write
+         * @param isBinary true to write a .usd file in the usdc format
+         * @param isFlattened true to flatten the whole stage
+         * @return true if the file was written, false otherwise
+         */
+        bool _Export(SdfLayerRefPtr rootLayer, SdfLayerRefPtr sessionLayer,
+                     UsdStageLoadRules loadRules, string filePath,
+                     bool isBinary, bool isFlattened);
+
+        /**
+         * @brief Write a flattened layer to a temporary file renamed once
+         * complete, called on the worker thread
+         *
+         * @param layer the flattened layer
+         * @param filePath the path of the file to write
+         * @param isBinary true to write a .usd file in the usdc format
+         * @return true if the file was written, false otherwise
+         */
+        bool _Write(SdfLayerRefPtr layer, string filePath, bool isBinary);
+
+        /**
+         * @brief Load the payloads of a stage by batches, so that the
+         * progress of the composition advances and the export can be
+         * canceled meanwhile
+         *
+         * @param stage the stage opened without its payloads
+         * @param loadRules the load rules to apply
+         */
+        void _LoadPayloads(UsdStageRefPtr stage,
+                           const UsdStageLoadRules& loadRules);
+
+        /**
+         * @brief Set the progress and the current step of the export
+         *
+         * @param progress the progress, from 0 to 1
+         * @param status the name of the step
+         */
+        void _SetStatus(float progress, const string& status);
+};
+
+PXR_NAMESPACE_CLOSE_SCOPE
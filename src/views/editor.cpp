@@ -20,10 +20,7 @@ PXR_NAMESPACE_OPEN_SCOPE
 
 Editor::Editor(Model* model, const string label) : View(model, label)
 {
-    auto editableSceneIndex = GetModel()->GetEditableSceneIndex();
-    _colorFilterSceneIndex =
-        ColorFilterSceneIndex::New(editableSceneIndex);
-    GetModel()->SetEditableSceneIndex(_colorFilterSceneIndex);
+    _colorFilterSceneIndex = GetModel()->GetColorSceneIndex();
 }
 
 const string Editor::GetViewType()
@@ -67,8 +64,10 @@ void Editor::_AppendDisplayColorAttr(SdfPath primPath)
         ImGui::SliderFloat3("", data, 0, 1);
 
     // add opinion only if values change
-    if (color != prevColor)
+    if (color != prevColor) {
         _colorFilterSceneIndex->SetDisplayColor(primPath, color);
+        GetModel()->GetRecorder()->RecordDisplayColor(primPath, color);
+    }
 }
 
 PXR_NAMESPACE_CLOSE_SCOPE
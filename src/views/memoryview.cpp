@@ -0,0 +1,155 @@
+#include "memoryview.h"
+
+#include <ImGuiFileDialog.h>
+#include <pxr/usd/usd/stage.h>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+namespace {
+
+/**
+ * @brief Convert a number of bytes to megabytes
+ *
+ * @param bytes the number of bytes
+ * @return float the number of megabytes
+ */
+float _ToMegabytes(size_t bytes)
+{
+    return bytes / (1024.f * 1024.f);
+}
+
+}  // namespace
+
+MemoryView::MemoryView(Model* model, const string label)
+    : View(model, label),
+      _sampler(model),
+      _isSampling(true),
+      _lastSampleTime(-1)
+{
+}
+
+const string MemoryView::GetViewType()
+{
+    return VIEW_TYPE;
+};
+
+void MemoryView::_Draw()
+{
+    double time = ImGui::GetTime();
+    if (_isSampling && (_lastSampleTime < 0 ||
+                        time - _lastSampleTime >= _SAMPLING_PERIOD)) {
+        _sampler.Sample(time);
+        _lastSampleTime = time;
+    }
+
+    _DrawControls();
+    _DrawPlot();
+    _DrawTable();
+
+    if (ImGuiFileDialog::Instance()->Display("ExportMemoryFile")) {
+        if (ImGuiFileDialog::Instance()->IsOk()) {
+            string filePath = ImGuiFileDialog::Instance()->GetFilePathName();
+            _sampler.ExportCsv(filePath);
+        }
+        ImGuiFileDialog::Instance()->Close();
+    }
+}
+
+void MemoryView::_DrawControls()
+{
+    if (ImGui::Button(_isSampling ? "Pause" : "Resume"))
+        _isSampling = !_isSampling;
+    ImGui::SameLine();
+    if (ImGui::Button("Clear")) {
+        _sampler.Clear();
+        _lastSampleTime = -1;
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Export CSV ...")) {
+        ImGuiFileDialog::Instance()->OpenDialog(
+            "ExportMemoryFile", "Choose File", ".csv", ".");
+    }
+
+    UsdStageRefPtr stage = GetModel()->GetStage();
+    if (stage) {
+        ImGui::SameLine();
+        ImGui::TextDisabled("%zu layers", stage->GetUsedLayers().size());
+    }
+    if (!MemorySampler::IsMallocTagEnabled()) {
+        ImGui::TextDisabled(
+            "USD memory is not tracked, start with --malloc-tags to track it.");
+    }
+}
+
+void MemoryView::_DrawPlot()
+{
+    const vector<MemorySample>& samples = _sampler.GetSamples();
+    if (samples.empty()) return;
+
+    // TfMallocTag tracks every CPU allocation, its total already counts the
+    // memory of the scene indices
+    vector<float> totals;
+    for (auto&& sample : samples) {
+        bool hasUsdTotal = sample.bytes.count("USD/Total") > 0;
+        size_t total = 0;
+        for (auto&& it : sample.bytes) {
+            bool isUsd = it.first.rfind("USD/", 0) == 0;
+            bool isSceneIndex = it.first.rfind("Scene Indices/", 0) == 0;
+            if ((isUsd && it.first != "USD/Total") ||
+                (isSceneIndex && hasUsdTotal))
+                continue;
+            total += it.second;
+        }
+        totals.push_back(_ToMegabytes(total));
+    }
+
+    string overlay = to_string(int(totals.back())) + " MB";
+    ImGui::SetNextItemWidth(-1);
+    ImGui::PlotLines("##Total", totals.data(), totals.size(), 0,
+                     overlay.c_str(), 0.f, FLT_MAX, ImVec2(0, 80));
+}
+
+void MemoryView::_DrawTable()
+{
+    const vector<MemorySample>& samples = _sampler.GetSamples();
+    if (samples.empty()) return;
+    const MemorySample& sample = samples.back();
+
+    ImGuiTableFlags flags = ImGuiTableFlags_BordersV |
+                            ImGuiTableFlags_BordersOuterH |
+                            ImGuiTableFlags_RowBg;
+    if (!ImGui::BeginTable("Memory", 2, flags)) return;
+
+    ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_WidthStretch);
+    ImGui::TableSetupColumn("MB", ImGuiTableColumnFlags_WidthFixed, 80.f);
+    ImGui::TableHeadersRow();
+
+    // the keys are sorted, so the entries of a category follow each other
+    string category;
+    bool isOpen = false;
+    for (auto&& it : sample.bytes) {
+        size_t separator = it.first.find('/');
+        string entryCategory = it.first.substr(0, separator);
+        if (entryCategory != category) {
+            if (isOpen) ImGui::TreePop();
+            category = entryCategory;
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            isOpen = ImGui::TreeNodeEx(category.c_str(),
+                                       ImGuiTreeNodeFlags_DefaultOpen);
+        }
+        if (!isOpen) continue;
+
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(it.first.substr(separator + 1).c_str());
+        ImGui::TableNextColumn();
+        ImGui::Text("%.2f", _ToMegabytes(it.second));
+    }
+    if (isOpen) ImGui::TreePop();
+
+    ImGui::EndTable();
+}
+
+PXR_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,76 @@
+/**
+ * @file memoryview.h
+ * @author Raphael Jouretz (rjouretz.com)
+ * @brief Memory view that reports the memory used by the USD stage, the scene
+ * indices and the renderers. It samples the memory periodically and exports
+ * the samples to CSV.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include "memorysampler.h"
+#include "view.h"
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+using namespace std;
+
+/**
+ * @brief Memory view that reports the memory used by the USD stage, the
+ * scene indices and the renderers. It samples the memory periodically and
+ * exports the samples to CSV.
+ *
+ */
+class MemoryView : public View {
+    public:
+        inline static const string VIEW_TYPE = "Memory";
+
+        /**
+         * @brief Construct a new MemoryView object
+         *
+         * @param model the Model of the new MemoryView view
+         * @param label the ImGui label of the new MemoryView view
+         */
+        MemoryView(Model* model, const string label = VIEW_TYPE);
+
+        /**
+         * @brief Override of the View::GetViewType
+         *
+         */
+        const string GetViewType() override;
+
+    private:
+        const double _SAMPLING_PERIOD = 1.0;
+
+        MemorySampler _sampler;
+        bool _isSampling;
+        double _lastSampleTime;
+
+        /**
+         * @brief Override of the View::Draw
+         *
+         */
+        void _Draw() override;
+
+        /**
+         * @brief Draw the sampling controls and the export button
+         *
+         */
+        void _DrawControls();
+
+        /**
+         * @brief Draw the plot of the total memory over time
+         *
+         */
+        void _DrawPlot();
+
+        /**
+         * @brief Draw the memory of the last sample, grouped by category
+         *
+         */
+        void _DrawTable();
+};
+
+PXR_NAMESPACE_CLOSE_SCOPE
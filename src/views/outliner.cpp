@@ -4,7 +4,10 @@
 
 PXR_NAMESPACE_OPEN_SCOPE
 
-Outliner::Outliner(Model* model, const string label) : View(model, label) {}
+Outliner::Outliner(Model* model, const string label) : View(model, label)
+{
+    _displayModeSceneIndex = GetModel()->GetDisplayModeSceneIndex();
+}
 
 const string Outliner::GetViewType()
 {
@@ -27,6 +30,11 @@ ImRect Outliner::_DrawPrimHierarchy(SdfPath primPath)
         GetModel()->SetSelection({primPath});
     }
 
+    if (ImGui::BeginPopupContextItem()) {
+        _DrawDisplayModeMenu(primPath);
+        ImGui::EndPopup();
+    }
+
     const ImRect curItemRect =
         ImRect(ImGui::GetItemRectMin(), ImGui::GetItemRectMax());
 
@@ -91,6 +99,19 @@ bool Outliner::_DrawHierarchyNode(SdfPath primPath)
     return recurse;
 }
 
+void Outliner::_DrawDisplayModeMenu(SdfPath primPath)
+{
+    using DisplayMode = DisplayModeSceneIndex::DisplayMode;
+
+    DisplayMode curMode = _displayModeSceneIndex->GetDisplayMode(primPath);
+    for (DisplayMode mode : {DisplayMode::Full, DisplayMode::Proxy,
+                             DisplayMode::Bounds, DisplayMode::Points}) {
+        const char* name = DisplayModeSceneIndex::GetDisplayModeName(mode);
+        if (ImGui::MenuItem(name, NULL, mode == curMode))
+            _displayModeSceneIndex->SetDisplayMode(primPath, mode);
+    }
+}
+
 bool Outliner::IsParentOf(SdfPath primPath, SdfPath childPrimPath)
 {
     return primPath.GetCommonPrefix(childPrimPath) == primPath;
@@ -14,6 +14,7 @@
 #include <imgui_internal.h>
 #include <pxr/usd/usd/prim.h>
 
+#include "sceneindices/displaymodesceneindex.h"
 #include "view.h"
 
 PXR_NAMESPACE_OPEN_SCOPE
@@ -44,6 +45,8 @@ class Outliner : public View {
         const string GetViewType() override;
 
     private:
+        DisplayModeSceneIndexRefPtr _displayModeSceneIndex;
+
         /**
          * @brief Override of the View::Draw
          *
@@ -88,6 +91,14 @@ class Outliner : public View {
          */
         bool _DrawHierarchyNode(SdfPath primPath);
 
+        /**
+         * @brief Draw the context menu of a tree node to set the display
+         * mode of the prim and its descendants
+         *
+         * @param primPath the SdfPath of the prim of the tree node
+         */
+        void _DrawDisplayModeMenu(SdfPath primPath);
+
         /**
          * @brief Check if a given prim path is parent of another prim path
          *
@@ -0,0 +1,163 @@
+#include "timeline.h"
+
+#include <pxr/usd/usd/stage.h>
+
+#include <cmath>
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+Timeline::Timeline(Model* model, const string label)
+    : View(model, label),
+      _isPlaying(false),
+      _isLooping(true),
+      _frameAccumulator(0),
+      _displayedFrames(0),
+      _rateStartTime(0),
+      _playbackRate(0)
+{
+}
+
+const string Timeline::GetViewType()
+{
+    return VIEW_TYPE;
+};
+
+void Timeline::_Draw()
+{
+    UsdStageRefPtr stage = GetModel()->GetStage();
+    if (!stage || !stage->HasAuthoredTimeCodeRange()) {
+        _isPlaying = false;
+        ImGui::TextDisabled("The stage has no animation.");
+        return;
+    }
+
+    double start = stage->GetStartTimeCode();
+    double end = stage->GetEndTimeCode();
+    double timeCodesPerSecond = stage->GetTimeCodesPerSecond();
+
+    if (_isPlaying) {
+        _Advance(start, end, timeCodesPerSecond);
+        _PrefetchNextFrames(start, end);
+        _UpdatePlaybackRate();
+    }
+
+    _DrawControls(start, end, timeCodesPerSecond);
+}
+
+void Timeline::_DrawControls(double start, double end,
+                             double timeCodesPerSecond)
+{
+    double frame = _GetCurrentFrame(start);
+
+    if (ImGui::Button("|<")) GetModel()->SetTime(start);
+    ImGui::SameLine();
+    if (ImGui::Button("<")) GetModel()->SetTime(std::max(start, frame - 1));
+    ImGui::SameLine();
+    if (ImGui::Button(_isPlaying ? "Pause" : "Play")) {
+        _isPlaying = !_isPlaying;
+        _frameAccumulator = 0;
+        _displayedFrames = 0;
+        _rateStartTime = ImGui::GetTime();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button(">")) GetModel()->SetTime(std::min(end, frame + 1));
+    ImGui::SameLine();
+    if (ImGui::Button(">|")) GetModel()->SetTime(end);
+    ImGui::SameLine();
+    ImGui::Checkbox("Loop", &_isLooping);
+    ImGui::SameLine();
+    if (_isPlaying)
+        ImGui::Text("%.1f / %.1f fps", _playbackRate, timeCodesPerSecond);
+    else ImGui::Text("%.1f fps", timeCodesPerSecond);
+
+    // scrubbing
+    float sliderFrame = frame;
+    ImGui::SetNextItemWidth(-1);
+    if (ImGui::SliderFloat("##Time", &sliderFrame, start, end, "%.0f")) {
+        GetModel()->SetTime(std::round(sliderFrame));
+    }
+
+    _DrawCacheStats();
+}
+
+void Timeline::_DrawCacheStats()
+{
+    SampledValueCacheSceneIndexRefPtr cache =
+        GetModel()->GetSampledValueCache();
+    if (!cache) return;
+
+    size_t hits = cache->GetHitCount();
+    size_t lookups = hits + cache->GetMissCount();
+    float hitRate = lookups > 0 ? 100.f * hits / lookups : 0.f;
+
+    ImGui::TextDisabled("Value cache: %zu values, %.1f MB, %.0f%% hits",
+                        cache->GetEntryCount(),
+                        cache->GetMemoryUsage() / (1024.f * 1024.f), hitRate);
+}
+
+void Timeline::_Advance(double start, double end, double timeCodesPerSecond)
+{
+    // only whole frames are displayed, frames that could not be displayed
+    // in time are skipped to keep the playback in real time
+    _frameAccumulator += ImGui::GetIO().DeltaTime * timeCodesPerSecond;
+    int steps = int(_frameAccumulator);
+    if (steps == 0) return;
+    _frameAccumulator -= steps;
+
+    double next = _GetCurrentFrame(start) + steps;
+    if (next > end) {
+        if (_isLooping) next = start + fmod(next - start, end - start + 1);
+        else {
+            next = end;
+            _isPlaying = false;
+        }
+    }
+
+    GetModel()->SetTime(next);
+    _displayedFrames++;
+}
+
+void Timeline::_PrefetchNextFrames(double start, double end)
+{
+    double frame = _GetCurrentFrame(start);
+
+    vector<double> frames;
+    for (int i = 1; i <= _PREFETCH_FRAMES; i++) {
+        double next = frame + i;
+        if (next > end) {
+            if (!_isLooping) break;
+            next = start + fmod(next - start, end - start + 1);
+        }
+        frames.push_back(next);
+    }
+    GetModel()->PrefetchTimes(frames);
+}
+
+void Timeline::_UpdatePlaybackRate()
+{
+    double elapsed = ImGui::GetTime() - _rateStartTime;
+    if (elapsed < _RATE_SAMPLING_TIME) return;
+
+    _playbackRate = _displayedFrames / elapsed;
+    _displayedFrames = 0;
+    _rateStartTime = ImGui::GetTime();
+}
+
+double Timeline::_GetCurrentFrame(double start)
+{
+    UsdTimeCode time = GetModel()->GetTime();
+    if (time.IsDefault()) return start;
+    return time.GetValue();
+}
+
+void Timeline::_KeyPressEvent(ImGuiKey key)
+{
+    if (key == ImGuiKey_Space) {
+        _isPlaying = !_isPlaying;
+        _frameAccumulator = 0;
+        _displayedFrames = 0;
+        _rateStartTime = ImGui::GetTime();
+    }
+}
+
+PXR_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,112 @@
+/**
+ * @file timeline.h
+ * @author Raphael Jouretz (rjouretz.com)
+ * @brief Timeline view that plays back the animation of the current UsdStage.
+ * It allows to play, scrub and loop over the time range of the stage.
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+
+#include "view.h"
+
+PXR_NAMESPACE_OPEN_SCOPE
+
+using namespace std;
+
+/**
+ * @brief Timeline view that plays back the animation of the current UsdStage.
+ * It allows to play, scrub and loop over the time range of the stage.
+ *
+ */
+class Timeline : public View {
+    public:
+        inline static const string VIEW_TYPE = "Timeline";
+
+        /**
+         * @brief Construct a new Timeline object
+         *
+         * @param model the Model of the new Timeline view
+         * @param label the ImGui label of the new Timeline view
+         */
+        Timeline(Model* model, const string label = VIEW_TYPE);
+
+        /**
+         * @brief Override of the View::GetViewType
+         *
+         */
+        const string GetViewType() override;
+
+    private:
+        const int _PREFETCH_FRAMES = 8;
+        const double _RATE_SAMPLING_TIME = .5;
+
+        bool _isPlaying, _isLooping;
+        double _frameAccumulator;
+        int _displayedFrames;
+        double _rateStartTime, _playbackRate;
+
+        /**
+         * @brief Override of the View::Draw
+         *
+         */
+        void _Draw() override;
+
+        /**
+         * @brief Draw the playback controls and the time slider
+         *
+         * @param start the start time code of the stage
+         * @param end the end time code of the stage
+         * @param timeCodesPerSecond the time codes per second of the stage
+         */
+        void _DrawControls(double start, double end,
+                           double timeCodesPerSecond);
+
+        /**
+         * @brief Draw the statistics of the sampled value cache
+         *
+         */
+        void _DrawCacheStats();
+
+        /**
+         * @brief Advance the current time by the number of frames elapsed
+         * since the last update
+         *
+         * @param start the start time code of the stage
+         * @param end the end time code of the stage
+         * @param timeCodesPerSecond the time codes per second of the stage
+         */
+        void _Advance(double start, double end, double timeCodesPerSecond);
+
+        /**
+         * @brief Prefetch the frames following the current time
+         *
+         * @param start the start time code of the stage
+         * @param end the end time code of the stage
+         */
+        void _PrefetchNextFrames(double start, double end);
+
+        /**
+         * @brief Update the measured playback rate
+         *
+         */
+        void _UpdatePlaybackRate();
+
+        /**
+         * @brief Get the current time of the model as a frame
+         *
+         * @param start the start time code of the stage, used if the model
+         * time is the default time
+         * @return the current frame
+         */
+        double _GetCurrentFrame(double start);
+
+        /**
+         * @brief Override of the View::_KeyPressEvent
+         *
+         */
+        void _KeyPressEvent(ImGuiKey key) override;
+};
+
+PXR_NAMESPACE_CLOSE_SCOPE
@@ -1,23 +1,45 @@
 #include "usdsessionlayer.h"
 
 #include <ImGuiFileDialog.h>
+#include <pxr/base/arch/math.h>
+#include <pxr/base/gf/quath.h>
+#include <pxr/base/work/loops.h>
 #include <pxr/imaging/hd/tokens.h>
-#include <pxr/usd/usdGeom/camera.h>
-#include <pxr/usd/usdGeom/capsule.h>
-#include <pxr/usd/usdGeom/cone.h>
-#include <pxr/usd/usdGeom/cube.h>
-#include <pxr/usd/usdGeom/cylinder.h>
+#include <pxr/usd/sdf/attributeSpec.h>
+#include <pxr/usd/sdf/changeBlock.h>
+#include <pxr/usd/sdf/copyUtils.h>
+#include <pxr/usd/sdf/primSpec.h>
+#include <pxr/usd/sdf/propertySpec.h>
+#include <pxr/usd/sdf/reference.h>
+#include <pxr/usd/sdf/relationshipSpec.h>
+#include <pxr/usd/sdf/schema.h>
+#include <pxr/usd/sdf/types.h>
 #include <pxr/usd/usdGeom/metrics.h>
 #include <pxr/usd/usdGeom/plane.h>
-#include <pxr/usd/usdGeom/sphere.h>
+#include <pxr/usd/usdGeom/tokens.h>
+#include <pxr/usd/usdGeom/xformOp.h>
 #include <pxr/usdImaging/usdImaging/sceneIndices.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <fstream>
+#include <map>
+#include <random>
+#include <unordered_set>
+
+#include "stagediskcache.h"
 
 PXR_NAMESPACE_OPEN_SCOPE
 
 UsdSessionLayer::UsdSessionLayer(Model* model, const string label)
-    : View(model, label), _isEditing(false)
+    : View(model, label),
+      _isEditing(false),
+      _scatterCount(1000),
+      _scatterSeed(0),
+      _isExportBinary(false),
+      _isExportFlattened(true),
+      _isCachedStageChanged(false)
 {
     _gizmoWindowFlags = ImGuiWindowFlags_MenuBar;
 
@@ -31,7 +53,12 @@ UsdSessionLayer::UsdSessionLayer(Model* model, const string label)
         UsdImagingCreateSceneIndices(info);
 
     _stageSceneIndex = sceneIndices.stageSceneIndex;
-    GetModel()->AddSceneIndexBase(sceneIndices.finalSceneIndex);
+
+    // values are resolved once per frame for all the downstream consumers
+    SampledValueCacheSceneIndexRefPtr sampledValueCache =
+        SampledValueCacheSceneIndex::New(sceneIndices.finalSceneIndex);
+    GetModel()->SetSampledValueCache(sampledValueCache);
+    GetModel()->AddSceneIndexBase(sampledValueCache);
 
     _SetEmptyStage();
 }
@@ -57,10 +84,15 @@ void UsdSessionLayer::_Draw()
                     "LoadFile", "Choose File", ".usd,.usdc,.usda,.usdz", ".");
             }
 
-            if (ImGui::MenuItem("Export to ...")) {
+            if (ImGui::MenuItem("Export to ...", nullptr, false,
+                                !_exporter.IsRunning())) {
                 ImGuiFileDialog::Instance()->OpenDialog(
-                    "ExportFile", "Choose File", ".usd,.usdc,.usda,.usdz",
-                    ".");
+                    "ExportFile", "Choose File", ".usd,.usdc,.usda", ".");
+            }
+            if (ImGui::BeginMenu("Export Options")) {
+                ImGui::MenuItem("Flatten Stage", nullptr, &_isExportFlattened);
+                ImGui::MenuItem("Binary .usd", nullptr, &_isExportBinary);
+                ImGui::EndMenu();
             }
             ImGui::EndMenu();
         }
@@ -81,11 +113,46 @@ void UsdSessionLayer::_Draw()
                     _CreatePrim(HdPrimTypeTokens->sphere);
                 ImGui::EndMenu();
             }
+            if (ImGui::BeginMenu("Scatter")) {
+                ImGui::InputInt("Count", &_scatterCount);
+                _scatterCount = max(_scatterCount, 1);
+                ImGui::InputInt("Seed", &_scatterSeed);
+                _scatterSeed = max(_scatterSeed, 0);
+                ImGui::Separator();
+                if (ImGui::MenuItem("Capsules"))
+                    _ScatterPrims(HdPrimTypeTokens->capsule, _scatterCount);
+                if (ImGui::MenuItem("Cones"))
+                    _ScatterPrims(HdPrimTypeTokens->cone, _scatterCount);
+                if (ImGui::MenuItem("Cubes"))
+                    _ScatterPrims(HdPrimTypeTokens->cube, _scatterCount);
+                if (ImGui::MenuItem("Cylinders"))
+                    _ScatterPrims(HdPrimTypeTokens->cylinder, _scatterCount);
+                if (ImGui::MenuItem("Spheres"))
+                    _ScatterPrims(HdPrimTypeTokens->sphere, _scatterCount);
+                ImGui::Separator();
+                SdfPathVector selection = GetModel()->GetSelection();
+                bool hasSelection = !selection.empty();
+                if (ImGui::MenuItem("Instances on Surface", nullptr, false,
+                                    hasSelection))
+                    _ScatterInstances(selection, _scatterCount, true);
+                if (ImGui::MenuItem("Instances in Volume", nullptr, false,
+                                    hasSelection))
+                    _ScatterInstances(selection, _scatterCount, false);
+                ImGui::EndMenu();
+            }
             ImGui::EndMenu();
         }
+        if (_exporter.IsRunning()) {
+            string status = "Export: " + _exporter.GetStatus();
+            ImGui::ProgressBar(_exporter.GetProgress(), ImVec2(150, 0),
+                               status.c_str());
+            if (ImGui::SmallButton("Cancel")) _exporter.Cancel();
+        }
         ImGui::EndMenuBar();
     }
 
+    _ReloadChangedLayers();
+    _ApplyParsedLayer(false);
     if (_IsUsdSessionLayerUpdated()) _LoadSessionTextFromModel();
     _editor.Render("TextEditor");
 
@@ -100,7 +167,8 @@ void UsdSessionLayer::_Draw()
     if (ImGuiFileDialog::Instance()->Display("ExportFile")) {
         if (ImGuiFileDialog::Instance()->IsOk()) {
             string filePath = ImGuiFileDialog::Instance()->GetFilePathName();
-            _stage->Export(filePath, false);
+            _exporter.Start(_stage, filePath, _isExportBinary,
+                            _isExportFlattened);
         }
         ImGuiFileDialog::Instance()->Close();
     }
@@ -117,7 +185,8 @@ void UsdSessionLayer::_SetEmptyStage()
 
     _stage->SetEditTarget(_sessionLayer);
     _stageSceneIndex->SetStage(_stage);
-    _stageSceneIndex->SetTime(UsdTimeCode::Default());
+    GetModel()->SetStage(_stage, _stageSceneIndex);
+    _WatchLayers();
 }
 
 void UsdSessionLayer::_ClearStage()
@@ -126,6 +195,26 @@ void UsdSessionLayer::_ClearStage()
         return;
     }
 
+    // a text parsed for the previous stage is dropped
+    if (_parsedLayer.valid()) _parsedLayer.wait();
+    _parsedLayer = {};
+
+    GetModel()->WaitForPrefetch();
+    _nameCounters.clear();
+    _scatterSeed = 0;
+    _pendingReloads.clear();
+    _cachedFilePath.clear();
+    _isCachedStageChanged = false;
+
+    // the exports read the root layer, edited below, a running flattening
+    // still has to return
+    _exporter.Cancel();
+    _exporter.Wait();
+
+    // the stage being cached is replaced, its write is dropped rather than
+    // waited for
+    StageDiskCache::Cancel();
+
     _sessionLayer->Clear();
     _stage->SetEditTarget(_stage->GetRootLayer());
 
@@ -144,57 +233,333 @@ void UsdSessionLayer::_LoadUsdStage(const string usdFilePath)
     }
 
     _ClearStage();
-    _stage = UsdStage::Open(usdFilePath);
+    _stage = StageDiskCache::Open(usdFilePath);
     _rootLayer = _stage->GetRootLayer();
     _sessionLayer = _stage->GetSessionLayer();
     _stage->SetEditTarget(_sessionLayer);
     _stageSceneIndex->SetStage(_stage);
-    _stageSceneIndex->SetTime(UsdTimeCode::Default());
+    GetModel()->SetStage(_stage, _stageSceneIndex);
+    if (StageDiskCache::IsCached(_stage)) _cachedFilePath = usdFilePath;
+    _WatchLayers();
+}
+
+void UsdSessionLayer::_WatchLayers()
+{
+    // the flattened file of a cached stage never changes, unlike the layers
+    // listed in its manifest
+    if (_cachedFilePath.empty())
+        _layerWatcher.SetLayers(_stage->GetUsedLayers());
+    else
+        _layerWatcher.SetPaths(
+            StageDiskCache::GetSourceLayerPaths(_cachedFilePath));
+}
+
+void UsdSessionLayer::_ReloadChangedLayers()
+{
+    if (!_cachedFilePath.empty()) {
+        if (!_isCachedStageChanged &&
+            !_layerWatcher.GetChangedPaths().empty()) {
+            StageDiskCache::Invalidate(_cachedFilePath);
+            _isCachedStageChanged = true;
+        }
+    }
+    else {
+        for (auto&& layer : _layerWatcher.GetChangedLayers()) {
+            if (find(_pendingReloads.begin(), _pendingReloads.end(), layer) ==
+                _pendingReloads.end())
+                _pendingReloads.push_back(layer);
+        }
+    }
+
+    // the export and the caching read the layers, the changes are retried
+    // on the next frames rather than waiting for them
+    if (_exporter.IsRunning() || StageDiskCache::IsRunning()) return;
+
+    if (_isCachedStageChanged) {
+        TF_STATUS("The layers of %s changed, reopening it without the stage "
+                  "cache.",
+                  _cachedFilePath.c_str());
+
+        // the edits of the session layer survive the reopening
+        SdfLayerRefPtr sessionLayer = SdfLayer::CreateAnonymous(".usda");
+        sessionLayer->TransferContent(_sessionLayer);
+        string filePath = _cachedFilePath;
+        _LoadUsdStage(filePath);
+        _sessionLayer->TransferContent(sessionLayer);
+        return;
+    }
+
+    if (_pendingReloads.empty()) return;
+
+    // the layers are read by the prefetch meanwhile
+    GetModel()->WaitForPrefetch();
+
+    SdfLayerHandleVector layers;
+    layers.swap(_pendingReloads);
+    for (auto&& layer : layers) {
+        if (!layer) continue;
+
+        auto startTime = chrono::steady_clock::now();
+        bool isReloaded = layer->Reload();
+        _stageSceneIndex->ApplyPendingUpdates();
+        chrono::duration<double, milli> reloadTime =
+            chrono::steady_clock::now() - startTime;
+
+        if (isReloaded)
+            TF_STATUS("Reloaded %s in %.2f ms.",
+                      layer->GetIdentifier().c_str(), reloadTime.count());
+        else TF_WARN("Cannot reload %s.", layer->GetIdentifier().c_str());
+    }
+
+    // a reloaded layer may add or remove sublayers and references
+    _WatchLayers();
 }
 
 string UsdSessionLayer::_GetNextAvailableIndexedPath(string primPath)
 {
-    UsdPrim prim;
-    int i = -1;
+    // the indices below the counter are used already, the stage is still
+    // probed for the prims authored by other means (e.g. the text editor)
+    int& i = _nameCounters[primPath];
     string newPath;
     do {
-        i++;
         if (i == 0) newPath = primPath;
         else newPath = primPath + to_string(i);
-        prim = _stage->GetPrimAtPath(SdfPath(newPath));
-    } while (prim.IsValid());
+        i++;
+    } while (_sessionLayer->GetPrimAtPath(SdfPath(newPath)) ||
+             _stage->GetPrimAtPath(SdfPath(newPath)).IsValid());
     return newPath;
 }
 
 void UsdSessionLayer::_CreatePrim(TfToken primType)
 {
-    string primPath = _GetNextAvailableIndexedPath("/" + primType.GetString());
+    _CreatePrims(primType, {GfVec3d(0)});
+}
+
+namespace {
+
+void _AuthorAttribute(const SdfPrimSpecHandle& primSpec, const TfToken& name,
+                      const SdfValueTypeName& typeName, const VtValue& value,
+                      SdfVariability variability = SdfVariabilityVarying)
+{
+    SdfAttributeSpecHandle attrSpec =
+        SdfAttributeSpec::New(primSpec, name, typeName, variability);
+    if (attrSpec) attrSpec->SetDefaultValue(value);
+}
+
+}  // namespace
+
+SdfPathVector UsdSessionLayer::_CreatePrims(TfToken primType,
+                                            const vector<GfVec3d>& translates)
+{
+    static const map<TfToken, TfToken> schemaTypeNames{
+        {HdPrimTypeTokens->camera, TfToken("Camera")},
+        {HdPrimTypeTokens->capsule, TfToken("Capsule")},
+        {HdPrimTypeTokens->cone, TfToken("Cone")},
+        {HdPrimTypeTokens->cube, TfToken("Cube")},
+        {HdPrimTypeTokens->cylinder, TfToken("Cylinder")},
+        {HdPrimTypeTokens->sphere, TfToken("Sphere")}};
+
+    auto typeName = schemaTypeNames.find(primType);
+    if (typeName == schemaTypeNames.end()) return {};
+
+    // a text parsed meanwhile would remove the prims authored below
+    _ApplyParsedLayer(true);
+    GetModel()->WaitForPrefetch();
+
+    const bool isCamera = primType == HdPrimTypeTokens->camera;
+    const VtVec3fArray extent({{-1, -1, -1}, {1, 1, 1}});
+    const VtVec3fArray color({{.5f, .5f, .5f}});
+    const TfToken translateOp =
+        UsdGeomXformOp::GetOpName(UsdGeomXformOp::TypeTranslate);
+
+    SdfPathVector primPaths;
+    primPaths.reserve(translates.size());
+    {
+        // the stage is only recomposed once the block is closed, so the
+        // prims are authored with the Sdf API rather than the UsdGeom one
+        SdfChangeBlock changeBlock;
+        SdfPrimSpecHandle pseudoRoot = _sessionLayer->GetPseudoRoot();
+        for (auto&& translate : translates) {
+            SdfPath primPath(
+                _GetNextAvailableIndexedPath("/" + primType.GetString()));
+            SdfPrimSpecHandle primSpec =
+                SdfPrimSpec::New(pseudoRoot, primPath.GetName(),
+                                 SdfSpecifierDef, typeName->second);
+            if (!primSpec) continue;
+
+            if (isCamera) {
+                _AuthorAttribute(primSpec, UsdGeomTokens->focalLength,
+                                 SdfValueTypeNames->Float, VtValue(18.46f));
+            }
+            else {
+                _AuthorAttribute(primSpec, UsdGeomTokens->extent,
+                                 SdfValueTypeNames->Float3Array,
+                                 VtValue(extent));
+                _AuthorAttribute(primSpec, UsdGeomTokens->primvarsDisplayColor,
+                                 SdfValueTypeNames->Color3fArray,
+                                 VtValue(color));
+            }
 
-    if (primType == HdPrimTypeTokens->camera) {
-        auto cam = UsdGeomCamera::Define(_stage, SdfPath(primPath));
-        cam.CreateFocalLengthAttr(VtValue(18.46f));
+            if (translate != GfVec3d(0)) {
+                _AuthorAttribute(primSpec, translateOp,
+                                 SdfValueTypeNames->Double3,
+                                 VtValue(translate));
+                _AuthorAttribute(primSpec, UsdGeomTokens->xformOpOrder,
+                                 SdfValueTypeNames->TokenArray,
+                                 VtValue(VtTokenArray({translateOp})),
+                                 SdfVariabilityUniform);
+            }
+            primPaths.push_back(primPath);
+        }
     }
-    else {
-        UsdGeomGprim prim;
-        if (primType == HdPrimTypeTokens->capsule)
-            prim = UsdGeomCapsule::Define(_stage, SdfPath(primPath));
-        if (primType == HdPrimTypeTokens->cone)
-            prim = UsdGeomCone::Define(_stage, SdfPath(primPath));
-        if (primType == HdPrimTypeTokens->cube)
-            prim = UsdGeomCube::Define(_stage, SdfPath(primPath));
-        if (primType == HdPrimTypeTokens->cylinder)
-            prim = UsdGeomCylinder::Define(_stage, SdfPath(primPath));
-        if (primType == HdPrimTypeTokens->sphere)
-            prim = UsdGeomSphere::Define(_stage, SdfPath(primPath));
-
-        VtVec3fArray extent({{-1, -1, -1}, {1, 1, 1}});
-        prim.CreateExtentAttr(VtValue(extent));
-
-        VtVec3fArray color({{.5f, .5f, .5f}});
-        prim.CreateDisplayColorAttr(VtValue(color));
+
+    _stageSceneIndex->ApplyPendingUpdates();
+    _LoadSessionTextFromModel();
+    return primPaths;
+}
+
+void UsdSessionLayer::_ScatterPrims(TfToken primType, int count)
+{
+    // the prims fill a cube of the same density whatever their count, the
+    // seeds restart with the stage so that a stress test is reproducible
+    double size = cbrt(double(count)) * _SCATTER_SPACING;
+    mt19937 generator(uint32_t(_scatterSeed++));
+    uniform_real_distribution<double> distribution(-size / 2, size / 2);
+
+    vector<GfVec3d> translates(count);
+    for (auto&& translate : translates) {
+        double x = distribution(generator);
+        double y = distribution(generator);
+        double z = distribution(generator);
+        translate = GfVec3d(x, y, z);
+    }
+    _CreatePrims(primType, translates);
+}
+
+namespace {
+
+// A counter based generator, so that each sample only depends on its seed
+// and index whatever the split of the parallel loop (splitmix64). The seeds
+// are spread by an odd constant, so that their sequences do not overlap.
+float _GetRandom(uint64_t seed, uint64_t index)
+{
+    index += seed * 0xd1b54a32d192ed03ull + 0x9e3779b97f4a7c15ull;
+    index = (index ^ (index >> 30)) * 0xbf58476d1ce4e5b9ull;
+    index = (index ^ (index >> 27)) * 0x94d049bb133111ebull;
+    index ^= index >> 31;
+    return float(index >> 40) / float(1 << 24);
+}
+
+}  // namespace
+
+SdfPath UsdSessionLayer::_ScatterInstances(const SdfPathVector& prototypePaths,
+                                           int count, bool isOnSurface)
+{
+    // a text parsed meanwhile would remove the instancer authored below
+    _ApplyParsedLayer(true);
+    GetModel()->WaitForPrefetch();
+
+    SdfPathVector sourcePaths;
+    for (auto&& path : prototypePaths) {
+        if (path.IsPrimPath() && _stage->GetPrimAtPath(path))
+            sourcePaths.push_back(path);
+    }
+    if (sourcePaths.empty() || count <= 0) {
+        TF_WARN("No prim of the stage is selected, nothing to instance.");
+        return SdfPath();
+    }
+
+    // the instances fill a square or a cube of the same density whatever
+    // their count
+    int upIndex = UsdGeomGetStageUpAxis(_stage) == UsdGeomTokens->z ? 2 : 1;
+    float size = float(isOnSurface ? sqrt(double(count))
+                                   : cbrt(double(count))) *
+                 float(_SCATTER_SPACING);
+
+    VtVec3fArray positions(count), scales(count);
+    VtQuathArray orientations(count);
+    VtIntArray protoIndices(count);
+    int prototypeCount = int(sourcePaths.size());
+    uint64_t seed = uint64_t(_scatterSeed++);
+
+    WorkParallelForN(count, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            float r[8];
+            for (int k = 0; k < 8; k++) r[k] = _GetRandom(seed, i * 8 + k);
+
+            GfVec3f position((r[0] - .5f) * size, (r[1] - .5f) * size,
+                             (r[2] - .5f) * size);
+            GfQuatf orientation;
+            if (isOnSurface) {
+                // the instances stand on the ground plane, turned around
+                // the up axis
+                position[upIndex] = 0;
+                GfVec3f axis(0);
+                axis[upIndex] = 1;
+                float angle = r[3] * float(M_PI);
+                orientation = GfQuatf(cos(angle), axis * sin(angle));
+            }
+            else {
+                // uniform random rotation (Shoemake)
+                float a = sqrt(1 - r[3]), b = sqrt(r[3]);
+                float u = 2 * float(M_PI) * r[4], v = 2 * float(M_PI) * r[5];
+                orientation = GfQuatf(b * cos(v), a * sin(u), a * cos(u),
+                                      b * sin(v));
+            }
+
+            positions[i] = position;
+            orientations[i] = GfQuath(orientation);
+            scales[i] = GfVec3f(.5f + r[6]);
+            protoIndices[i] = min(int(r[7] * prototypeCount),
+                                  prototypeCount - 1);
+        }
+    });
+
+    SdfPath instancerPath(_GetNextAvailableIndexedPath("/scatter"));
+    {
+        SdfChangeBlock changeBlock;
+        SdfPrimSpecHandle instancerSpec = SdfPrimSpec::New(
+            _sessionLayer->GetPseudoRoot(), instancerPath.GetName(),
+            SdfSpecifierDef, TfToken("PointInstancer"));
+        if (!instancerSpec) return SdfPath();
+
+        SdfPrimSpecHandle prototypesSpec = SdfPrimSpec::New(
+            instancerSpec, "prototypes", SdfSpecifierDef, TfToken("Scope"));
+
+        // the prototypes reference the sources with an identity xform, the
+        // sources themselves are left as they are
+        SdfPathVector targets;
+        for (size_t i = 0; i < sourcePaths.size(); i++) {
+            string name = sourcePaths[i].GetName() + "_" + to_string(i);
+            SdfPrimSpecHandle prototypeSpec = SdfPrimSpec::New(
+                prototypesSpec, name, SdfSpecifierDef);
+            prototypeSpec->GetReferenceList().Prepend(
+                SdfReference(string(), sourcePaths[i]));
+            _AuthorAttribute(prototypeSpec, UsdGeomTokens->xformOpOrder,
+                             SdfValueTypeNames->TokenArray,
+                             VtValue(VtTokenArray()), SdfVariabilityUniform);
+            targets.push_back(prototypeSpec->GetPath());
+        }
+
+        SdfRelationshipSpecHandle relSpec = SdfRelationshipSpec::New(
+            instancerSpec, UsdGeomTokens->prototypes);
+        relSpec->GetTargetPathList().ClearEditsAndMakeExplicit();
+        relSpec->GetTargetPathList().GetExplicitItems() = targets;
+
+        _AuthorAttribute(instancerSpec, UsdGeomTokens->protoIndices,
+                         SdfValueTypeNames->IntArray, VtValue(protoIndices));
+        _AuthorAttribute(instancerSpec, UsdGeomTokens->positions,
+                         SdfValueTypeNames->Point3fArray, VtValue(positions));
+        _AuthorAttribute(instancerSpec, UsdGeomTokens->orientations,
+                         SdfValueTypeNames->QuathArray,
+                         VtValue(orientations));
+        _AuthorAttribute(instancerSpec, UsdGeomTokens->scales,
+                         SdfValueTypeNames->Float3Array, VtValue(scales));
     }
 
     _stageSceneIndex->ApplyPendingUpdates();
+    _LoadSessionTextFromModel();
+    return instancerPath;
 }
 
 bool UsdSessionLayer::_IsUsdSessionLayerUpdated()
@@ -210,12 +575,154 @@ void UsdSessionLayer::_LoadSessionTextFromModel()
     _sessionLayer->ExportToString(&layerText);
     _editor.SetText(layerText);
     _lastLoadedText = layerText;
+
+    // the session layer changed, from the text editor or the menus
+    GetModel()->GetRecorder()->RecordSessionLayer(layerText);
 }
 
 void UsdSessionLayer::_SaveSessionTextToModel()
 {
     string editedText = _editor.GetText();
-    _sessionLayer->ImportFromString(editedText.c_str());
+    if (editedText == _lastLoadedText) return;
+
+    // the texts are applied in the order they were edited
+    _ApplyParsedLayer(true);
+
+    _parsedLayer = async(launch::async, [editedText]() -> SdfLayerRefPtr {
+        SdfLayerRefPtr layer = SdfLayer::CreateAnonymous(".usda");
+        if (!layer->ImportFromString(editedText)) return nullptr;
+        return layer;
+    });
+}
+
+void UsdSessionLayer::_ApplyParsedLayer(bool isWaiting)
+{
+    if (!_parsedLayer.valid()) return;
+    if (!isWaiting && _parsedLayer.wait_for(chrono::seconds(0)) !=
+                          future_status::ready)
+        return;
+
+    SdfLayerRefPtr layer = _parsedLayer.get();
+    if (!layer) {
+        TF_WARN("The session layer text is invalid and was not applied.");
+        return;
+    }
+
+    GetModel()->WaitForPrefetch();
+    {
+        SdfChangeBlock changeBlock;
+        if (!_ApplySpecDiff(layer)) _sessionLayer->TransferContent(layer);
+    }
+    _stageSceneIndex->ApplyPendingUpdates();
+}
+
+namespace {
+
+// Check if the children of a spec keep their order once the removed ones
+// are erased and the new ones appended, as done by the spec by spec update
+bool _IsChildOrderKept(const VtValue& newValue, const VtValue& curValue)
+{
+    if (!newValue.IsHolding<TfTokenVector>() ||
+        !curValue.IsHolding<TfTokenVector>())
+        return true;
+
+    const TfTokenVector& newChildren = newValue.UncheckedGet<TfTokenVector>();
+    const TfTokenVector& curChildren = curValue.UncheckedGet<TfTokenVector>();
+    TfToken::HashSet newSet(newChildren.begin(), newChildren.end());
+    TfToken::HashSet curSet(curChildren.begin(), curChildren.end());
+
+    TfTokenVector children;
+    for (auto&& child : curChildren) {
+        if (newSet.count(child)) children.push_back(child);
+    }
+    for (auto&& child : newChildren) {
+        if (!curSet.count(child)) children.push_back(child);
+    }
+    return children == newChildren;
+}
+
+}  // namespace
+
+bool UsdSessionLayer::_ApplySpecDiff(const SdfLayerRefPtr& layer)
+{
+    const SdfSchema& schema = SdfSchema::GetInstance();
+    const SdfPath& root = SdfPath::AbsoluteRootPath();
+
+    SdfPathVector newPaths, curPaths;
+    layer->Traverse(root, [&](const SdfPath& path) {
+        newPaths.push_back(path);
+    });
+    _sessionLayer->Traverse(root, [&](const SdfPath& path) {
+        curPaths.push_back(path);
+    });
+
+    // a spec whose type changed is removed and created again
+    unordered_set<SdfPath, SdfPath::Hash> newSet, curSet;
+    for (auto&& path : newPaths) newSet.insert(path);
+    for (auto&& path : curPaths) {
+        if (newSet.count(path) &&
+            layer->GetSpecType(path) != _sessionLayer->GetSpecType(path))
+            newSet.erase(path);
+        else curSet.insert(path);
+    }
+
+    // only the roots of the removed and created subtrees are edited, prims
+    // and properties are the only specs removed on their own
+    SdfPathVector removedPaths, createdPaths, changedPaths;
+    for (auto&& path : curPaths) {
+        if (newSet.count(path) || !newSet.count(path.GetParentPath())) continue;
+
+        SdfSpecType specType = _sessionLayer->GetSpecType(path);
+        if (specType != SdfSpecTypePrim && specType != SdfSpecTypeAttribute &&
+            specType != SdfSpecTypeRelationship)
+            return false;
+        removedPaths.push_back(path);
+    }
+    for (auto&& path : newPaths) {
+        if (curSet.count(path)) changedPaths.push_back(path);
+        else if (curSet.count(path.GetParentPath()))
+            createdPaths.push_back(path);
+    }
+
+    // the children fields are maintained by the layer as specs are removed
+    // and created, which cannot reorder the remaining ones
+    for (auto&& path : changedPaths) {
+        for (auto&& field : layer->ListFields(path)) {
+            if (!schema.HoldsChildren(field)) continue;
+            if (!_IsChildOrderKept(layer->GetField(path, field),
+                                   _sessionLayer->GetField(path, field)))
+                return false;
+        }
+    }
+
+    for (auto&& path : removedPaths) {
+        SdfPrimSpecHandle parent =
+            _sessionLayer->GetPrimAtPath(path.GetParentPath());
+        if (path.IsPrimPath())
+            parent->RemoveNameChild(_sessionLayer->GetPrimAtPath(path));
+        else parent->RemoveProperty(_sessionLayer->GetPropertyAtPath(path));
+    }
+
+    for (auto&& path : createdPaths)
+        SdfCopySpec(layer, path, _sessionLayer, path);
+
+    // the values equal to the current ones are not set, so they are not
+    // notified either
+    for (auto&& path : changedPaths) {
+        for (auto&& field : layer->ListFields(path)) {
+            if (schema.HoldsChildren(field)) continue;
+
+            VtValue value = layer->GetField(path, field);
+            if (_sessionLayer->GetField(path, field) != value)
+                _sessionLayer->SetField(path, field, value);
+        }
+        for (auto&& field : _sessionLayer->ListFields(path)) {
+            if (schema.HoldsChildren(field)) continue;
+            if (!layer->HasField(path, field))
+                _sessionLayer->EraseField(path, field);
+        }
+    }
+    return true;
 }
 
 TextEditor::Palette UsdSessionLayer::_GetPalette()
@@ -348,7 +855,6 @@ void UsdSessionLayer::_FocusOutEvent()
 {
     _isEditing = false;
     _SaveSessionTextToModel();
-    _stageSceneIndex->ApplyPendingUpdates();
 };
 
 PXR_NAMESPACE_CLOSE_SCOPE
@@ -11,8 +11,16 @@
 
 #define IMGUI_DEFINE_MATH_OPERATORS
 #include <TextEditor.h>
+#include <pxr/base/gf/vec3d.h>
+#include <pxr/usd/sdf/layer.h>
 #include <pxr/usdImaging/usdImaging/stageSceneIndex.h>
 
+#include <future>
+#include <unordered_map>
+#include <vector>
+
+#include "layerwatcher.h"
+#include "stageexporter.h"
 #include "view.h"
 
 PXR_NAMESPACE_OPEN_SCOPE
@@ -49,6 +57,8 @@ class UsdSessionLayer : public View {
         ImGuiWindowFlags _GetGizmoWindowFlags() override;
 
     private:
+        inline static const double _SCATTER_SPACING = 3;
+
         TextEditor _editor;
         bool _isEditing;
         string _lastLoadedText;
@@ -56,6 +66,15 @@ class UsdSessionLayer : public View {
         SdfLayerRefPtr _rootLayer, _sessionLayer;
         UsdImagingStageSceneIndexRefPtr _stageSceneIndex;
         UsdStageRefPtr _stage;
+        future<SdfLayerRefPtr> _parsedLayer;
+        unordered_map<string, int> _nameCounters;
+        int _scatterCount, _scatterSeed;
+        StageExporter _exporter;
+        bool _isExportBinary, _isExportFlattened;
+        LayerWatcher _layerWatcher;
+        SdfLayerHandleVector _pendingReloads;
+        string _cachedFilePath;
+        bool _isCachedStageChanged;
 
         /**
          * @brief Override of the View::Draw
@@ -82,6 +101,23 @@ class UsdSessionLayer : public View {
          */
         void _ClearStage();
 
+        /**
+         * @brief Watch the layers of the stage, or the layers it was
+         * flattened from if it was opened from the stage cache
+         *
+         */
+        void _WatchLayers();
+
+        /**
+         * @brief Reload the layers of the stage whose file changed on disk,
+         * so that only the prims they contribute to are resynced. The
+         * changed layers stay pending while an export runs. A stage opened
+         * from the stage cache is reopened from its layers instead, keeping
+         * its session layer.
+         *
+         */
+        void _ReloadChangedLayers();
+
         /**
          * @brief Check if USD session layer was updated since the last load
          * (different)
@@ -100,15 +136,36 @@ class UsdSessionLayer : public View {
 
         /**
          * @brief Save the text from the session layer view to the USD session
-         * layer of the Model
+         * layer of the Model. The text is parsed on another thread, the
+         * changes are applied by a later frame once parsed.
          *
          */
         void _SaveSessionTextToModel();
 
+        /**
+         * @brief Apply the layer parsed from the text to the USD session
+         * layer of the Model, if parsed
+         *
+         * @param isWaiting true to wait for the layer to be parsed
+         */
+        void _ApplyParsedLayer(bool isWaiting);
+
+        /**
+         * @brief Apply the specs of a layer that differ from the session
+         * layer to the session layer, so that only the changed specs are
+         * notified. Must be called in an SdfChangeBlock.
+         *
+         * @param layer the layer holding the new content
+         * @return false if the differences cannot be applied spec by spec,
+         * nothing is applied then
+         */
+        bool _ApplySpecDiff(const SdfLayerRefPtr& layer);
+
         /**
          * @brief Convert the given prim path by an indexed prim path if the
          * given prim path is already used in the Model. Indexing consist of
-         * adding a number at the end of the path.
+         * adding a number at the end of the path. The next index of each
+         * path is kept, so that the used paths are only probed once.
          *
          * @param primPath the given prim path to index if already exists in
          * Model
@@ -123,6 +180,45 @@ class UsdSessionLayer : public View {
          */
         void _CreatePrim(TfToken primType);
 
+        /**
+         * @brief Create new prims to the current state at once. The prims
+         * are authored in the session layer in a single SdfChangeBlock and
+         * the stage scene index is updated once.
+         *
+         * @param primType the type of the prims to create
+         * @param translates the translation of each prim to create
+         * @return the paths of the created prims
+         */
+        SdfPathVector _CreatePrims(TfToken primType,
+                                   const vector<GfVec3d>& translates);
+
+        /**
+         * @brief Create prims at random positions, for stress testing. Each
+         * scatter uses the next seed, so that two scatters of the same count
+         * do not overlap.
+         *
+         * @param primType the type of the prims to create
+         * @param count the number of prims to create
+         */
+        void _ScatterPrims(TfToken primType, int count);
+
+        /**
+         * @brief Create a point instancer that scatters instances of the
+         * given prims. The points are sampled in parallel, either on the
+         * ground plane or in a volume, with a random orientation and scale.
+         * The prototypes reference the given prims, so that the instances
+         * are drawn as a single instanced batch. Each scatter uses the next
+         * seed.
+         *
+         * @param prototypePaths the paths of the prims to instance
+         * @param count the number of instances
+         * @param isOnSurface true to sample the ground plane, false to sample
+         * a volume
+         * @return the path of the point instancer, empty if none was created
+         */
+        SdfPath _ScatterInstances(const SdfPathVector& prototypePaths,
+                                  int count, bool isOnSurface);
+
         /**
          * @brief Get a Palette object for the TextEditor (ImGui plugin)
          *
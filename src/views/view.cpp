@@ -7,7 +7,8 @@ View::View(Model* model, const string label)
       _label(label),
       _wasFocused(false),
       _wasHovered(false),
-      _wasDisplayed(true)
+      _wasDisplayed(true),
+      _lastUpdateTime(0)
 {
 };
 
@@ -27,6 +28,8 @@ const string View::GetViewLabel()
 }
 void View::Update()
 {
+    auto start = chrono::steady_clock::now();
+
     _sceneIndex = GetModel()->GetActiveSceneIndex();
 
     ImGuiIO& io = ImGui::GetIO();
@@ -91,6 +94,9 @@ void View::Update()
 
     ImGui::End();
     ImGui::PopStyleVar(2);
+
+    _lastUpdateTime =
+        chrono::duration<double>(chrono::steady_clock::now() - start).count();
 };
 
 bool View::IsDisplayed()
@@ -98,6 +104,11 @@ bool View::IsDisplayed()
     return _wasDisplayed;
 }
 
+double View::GetLastUpdateTime()
+{
+    return _lastUpdateTime;
+}
+
 ImRect View::GetInnerRect()
 {
     return _innerRect;
@@ -15,6 +15,8 @@
 #include <imgui_internal.h>
 #include <pxr/imaging/hd/sceneIndex.h>
 
+#include <chrono>
+
 #include "models/model.h"
 
 PXR_NAMESPACE_OPEN_SCOPE
@@ -75,6 +77,13 @@ class View {
          */
         bool IsDisplayed();
 
+        /**
+         * @brief Get the time spent by the last update of the view
+         *
+         * @return the update time in seconds
+         */
+        double GetLastUpdateTime();
+
     protected:
         HdSceneIndexBaseRefPtr _sceneIndex;
         /**
@@ -92,6 +101,7 @@ class View {
         bool _wasDisplayed;
         ImRect _innerRect;
         ImVec2 _prevMousePos;
+        double _lastUpdateTime;
 
         /**
          * @brief Called during the update of the view. Allow for custom draw
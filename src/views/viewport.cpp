@@ -6,11 +6,11 @@
 #include <pxr/base/gf/matrix4f.h>
 #include <pxr/base/plug/plugin.h>
 #include <pxr/imaging/cameraUtil/framing.h>
-#include <pxr/imaging/hd/cameraSchema.h>
-#include <pxr/imaging/hd/extentSchema.h>
-#include <pxr/imaging/hd/xformSchema.h>
+#include <pxr/imaging/hio/image.h>
 #include <pxr/usd/usd/stage.h>
 
+#include <algorithm>
+
 PXR_NAMESPACE_OPEN_SCOPE
 
 Viewport::Viewport(Model* model, const string label) : View(model, label)
@@ -19,6 +19,10 @@ Viewport::Viewport(Model* model, const string label) : View(model, label)
     _isAmbientLightEnabled = true;
     _isDomeLightEnabled = false;
     _isGridEnabled = true;
+    _isAdaptiveResolutionEnabled = true;
+    _renderScale = 1.f;
+    _appliedRenderScale = 1.f;
+    _lastNavigationTime = -1.0;
 
     _curOperation = ImGuizmo::TRANSLATE;
     _curMode = ImGuizmo::LOCAL;
@@ -29,17 +33,22 @@ Viewport::Viewport(Model* model, const string label) : View(model, label)
 
     _UpdateActiveCamFromViewport();
 
-    _gridSceneIndex = GridSceneIndex::New();
-    GetModel()->AddSceneIndexBase(_gridSceneIndex);
-
-    auto editableSceneIndex = GetModel()->GetEditableSceneIndex();
-    _xformSceneIndex = XformFilterSceneIndex::New(editableSceneIndex);
-    GetModel()->SetEditableSceneIndex(_xformSceneIndex);
+    // the grid and the instancing are shared by the viewports, the culling
+    // and the lod are created on top of the scene index to render
+    _gridSceneIndex = GetModel()->AcquireGrid();
+    _xformSceneIndex = GetModel()->GetXformSceneIndex();
+    GetModel()->AcquireInstancing();
 };
 
 Viewport::~Viewport()
 {
     delete _engine;
+
+    if (_drivingViewport == this) _drivingViewport = nullptr;
+
+    GetModel()->ReleaseInstancing();
+    _gridSceneIndex = nullptr;
+    GetModel()->ReleaseGrid();
 }
 
 const string Viewport::GetViewType()
@@ -64,6 +73,7 @@ float Viewport::_GetViewportHeight()
 
 void Viewport::_Draw()
 {
+    _UpdateViewportFilters();
     _DrawMenuBar();
 
     if (_GetViewportWidth() <= 0 || _GetViewportHeight() <= 0) return;
@@ -76,7 +86,9 @@ void Viewport::_Draw()
     if (!ImGui::IsWindowFocused()) _UpdateViewportFromActiveCam();
 
     _UpdateProjection();
-    _UpdateGrid();
+    _UpdateCulling();
+    _UpdateLod();
+    if (_IsDrivingGrid()) _UpdateGrid();
     _UpdateHydraRender();
     _UpdateTransformGuizmo();
     _UpdateCubeGuizmo();
@@ -127,6 +139,17 @@ void Viewport::_DrawMenuBar()
                     _engine->SetRendererPlugin(p);
                 }
             }
+            ImGui::Separator();
+            bool progressive = _engine->IsProgressiveRenderingEnabled();
+            if (ImGui::MenuItem("Progressive Rendering", NULL, &progressive))
+                _engine->SetProgressiveRenderingEnabled(progressive);
+            ImGui::MenuItem("Adaptive Resolution", NULL,
+                            &_isAdaptiveResolutionEnabled);
+            ImGui::Separator();
+            if (ImGui::MenuItem("Save Image ...")) {
+                ImGuiFileDialog::Instance()->OpenDialog(
+                    "SaveImageFile", "Choose File", ".exr,.png,.jpg", ".");
+            }
             ImGui::EndMenu();
         }
 
@@ -161,8 +184,23 @@ void Viewport::_DrawMenuBar()
 
             ImGui::EndMenu();
         }
+        if (ImGui::BeginMenu("Culling")) {
+            _DrawCullingMenu();
+            ImGui::EndMenu();
+        }
+        if (ImGui::BeginMenu("LOD")) {
+            _DrawLodMenu();
+            ImGui::EndMenu();
+        }
+        if (ImGui::BeginMenu("Instancing")) {
+            _DrawInstancingMenu();
+            ImGui::EndMenu();
+        }
         if (ImGui::BeginMenu("Show")) {
             ImGui::MenuItem("Grid", NULL, &_isGridEnabled);
+            bool isGridAdaptive = _gridSceneIndex->IsAdaptive();
+            if (ImGui::MenuItem("Adaptive Grid", NULL, &isGridAdaptive))
+                _gridSceneIndex->SetAdaptive(isGridAdaptive);
             ImGui::EndMenu();
         }
         ImGui::EndMenuBar();
@@ -175,6 +213,47 @@ void Viewport::_DrawMenuBar()
         }
         ImGuiFileDialog::Instance()->Close();
     }
+
+    if (ImGuiFileDialog::Instance()->Display("SaveImageFile")) {
+        if (ImGuiFileDialog::Instance()->IsOk()) {
+            string filePath = ImGuiFileDialog::Instance()->GetFilePathName();
+            _SaveImage(filePath);
+        }
+        ImGuiFileDialog::Instance()->Close();
+    }
+}
+
+void Viewport::_SaveImage(const string& filePath)
+{
+    auto writeImage = [filePath](const AovFrame& frame) {
+        HioImage::StorageSpec storage;
+        storage.width = frame.width;
+        storage.height = frame.height;
+        storage.depth = 1;
+        storage.flipped = true;
+        storage.data = (void*)frame.data.data();
+
+        switch (frame.format) {
+            case HdFormatUNorm8Vec4:
+                storage.format = HioFormatUNorm8Vec4;
+                break;
+            case HdFormatFloat16Vec4:
+                storage.format = HioFormatFloat16Vec4;
+                break;
+            case HdFormatFloat32Vec4:
+                storage.format = HioFormatFloat32Vec4;
+                break;
+            default:
+                TF_RUNTIME_ERROR("Unsupported color format, image not saved.");
+                return;
+        }
+
+        HioImageSharedPtr image = HioImage::OpenForWriting(filePath);
+        if (!image || !image->Write(storage))
+            TF_RUNTIME_ERROR("Could not write image %s.", filePath.c_str());
+    };
+
+    _engine->StartAovCapture({HdAovTokens->color}, writeImage, 1);
 }
 
 void Viewport::_ConfigureImGuizmo()
@@ -190,34 +269,175 @@ void Viewport::_ConfigureImGuizmo()
                       _GetViewportWidth(), _GetViewportHeight());
 }
 
+void Viewport::_UpdateViewportFilters()
+{
+    if (_sceneIndexInViewport == _sceneIndex) return;
+    _sceneIndexInViewport = _sceneIndex;
+
+    // the input of a filtering scene index cannot be changed, the filters
+    // are created again with the settings of the previous ones
+    CullingSceneIndexRefPtr cullingSceneIndex =
+        CullingSceneIndex::New(_sceneIndex);
+    if (_cullingSceneIndex) cullingSceneIndex->CopySettings(_cullingSceneIndex);
+    _cullingSceneIndex = cullingSceneIndex;
+
+    LodSceneIndexRefPtr lodSceneIndex = LodSceneIndex::New(_cullingSceneIndex);
+    if (_lodSceneIndex) lodSceneIndex->CopySettings(_lodSceneIndex);
+    _lodSceneIndex = lodSceneIndex;
+}
+
+bool Viewport::_IsDrivingGrid()
+{
+    // the grid is shared by the viewports, it follows the camera of the last
+    // focused one
+    if (!_drivingViewport || ImGui::IsWindowFocused()) _drivingViewport = this;
+    return _drivingViewport == this;
+}
+
 void Viewport::_UpdateGrid()
 {
-    _gridSceneIndex->Populate(_isGridEnabled);
+    _gridSceneIndex->SetCameraPosition(_eye);
+}
+
+void Viewport::_UpdateCulling()
+{
+    if (!_cullingSceneIndex->IsEnabled()) return;
+
+    _cullingSceneIndex->SetFrustum(_GetCurFrustum());
+}
+
+void Viewport::_DrawCullingMenu()
+{
+    bool isEnabled = _cullingSceneIndex->IsEnabled();
+    if (ImGui::MenuItem("Enabled", NULL, &isEnabled))
+        _cullingSceneIndex->SetEnabled(isEnabled);
+
+    float maxDistance = _cullingSceneIndex->GetMaxDistance();
+    if (ImGui::DragFloat("Max Distance", &maxDistance, 1.f, 0.f, FLT_MAX,
+                         maxDistance > 0 ? "%.1f" : "Off"))
+        _cullingSceneIndex->SetMaxDistance(maxDistance);
+
+    float minScreenSize = _cullingSceneIndex->GetMinScreenSize() * 100;
+    if (ImGui::DragFloat("Min Screen Size", &minScreenSize, .1f, 0.f, 100.f,
+                         minScreenSize > 0 ? "%.1f %%" : "Off"))
+        _cullingSceneIndex->SetMinScreenSize(minScreenSize / 100);
+
+    bool isDrawingBounds = _cullingSceneIndex->IsDrawingSmallPrimsAsBounds();
+    if (ImGui::MenuItem("Small Prims As Bounds", NULL, &isDrawingBounds))
+        _cullingSceneIndex->SetSmallPrimsAsBounds(isDrawingBounds);
+
+    if (isEnabled) {
+        ImGui::TextDisabled("%zu / %zu prims culled",
+                            _cullingSceneIndex->GetCulledCount(),
+                            _cullingSceneIndex->GetBoundCount());
+    }
+}
+
+void Viewport::_UpdateLod()
+{
+    if (!_lodSceneIndex->IsEnabled()) return;
+
+    _lodSceneIndex->SetFrustum(_GetCurFrustum());
+    _lodSceneIndex->Update();
+}
+
+void Viewport::_DrawLodMenu()
+{
+    bool isEnabled = _lodSceneIndex->IsEnabled();
+    if (ImGui::MenuItem("Enabled", NULL, &isEnabled))
+        _lodSceneIndex->SetEnabled(isEnabled);
+
+    float threshold = _lodSceneIndex->GetScreenSizeThreshold() * 100;
+    if (ImGui::DragFloat("Screen Size", &threshold, .1f, 0.f, 100.f,
+                         "%.1f %%"))
+        _lodSceneIndex->SetScreenSizeThreshold(threshold / 100);
+
+    int budget = _lodSceneIndex->GetCacheBudget() / (1024 * 1024);
+    if (ImGui::DragInt("Cache Budget", &budget, 1.f, 0, 65536, "%d MB"))
+        _lodSceneIndex->SetCacheBudget(size_t(budget) * 1024 * 1024);
+
+    if (!isEnabled) return;
+
+    size_t hits = _lodSceneIndex->GetHitCount();
+    size_t lookups = hits + _lodSceneIndex->GetMissCount();
+    float hitRate = lookups > 0 ? 100.f * hits / lookups : 0.f;
+
+    ImGui::TextDisabled("%zu meshes simplified, %zu pending",
+                        _lodSceneIndex->GetSimplifiedCount(),
+                        _lodSceneIndex->GetPendingCount());
+    ImGui::TextDisabled("Cache: %.1f / %d MB, %.0f%% hits",
+                        _lodSceneIndex->GetCacheMemoryUsage() /
+                            (1024.f * 1024.f),
+                        budget, hitRate);
+}
+
+void Viewport::_DrawInstancingMenu()
+{
+    InstancingSceneIndexRefPtr instancingSceneIndex =
+        GetModel()->GetInstancingSceneIndex();
+    bool isEnabled = instancingSceneIndex->IsEnabled();
+    if (ImGui::MenuItem("Instance Identical Meshes", NULL, &isEnabled))
+        instancingSceneIndex->SetEnabled(isEnabled);
+
+    if (!isEnabled) return;
+
+    ImGui::TextDisabled("%zu meshes drawn from %zu prototypes",
+                        instancingSceneIndex->GetInstanceCount(),
+                        instancingSceneIndex->GetPrototypeCount());
+    ImGui::TextDisabled("%zu draw calls saved",
+                        instancingSceneIndex->GetDrawCallsSaved());
+    ImGui::TextDisabled("%.1f MB of GPU memory saved",
+                        instancingSceneIndex->GetMemorySaved() /
+                            (1024.f * 1024.f));
+}
+
+GfFrustum Viewport::_GetCurFrustum()
+{
+    GfFrustum frustum = _frustum;
+    frustum.SetPositionAndRotationFromMatrix(_getCurViewMatrix().GetInverse());
+    return frustum;
 }
 
 void Viewport::_UpdateHydraRender()
 {
+    // the engine renders the filters of the viewport, the culling and the
+    // lod of a viewport never change the prims of the others
     if (!_engine) {
         auto pluginId = Engine::GetDefaultRendererPlugin();
-        _engine = new Engine(_sceneIndex, pluginId);
+        _engine = new Engine(_lodSceneIndex, pluginId);
     }
 
-    if(_engine->GetSceneIndex() != _sceneIndex) {
-        _engine->SetSceneIndex(_sceneIndex);
+    if(_engine->GetSceneIndex() != _lodSceneIndex) {
+        _engine->SetSceneIndex(_lodSceneIndex);
     }
 
     GfMatrix4d view = _getCurViewMatrix();
     float width = _GetViewportWidth();
     float height = _GetViewportHeight();
 
+    // render at a lower resolution while navigating, ImGui upsamples the
+    // result to the viewport size
+    _UpdateRenderScale();
+    _appliedRenderScale = _GetRenderScale();
+    int renderWidth = std::max(1, int(width * _appliedRenderScale));
+    int renderHeight = std::max(1, int(height * _appliedRenderScale));
+
     // set selection
     SdfPathVector paths;
     for (auto&& prim : GetModel()->GetSelection())
         paths.push_back(prim.GetPrimPath());
 
     _engine->SetSelection(paths);
-    _engine->SetRenderSize(width, height);
+
+    // the grid is shared by the viewports, hiding it only skips its draw
+    SdfPathVector excludedPaths;
+    if (!_isGridEnabled)
+        excludedPaths.push_back(_gridSceneIndex->GetGridPath());
+    _engine->SetExcludedPaths(excludedPaths);
+
+    _engine->SetRenderSize(renderWidth, renderHeight);
     _engine->SetCameraMatrices(view, _proj);
+    GetModel()->GetRecorder()->RecordCamera(GetViewLabel(), view, _proj);
 
     // do the render
     _engine->Render();
@@ -226,6 +446,30 @@ void Viewport::_UpdateHydraRender()
     ImGui::Image(id, ImVec2(width, height), ImVec2(0, 1), ImVec2(1, 0));
 }
 
+float Viewport::_GetRenderScale()
+{
+    if (!_isAdaptiveResolutionEnabled || !_IsNavigating()) return 1.f;
+    return _renderScale;
+}
+
+void Viewport::_UpdateRenderScale()
+{
+    if (!_isAdaptiveResolutionEnabled || !_IsNavigating()) return;
+
+    // the scale is kept between navigations so that the next one starts
+    // from the last resolution that met the target
+    float frameTime = ImGui::GetIO().DeltaTime;
+    if (frameTime > _TARGET_FRAME_TIME * 1.1f) _renderScale *= .85f;
+    else if (frameTime < _TARGET_FRAME_TIME * .7f) _renderScale *= 1.1f;
+
+    _renderScale = std::clamp(_renderScale, _MIN_RENDER_SCALE, 1.f);
+}
+
+bool Viewport::_IsNavigating()
+{
+    return ImGui::GetTime() - _lastNavigationTime < _NAVIGATION_GRACE_TIME;
+}
+
 void Viewport::_UpdateTransformGuizmo()
 {
     SdfPathVector primPaths = GetModel()->GetSelection();
@@ -233,7 +477,8 @@ void Viewport::_UpdateTransformGuizmo()
 
     SdfPath primPath = primPaths[0];
 
-    GfMatrix4d transform = _xformSceneIndex->GetXform(primPath);
+    GfMatrix4d transform =
+        GetModel()->GetBoundsCache()->GetWorldXform(primPath);
     GfMatrix4f transformF(transform);
 
     GfMatrix4d view = _getCurViewMatrix();
@@ -244,8 +489,11 @@ void Viewport::_UpdateTransformGuizmo()
     ImGuizmo::Manipulate(viewF.data(), projF.data(), _curOperation, _curMode,
                          transformF.data());
 
-    if (transformF != GfMatrix4f(transform))
+    if (transformF != GfMatrix4f(transform)) {
         _xformSceneIndex->SetXform(primPath, GfMatrix4d(transformF));
+        GetModel()->GetRecorder()->RecordXform(primPath,
+                                               GfMatrix4d(transformF));
+    }
 }
 
 void Viewport::_UpdateCubeGuizmo()
@@ -264,6 +512,7 @@ void Viewport::_UpdateCubeGuizmo()
         frustum.SetPositionAndRotationFromMatrix(view.GetInverse());
         _eye = frustum.GetPosition();
         _at = frustum.ComputeLookAtPoint();
+        _lastNavigationTime = ImGui::GetTime();
 
         _UpdateActiveCamFromViewport();
     }
@@ -275,6 +524,15 @@ void Viewport::_UpdatePluginLabel()
     string pluginText = _engine->GetRendererPluginName(curPlugin);
     string text = pluginText;
 
+    if (_engine->IsProgressiveRenderingEnabled()) {
+        char progressText[64];
+        snprintf(progressText, sizeof(progressText), "%s %d passes, %.1fs",
+                 _engine->IsConverged() ? "converged" : "rendering",
+                 _engine->GetProgressivePassCount(),
+                 _engine->GetProgressiveRenderTime());
+        text += "\n" + string(progressText);
+    }
+
     ImDrawList* draw_list = ImGui::GetWindowDrawList();
 
     ImVec2 textSize = ImGui::CalcTextSize(text.c_str());
@@ -302,6 +560,7 @@ void Viewport::_PanActiveCam(ImVec2 mouseDeltaPos)
 
     _eye += delta;
     _at += delta;
+    _lastNavigationTime = ImGui::GetTime();
 
     _UpdateActiveCamFromViewport();
 }
@@ -321,6 +580,7 @@ void Viewport::_OrbitActiveCam(ImVec2 mouseDeltaPos)
     e = _eye - _at;
     vec4 = rotMatrix * GfVec4d(e[0], e[1], e[2], 1.f);
     _eye = _at + GfVec3d(vec4[0], vec4[1], vec4[2]);
+    _lastNavigationTime = ImGui::GetTime();
 
     _UpdateActiveCamFromViewport();
 }
@@ -329,6 +589,7 @@ void Viewport::_ZoomActiveCam(ImVec2 mouseDeltaPos)
 {
     GfVec3d camFront = (_at - _eye).GetNormalized();
     _eye += camFront * mouseDeltaPos.x / 100.f;
+    _lastNavigationTime = ImGui::GetTime();
 
     _UpdateActiveCamFromViewport();
 }
@@ -337,6 +598,7 @@ void Viewport::_ZoomActiveCam(float scrollWheel)
 {
     GfVec3d camFront = (_at - _eye).GetNormalized();
     _eye += camFront * scrollWheel;
+    _lastNavigationTime = ImGui::GetTime();
 
     _UpdateActiveCamFromViewport();
 }
@@ -349,6 +611,7 @@ void Viewport::_SetFreeCamAsActive()
 void Viewport::_SetActiveCam(SdfPath primPath)
 {
     _activeCam = primPath;
+    _activeCamState = nullptr;
     _UpdateViewportFromActiveCam();
 }
 
@@ -356,9 +619,13 @@ void Viewport::_UpdateViewportFromActiveCam()
 {
     if (_activeCam.IsEmpty()) return;
 
-    HdSceneIndexPrim prim = _sceneIndex->GetPrim(_activeCam);
-    GfCamera gfCam = _ToGfCamera(prim);
-    GfFrustum frustum = gfCam.GetFrustum();
+    // the cache rebuilds the camera once it is edited, by this viewport or
+    // another one, an unchanged camera is the same pointer
+    auto gfCam = GetModel()->GetCameraCache()->GetCamera(_activeCam);
+    if (gfCam == _activeCamState) return;
+    _activeCamState = gfCam;
+
+    GfFrustum frustum = gfCam->GetFrustum();
     _eye = frustum.GetPosition();
     _at = frustum.ComputeLookAtPoint();
 }
@@ -372,10 +639,8 @@ void Viewport::_UpdateActiveCamFromViewport()
 {
     if (_activeCam.IsEmpty()) return;
 
-    HdSceneIndexPrim prim = _sceneIndex->GetPrim(_activeCam);
-    GfCamera gfCam = _ToGfCamera(prim);
-
-    GfFrustum prevFrustum = gfCam.GetFrustum();
+    auto gfCam = GetModel()->GetCameraCache()->GetCamera(_activeCam);
+    GfFrustum prevFrustum = gfCam->GetFrustum();
 
     GfMatrix4d view = _getCurViewMatrix();
     ;
@@ -385,6 +650,7 @@ void Viewport::_UpdateActiveCamFromViewport()
     if (view == prevView && _proj == prevProj) return;
 
     _xformSceneIndex->SetXform(_activeCam, view.GetInverse());
+    GetModel()->GetRecorder()->RecordXform(_activeCam, view.GetInverse());
 }
 
 void Viewport::_UpdateProjection()
@@ -394,83 +660,32 @@ void Viewport::_UpdateProjection()
     float farPlane = _FREE_CAM_FAR;
 
     if (!_activeCam.IsEmpty()) {
-        HdSceneIndexPrim prim = _sceneIndex->GetPrim(_activeCam);
-        GfCamera gfCam = _ToGfCamera(prim);
-        fov = gfCam.GetFieldOfView(GfCamera::FOVVertical);
-        nearPlane = gfCam.GetClippingRange().GetMin();
-        farPlane = gfCam.GetClippingRange().GetMax();
+        auto gfCam = GetModel()->GetCameraCache()->GetCamera(_activeCam);
+        fov = gfCam->GetFieldOfView(GfCamera::FOVVertical);
+        nearPlane = gfCam->GetClippingRange().GetMin();
+        farPlane = gfCam->GetClippingRange().GetMax();
     }
 
-    GfFrustum frustum;
     double aspectRatio = _GetViewportWidth() / _GetViewportHeight();
-    frustum.SetPerspective(fov, true, aspectRatio, nearPlane, farPlane);
-    _proj = frustum.ComputeProjectionMatrix();
+    _frustum.SetPerspective(fov, true, aspectRatio, nearPlane, farPlane);
+    _proj = _frustum.ComputeProjectionMatrix();
 }
 
-GfCamera Viewport::_ToGfCamera(HdSceneIndexPrim prim)
+void Viewport::_FocusOnPrims(SdfPathVector primPaths)
 {
-    GfCamera cam;
-
-    if (prim.primType != HdPrimTypeTokens->camera) return cam;
-
-    HdSampledDataSource::Time time(0);
-
-    HdXformSchema xformSchema = HdXformSchema::GetFromParent(prim.dataSource);
-
-    GfMatrix4d xform =
-        xformSchema.GetMatrix()->GetValue(time).Get<GfMatrix4d>();
-
-    HdCameraSchema camSchema = HdCameraSchema::GetFromParent(prim.dataSource);
-
-    TfToken projection =
-        camSchema.GetProjection()->GetValue(time).Get<TfToken>();
-    float hAperture =
-        camSchema.GetHorizontalAperture()->GetValue(time).Get<float>();
-    float vAperture =
-        camSchema.GetVerticalAperture()->GetValue(time).Get<float>();
-    float hApertureOffest =
-        camSchema.GetHorizontalApertureOffset()->GetValue(time).Get<float>();
-    float vApertureOffest =
-        camSchema.GetVerticalApertureOffset()->GetValue(time).Get<float>();
-    float focalLength =
-        camSchema.GetFocalLength()->GetValue(time).Get<float>();
-    GfVec2f clippingRange =
-        camSchema.GetClippingRange()->GetValue(time).Get<GfVec2f>();
-
-    cam.SetTransform(xform);
-    cam.SetProjection(projection == HdCameraSchemaTokens->orthographic
-                          ? GfCamera::Orthographic
-                          : GfCamera::Perspective);
-    cam.SetHorizontalAperture(hAperture / GfCamera::APERTURE_UNIT);
-    cam.SetVerticalAperture(vAperture / GfCamera::APERTURE_UNIT);
-    cam.SetHorizontalApertureOffset(hApertureOffest / GfCamera::APERTURE_UNIT);
-    cam.SetVerticalApertureOffset(vApertureOffest / GfCamera::APERTURE_UNIT);
-    cam.SetFocalLength(focalLength / GfCamera::FOCAL_LENGTH_UNIT);
-    cam.SetClippingRange(GfRange1f(clippingRange[0], clippingRange[1]));
-
-    return cam;
-}
-
-void Viewport::_FocusOnPrim(SdfPath primPath)
-{
-    if (primPath.IsEmpty()) return;
-
-    HdSceneIndexPrim prim = _sceneIndex->GetPrim(primPath);
-
-    HdExtentSchema extentSchema =
-        HdExtentSchema::GetFromParent(prim.dataSource);
-    if (!extentSchema.IsDefined()) {
-        TF_WARN("Prim at %s has no extent; skipping focus.",
-                primPath.GetAsString().c_str());
+    // the bounds of the subtrees are world space, Xforms without an extent
+    // are framed from their descendants
+    GfRange3d extentRange;
+    for (auto&& primPath : primPaths) {
+        if (primPath.IsEmpty()) continue;
+        extentRange.UnionWith(
+            GetModel()->GetBoundsCache()->GetSubtreeBound(primPath));
+    }
+    if (extentRange.IsEmpty()) {
+        TF_WARN("The selected prims have no extent; skipping focus.");
         return;
     }
 
-    HdSampledDataSource::Time time(0);
-    GfVec3d extentMin = extentSchema.GetMin()->GetValue(time).Get<GfVec3d>();
-    GfVec3d extentMax = extentSchema.GetMax()->GetValue(time).Get<GfVec3d>();
-
-    GfRange3d extentRange(extentMin, extentMax);
-
     _at = extentRange.GetMidpoint();
     _eye = _at + (_eye - _at).GetNormalized() *
                      extentRange.GetSize().GetLength() * 2;
@@ -482,7 +697,7 @@ void Viewport::_KeyPressEvent(ImGuiKey key)
 {
     if (key == ImGuiKey_F) {
         SdfPathVector primPaths = GetModel()->GetSelection();
-        if (primPaths.size() > 0) _FocusOnPrim(primPaths[0]);
+        if (primPaths.size() > 0) _FocusOnPrims(primPaths);
     }
     else if (key == ImGuiKey_W) {
         _curOperation = ImGuizmo::TRANSLATE;
@@ -505,6 +720,9 @@ void Viewport::_MouseMoveEvent(ImVec2 prevPos, ImVec2 curPos)
     ImGuiIO& io = ImGui::GetIO();
     if (io.MouseWheel) _ZoomActiveCam(io.MouseWheel);
 
+    // a held button without motion is not a navigation
+    if (deltaMousePos.x == 0 && deltaMousePos.y == 0) return;
+
     if (ImGui::IsMouseDown(ImGuiMouseButton_Left) &&
         (ImGui::IsKeyDown(ImGuiKey_LeftAlt) ||
          ImGui::IsKeyDown(ImGuiKey_RightAlt))) {
@@ -527,7 +745,9 @@ void Viewport::_MouseReleaseEvent(ImGuiMouseButton_ button, ImVec2 mousePos)
     if (button == ImGuiMouseButton_Left) {
         ImVec2 delta = ImGui::GetMouseDragDelta(ImGuiMouseButton_Left);
         if (fabs(delta.x) + fabs(delta.y) < 0.001f) {
-            GfVec2f gfMousePos(mousePos[0], mousePos[1]);
+            // the render buffer may be scaled down
+            GfVec2f gfMousePos(mousePos[0] * _appliedRenderScale,
+                               mousePos[1] * _appliedRenderScale);
             SdfPath primPath = _engine->FindIntersection(gfMousePos);
 
             if (primPath.IsEmpty()) GetModel()->SetSelection({});
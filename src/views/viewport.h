@@ -20,7 +20,10 @@
 
 #include "engine.h"
 #include "models/model.h"
+#include "sceneindices/cullingsceneindex.h"
 #include "sceneindices/gridsceneindex.h"
+#include "sceneindices/instancingsceneindex.h"
+#include "sceneindices/lodsceneindex.h"
 #include "sceneindices/xformfiltersceneindex.h"
 #include "view.h"
 
@@ -69,17 +72,31 @@ class Viewport : public View {
         const float _FREE_CAM_NEAR = 0.1f;
         const float _FREE_CAM_FAR = 10000.f;
 
+        const float _TARGET_FRAME_TIME = 1.f / 30.f;
+        const float _MIN_RENDER_SCALE = .25f;
+        const double _NAVIGATION_GRACE_TIME = .2;
+
+        inline static Viewport* _drivingViewport = nullptr;
+
         bool _isAmbientLightEnabled, _isDomeLightEnabled, _isGridEnabled;
+        bool _isAdaptiveResolutionEnabled;
+        float _renderScale, _appliedRenderScale;
+        double _lastNavigationTime;
         SdfPath _activeCam;
+        shared_ptr<const GfCamera> _activeCamState;
 
         GfVec3d _eye, _at, _up;
         GfMatrix4d _proj;
+        GfFrustum _frustum;
 
         Engine* _engine;
         bool _resetEngine;
         HdSceneIndexBaseRefPtr _sceneIndexInViewport;
         TfToken _pluginInViewport;
 
+        CullingSceneIndexRefPtr _cullingSceneIndex;
+        LodSceneIndexRefPtr _lodSceneIndex;
+
         GridSceneIndexRefPtr _gridSceneIndex;
         XformFilterSceneIndexRefPtr _xformSceneIndex;
         ImGuiWindowFlags _gizmoWindowFlags;
@@ -113,24 +130,108 @@ class Viewport : public View {
          */
         void _DrawMenuBar();
 
+        /**
+         * @brief Capture the next rendered color AOV and write it to disk
+         *
+         * @param filePath the path of the image to write
+         */
+        void _SaveImage(const string& filePath);
+
         /**
          * @brief Configure ImGuizmo
          *
          */
         void _ConfigureImGuizmo();
 
+        /**
+         * @brief Check if the viewport drives the grid shared by the
+         * viewports, which is the case of the last focused one
+         *
+         * @return true if the viewport drives the grid
+         */
+        bool _IsDrivingGrid();
+
+        /**
+         * @brief Create the filters of the viewport on top of the scene
+         * index to render when it changes, keeping their settings. They
+         * depend on the viewport camera, so that each engine renders its own
+         * filters rather than sharing them through the model.
+         *
+         */
+        void _UpdateViewportFilters();
+
         /**
          * @brief Update the grid within the viewport
          *
          */
         void _UpdateGrid();
 
+        /**
+         * @brief Update the culling frustum with the viewport camera
+         *
+         */
+        void _UpdateCulling();
+
+        /**
+         * @brief Draw the culling menu
+         *
+         */
+        void _DrawCullingMenu();
+
+        /**
+         * @brief Update the level of detail of the meshes with the viewport
+         * camera
+         *
+         */
+        void _UpdateLod();
+
+        /**
+         * @brief Draw the level of detail menu
+         *
+         */
+        void _DrawLodMenu();
+
+        /**
+         * @brief Draw the instancing menu and its statistics
+         *
+         */
+        void _DrawInstancingMenu();
+
+        /**
+         * @brief Get the frustum of the viewport camera
+         *
+         * @return GfFrustum the frustum of the viewport camera
+         */
+        GfFrustum _GetCurFrustum();
+
         /**
          * @brief Update the USD render
          *
          */
         void _UpdateHydraRender();
 
+        /**
+         * @brief Get the scale to apply to the render buffer size. Below 1
+         * while the camera is navigating and the frame time is above the
+         * target, 1 otherwise.
+         *
+         * @return the render scale in ]0, 1]
+         */
+        float _GetRenderScale();
+
+        /**
+         * @brief Adapt the navigation render scale to the last frame time
+         *
+         */
+        void _UpdateRenderScale();
+
+        /**
+         * @brief Check if the camera moved recently
+         *
+         * @return true if the camera is being navigated
+         */
+        bool _IsNavigating();
+
         /**
          * @brief Update the transform Guizmo (the 3 axis of a selection)
          *
@@ -217,19 +318,12 @@ class Viewport : public View {
         void _UpdateProjection();
 
         /**
-         * @brief Convert a Hydra Prim to a GfCamera
-         *
-         * @param prim the Prim to create the camera from
-         * @return GfCamera the camera
-         */
-        GfCamera _ToGfCamera(HdSceneIndexPrim prim);
-
-        /**
-         * @brief Focus the active camera and the viewport on the given prim
+         * @brief Focus the active camera and the viewport on the given prims
+         * and their descendants
          *
-         * @param primPath the prim to focus on
+         * @param primPaths the prims to focus on
          */
-        void _FocusOnPrim(SdfPath primPath);
+        void _FocusOnPrims(SdfPathVector primPaths);
 
         /**
          * @brief Override of the View::_KeyPressEvent